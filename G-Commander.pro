@@ -4,22 +4,21 @@
 #
 #-------------------------------------------------
 
-QT       += core gui serialport
+QT       += core gui serialport concurrent
 
 CONFIG += C++11
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+#Board, streaming and job loading code, shared with tests
+include(gcommandercore.pri)
+
 TARGET = G-Commander
 TEMPLATE = app
 
 
 SOURCES += main.cpp\
         mainwindow.cpp \
-    grblboard.cpp \
-    grblstatus.cpp \
-    grblinstruction.cpp \
-    gcodestreamer.cpp \
     historymodel.cpp \
     historyitem.cpp \
     widgets/movementswidget.cpp \
@@ -30,17 +29,11 @@ SOURCES += main.cpp\
     widgets/coordinatedisplay.cpp \
     widgets/visualizerwidget.cpp \
     widgets/visualizerprimitive.cpp \
-    gcodeparser.cpp \
     grblerrorrecorder.cpp \
     grblconfigurationdialog.cpp \
-    grblconfiguration.cpp
+    widgets/diagnosticswidget.cpp
 
 HEADERS  += mainwindow.h \
-    grblboard.h \
-    grblstatus.h \
-    grbldefinitions.h \
-    grblinstruction.h \
-    gcodestreamer.h \
     historymodel.h \
     historyitem.h \
     widgets/movementswidget.h \
@@ -51,10 +44,9 @@ HEADERS  += mainwindow.h \
     widgets/coordinatedisplay.h \
     widgets/visualizerwidget.h \
     widgets/visualizerprimitive.h \
-    gcodeparser.h \
     grblerrorrecorder.h \
     grblconfigurationdialog.h \
-    grblconfiguration.h
+    widgets/diagnosticswidget.h
 
 FORMS    += \
     widgets/movementswidget.ui \
@@ -63,7 +55,8 @@ FORMS    += \
     widgets/hardwarewidget.ui \
     widgets/gcodefilewidget.ui \
     widgets/coordinatedisplay.ui \
-    grblconfigurationdialog.ui
+    grblconfigurationdialog.ui \
+    widgets/diagnosticswidget.ui
 
 RESOURCES += \
     icons.qrc \
@@ -0,0 +1,257 @@
+#include "gcodedecompressor.h"
+
+#include <cstring>
+
+#define INPUT_CHUNK_SIZE    65536
+#define GZIP_WINDOW_BITS    (16 + MAX_WBITS)    //Let zlib handle gzip header and trailer
+
+static const unsigned char s_gzipMagic[] = {0x1F, 0x8B};
+static const unsigned char s_zstdMagic[] = {0x28, 0xB5, 0x2F, 0xFD};
+
+GCodeDecompressor::GCodeDecompressor(const QString &path, QObject *parent):
+    QIODevice(parent),
+    m_file(path),
+    m_format(format_none),
+    m_inputPosition(0),
+    m_isFinished(true),
+    m_isFrameComplete(false),
+    m_isFailed(false)
+{
+#ifdef HAVE_ZSTD
+    m_zstdStream = nullptr;
+#endif
+}
+
+GCodeDecompressor::~GCodeDecompressor(){
+    close();
+}
+
+GCodeDecompressor::Format GCodeDecompressor::detectFormat(const QString &path){
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)){
+        return format_none;
+    }
+
+    QByteArray magic = file.read(sizeof(s_zstdMagic));
+    if(magic.size() >= int(sizeof(s_gzipMagic)) && memcmp(magic.constData(), s_gzipMagic, sizeof(s_gzipMagic)) == 0){
+        return format_gzip;
+    }
+    if(magic.size() >= int(sizeof(s_zstdMagic)) && memcmp(magic.constData(), s_zstdMagic, sizeof(s_zstdMagic)) == 0){
+        return format_zstd;
+    }
+    return format_none;
+}
+
+bool GCodeDecompressor::isSupported(Format format){
+    switch(format){
+#ifdef HAVE_ZLIB
+    case format_gzip:
+        return true;
+#endif
+#ifdef HAVE_ZSTD
+    case format_zstd:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+QStringList GCodeDecompressor::getSupportedSuffixes(){
+    QStringList suffixes;
+#ifdef HAVE_ZLIB
+    suffixes << QStringLiteral("gz");
+#endif
+#ifdef HAVE_ZSTD
+    suffixes << QStringLiteral("zst");
+#endif
+    return suffixes;
+}
+
+bool GCodeDecompressor::open(OpenMode mode){
+    if((mode & QIODevice::WriteOnly) || isOpen()){
+        return false;
+    }
+
+    m_format = detectFormat(m_file.fileName());
+    if(!isSupported(m_format)){
+        setErrorString(tr("Unsupported compression format"));
+        return false;
+    }
+
+    if(!m_file.open(QIODevice::ReadOnly)){
+        setErrorString(m_file.errorString());
+        return false;
+    }
+
+    bool isInitialized = false;
+    switch(m_format){
+#ifdef HAVE_ZLIB
+    case format_gzip:
+        memset(&m_zStream, 0, sizeof(m_zStream));
+        isInitialized = (inflateInit2(&m_zStream, GZIP_WINDOW_BITS) == Z_OK);
+        break;
+#endif
+#ifdef HAVE_ZSTD
+    case format_zstd:
+        m_zstdStream = ZSTD_createDStream();
+        isInitialized = (m_zstdStream != nullptr && !ZSTD_isError(ZSTD_initDStream(m_zstdStream)));
+        break;
+#endif
+    default:
+        break;
+    }
+
+    if(!isInitialized){
+        setErrorString(tr("Could not initialize decompression"));
+        close();
+        return false;
+    }
+
+    m_input.clear();
+    m_inputPosition = 0;
+    m_isFinished = false;
+    m_isFrameComplete = false;
+    m_isFailed = false;
+
+    //Caller reads large chunks, no need for another buffer
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void GCodeDecompressor::close(){
+    switch(m_format){
+#ifdef HAVE_ZLIB
+    case format_gzip:
+        inflateEnd(&m_zStream);
+        break;
+#endif
+#ifdef HAVE_ZSTD
+    case format_zstd:
+        ZSTD_freeDStream(m_zstdStream);
+        m_zstdStream = nullptr;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    m_format = format_none;
+    m_file.close();
+    m_input.clear();
+    m_isFinished = true;
+
+    QIODevice::close();
+}
+
+bool GCodeDecompressor::fillInput(){
+    m_input = m_file.read(INPUT_CHUNK_SIZE);
+    m_inputPosition = 0;
+    return !m_input.isEmpty();
+}
+
+qint64 GCodeDecompressor::readData(char *data, qint64 maxSize){
+    //Loop until some bytes are produced, decompressor may need several input chunks for that
+    qint64 produced = 0;
+    while(produced == 0 && maxSize > 0 && !m_isFinished){
+        bool isInputEnded = false;
+        if(m_inputPosition >= m_input.size() && !fillInput()){
+            //End of compressed file, where the last frame must end too
+            if(m_isFrameComplete){
+                m_isFinished = true;
+                break;
+            }
+            isInputEnded = true;
+        }
+
+        switch(m_format){
+        case format_gzip:
+            produced = inflateGzip(data, maxSize);
+            break;
+        case format_zstd:
+            produced = inflateZstd(data, maxSize);
+            break;
+        default:
+            produced = -1;
+            break;
+        }
+
+        if(produced < 0){
+            m_isFailed = true;
+            m_isFinished = true;
+            return -1;
+        }
+
+        //Output held back by the decompressor is drained first, a frame still open after that was cut short
+        if(isInputEnded && produced == 0){
+            setErrorString(tr("Compressed file is truncated"));
+            m_isFailed = true;
+            m_isFinished = true;
+            return -1;
+        }
+    }
+
+    return (produced == 0 && m_isFinished) ? -1 : produced;
+}
+
+qint64 GCodeDecompressor::inflateGzip(char *data, qint64 maxSize){
+#ifdef HAVE_ZLIB
+    m_zStream.next_in = reinterpret_cast<Bytef*>(m_input.data() + m_inputPosition);
+    m_zStream.avail_in = uInt(m_input.size() - m_inputPosition);
+    m_zStream.next_out = reinterpret_cast<Bytef*>(data);
+    m_zStream.avail_out = uInt(qMin<qint64>(maxSize, INPUT_CHUNK_SIZE * 16));
+    uInt outputSize = m_zStream.avail_out;
+
+    int result = inflate(&m_zStream, Z_NO_FLUSH);
+    m_inputPosition = m_input.size() - int(m_zStream.avail_in);
+    m_isFrameComplete = (result == Z_STREAM_END);
+
+    if(result == Z_STREAM_END){
+        //Several gzip members may follow each other, as written by parallel compressors
+        if(m_inputPosition < m_input.size() || fillInput()){
+            inflateReset(&m_zStream);
+        }
+        else{
+            m_isFinished = true;
+        }
+    }
+    else if(result != Z_OK && result != Z_BUF_ERROR){
+        setErrorString(QString::fromLatin1(m_zStream.msg != nullptr ? m_zStream.msg : "Corrupted gzip data"));
+        return -1;
+    }
+
+    return outputSize - m_zStream.avail_out;
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+#endif
+}
+
+qint64 GCodeDecompressor::inflateZstd(char *data, qint64 maxSize){
+#ifdef HAVE_ZSTD
+    //Frames following each other are handled by the stream itself
+    ZSTD_inBuffer input = {m_input.constData() + m_inputPosition, size_t(m_input.size() - m_inputPosition), 0};
+    ZSTD_outBuffer output = {data, size_t(maxSize), 0};
+
+    size_t result = ZSTD_decompressStream(m_zstdStream, &output, &input);
+    m_inputPosition += int(input.pos);
+    m_isFrameComplete = (result == 0);     //Frame decoded and flushed
+
+    if(ZSTD_isError(result)){
+        setErrorString(QString::fromLatin1(ZSTD_getErrorName(result)));
+        return -1;
+    }
+
+    return qint64(output.pos);
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+#endif
+}
+
+qint64 GCodeDecompressor::writeData(const char *data, qint64 maxSize){
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
@@ -0,0 +1,69 @@
+#ifndef GCODEDECOMPRESSOR_H
+#define GCODEDECOMPRESSOR_H
+
+#include <QIODevice>
+#include <QFile>
+#include <QByteArray>
+#include <QStringList>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+//Sequential device giving the decompressed content of a gzip or zstd file, decompressed as it is read
+class GCodeDecompressor : public QIODevice
+{
+    Q_OBJECT
+public:
+    enum Format{format_none, format_gzip, format_zstd};
+
+    explicit GCodeDecompressor(const QString &path, QObject *parent = nullptr);
+    ~GCodeDecompressor();
+
+    //Format is detected from the first bytes of the file, not from its name
+    static Format detectFormat(const QString &path);
+    static bool isSupported(Format format);
+
+    //File name suffixes of the compressed formats this build can read
+    static QStringList getSupportedSuffixes();
+
+    bool open(OpenMode mode) Q_DECL_OVERRIDE;
+    void close() Q_DECL_OVERRIDE;
+    bool isSequential() const Q_DECL_OVERRIDE {return true;}
+
+    //Progress through the compressed file
+    qint64 getCompressedPosition() const {return m_file.pos();}
+    qint64 getCompressedSize() const {return m_file.size();}
+
+    //Corrupted or truncated data : reading ended early, errorString tells why
+    bool isFailed() const {return m_isFailed;}
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+    qint64 writeData(const char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+
+private:
+    bool fillInput();
+    qint64 inflateGzip(char *data, qint64 maxSize);
+    qint64 inflateZstd(char *data, qint64 maxSize);
+
+    QFile m_file;
+    Format m_format;
+    QByteArray m_input;
+    int m_inputPosition;
+    bool m_isFinished;
+    bool m_isFrameComplete;     //Last gzip member or zstd frame ended, input may stop there
+    bool m_isFailed;
+
+#ifdef HAVE_ZLIB
+    z_stream m_zStream;
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *m_zstdStream;
+#endif
+};
+
+#endif // GCODEDECOMPRESSOR_H
@@ -0,0 +1,72 @@
+#include "gcodefollowedjob.h"
+
+#include <QFileInfo>
+#include <algorithm>
+
+#define STANDARD_INPUT_PATH     "-"
+#define MAX_ARENA_SIZE          (0x7FFFFFFFll - 4096)   //Lines are held in a single QByteArray
+
+GCodeFollowedJob::GCodeFollowedJob(const QString &path):
+    m_path(path),
+    m_lineCount(0),
+    m_isComplete(false)
+{
+
+}
+
+bool GCodeFollowedJob::appendBatch(const GCodeLineBatch &batch){
+    if(m_arena.size() + qint64(batch.data.size()) > MAX_ARENA_SIZE){
+        return false;
+    }
+
+    quint32 offset = quint32(m_arena.size());
+    m_arena.append(batch.data);
+
+    for(int i = 0 ; i < batch.lengths.size() ; i++){
+        m_offsets.append(offset);
+        m_lineNumbers.append(batch.lineNumbers.at(i));
+        m_lengths.append(quint16(batch.lengths.at(i)));
+        m_estimatedTimes.append(batch.estimatedTimes.at(i));
+        offset += quint32(batch.lengths.at(i));
+    }
+
+    m_lineCount = batch.lineCount;
+    return true;
+}
+
+void GCodeFollowedJob::clear(){
+    m_arena.clear();
+    m_offsets.clear();
+    m_lineNumbers.clear();
+    m_lengths.clear();
+    m_estimatedTimes.clear();
+    m_lineCount = 0;
+}
+
+QString GCodeFollowedJob::getFileName() const{
+    if(m_path == QLatin1String(STANDARD_INPUT_PATH)){
+        return QStringLiteral("stdin");
+    }
+    return QFileInfo(m_path).baseName();
+}
+
+const char *GCodeFollowedJob::getLineData(int index, int *length){
+    *length = m_lengths.at(index);
+    return m_arena.constData() + m_offsets.at(index);
+}
+
+GrblInstruction GCodeFollowedJob::getInstruction(int index){
+    int length;
+    const char *data = getLineData(index,&length);
+
+    return GrblInstruction::fromRawData(data, length, m_lineNumbers.at(index));
+}
+
+int GCodeFollowedJob::indexOfLine(int line){
+    if(m_lineNumbers.isEmpty()){
+        return 0;
+    }
+
+    QVector<qint32>::const_iterator found = std::lower_bound(m_lineNumbers.constBegin(), m_lineNumbers.constEnd(), line);
+    return qMin(int(found - m_lineNumbers.constBegin()), m_lineNumbers.size()-1);
+}
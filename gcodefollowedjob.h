@@ -0,0 +1,63 @@
+#ifndef GCODEFOLLOWEDJOB_H
+#define GCODEFOLLOWEDJOB_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QMetaType>
+
+#include "gcodejob.h"
+
+//Useful lines read from a source still being written, handed over in one go
+struct GCodeLineBatch{
+    QByteArray data;            //Useful parts of lines, one after the other
+    QVector<int> lengths;
+    QVector<int> lineNumbers;
+    QVector<quint32> estimatedTimes;
+    int lineCount = 0;          //Lines read from source so far, including useless ones
+};
+
+Q_DECLARE_METATYPE(GCodeLineBatch)
+
+//Job growing while its source is written (growing file, named pipe, standard input)
+class GCodeFollowedJob : public GCodeJob
+{
+public:
+    explicit GCodeFollowedJob(const QString &path);
+
+    //Lines are all held in memory : false, and nothing appended, once they would no longer fit
+    bool appendBatch(const GCodeLineBatch &batch);
+
+    bool isComplete() const Q_DECL_OVERRIDE {return m_isComplete;}
+    void setComplete() {m_isComplete = true;}
+
+    void clear() Q_DECL_OVERRIDE;
+
+    QString getFileName() const Q_DECL_OVERRIDE;
+
+    int size() const Q_DECL_OVERRIDE {return m_lineNumbers.size();}
+    int getLineCount() const Q_DECL_OVERRIDE {return m_lineCount;}
+
+    int getLineNumber(int index) Q_DECL_OVERRIDE {return m_lineNumbers.at(index);}
+
+    //Arena may move when lines are appended, returned instruction must be detached before that
+    GrblInstruction getInstruction(int index) Q_DECL_OVERRIDE;
+
+    const char *getLineData(int index, int *length) Q_DECL_OVERRIDE;
+
+    int indexOfLine(int line) Q_DECL_OVERRIDE;
+
+    quint32 getEstimatedTime(int index) Q_DECL_OVERRIDE {return m_estimatedTimes.at(index);}
+
+private:
+    QString m_path;
+    QByteArray m_arena;
+
+    QVector<quint32> m_offsets;
+    QVector<qint32> m_lineNumbers;
+    QVector<quint16> m_lengths;
+    QVector<quint32> m_estimatedTimes;
+    int m_lineCount;
+    bool m_isComplete;
+};
+
+#endif // GCODEFOLLOWEDJOB_H
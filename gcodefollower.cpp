@@ -0,0 +1,279 @@
+#include "gcodefollower.h"
+#include "gcodejob.h"
+#include "grbldefinitions.h"
+
+#include <QThread>
+#include <QFileInfo>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+#define STANDARD_INPUT_PATH         "-"
+#define READ_CHUNK_SIZE             65536
+#define BATCH_INTERVAL_MS           100     //Bound the rate of results sent to the GUI
+#define FOLLOW_POLL_INTERVAL_MS     50      //Wait between two reads when no byte is available
+#define FOLLOW_MAX_READ_AHEAD       500000  //Useful lines read ahead of the streamer before the producer is held back
+#define FOLLOW_QUIET_PERIOD_MS      3000    //Source not growing for this long may be done without saying so
+
+GCodeFollower::GCodeFollower(QObject *parent) :
+    QObject(parent),
+#ifdef Q_OS_UNIX
+    m_fd(-1),
+    m_savedFlags(-1),
+#endif
+    m_isStandardInput(false),
+    m_isRegularFile(false),
+    m_isDataReceived(false),
+    m_isQuietReported(false),
+    m_lineCount(0),
+    m_usefulLineCount(0),
+    m_currentFollowId(0),
+    m_consumedLineCount(0)
+{
+    //Parser is a child, so it follows the follower in its thread
+    m_parser = new GCodeParser(this);
+    connect(m_parser,&GCodeParser::parsedPrimitive,this,&GCodeFollower::onPrimitiveParsed);
+}
+
+int GCodeFollower::startNewFollow(){
+    m_consumedLineCount.storeRelease(0);
+    return m_currentFollowId.fetchAndAddOrdered(1) + 1;
+}
+
+void GCodeFollower::cancel(){
+    m_currentFollowId.fetchAndAddOrdered(1);
+}
+
+bool GCodeFollower::isCancelled(int followId) const{
+    return m_currentFollowId.loadAcquire() != followId;
+}
+
+void GCodeFollower::follow(const QString &path, int followId){
+    if(isCancelled(followId)){
+        return;
+    }
+
+    if(!openSource(path)){
+        emit finished(followId,false);
+        return;
+    }
+
+    m_parser->reset();
+    m_buffer.clear();
+    m_lineCount = 0;
+    m_usefulLineCount = 0;
+    m_isDataReceived = false;
+    m_isQuietReported = false;
+    m_batch = GCodeLineBatch();
+    m_primitives.clear();
+    m_batchTimer.start();
+    m_quietTimer.start();
+
+    QByteArray chunk(READ_CHUNK_SIZE,Qt::Uninitialized);
+    bool isEnded = false;
+    while(!isEnded && !isCancelled(followId)){
+        //Producer is held back by not reading, while the machine is far behind
+        if(m_usefulLineCount - m_consumedLineCount.loadAcquire() >= FOLLOW_MAX_READ_AHEAD){
+            flushBatch(followId);
+            QThread::msleep(FOLLOW_POLL_INTERVAL_MS);
+            continue;
+        }
+
+        int readSize = readSource(chunk.data(),chunk.size());
+        if(readSize > 0){
+            m_isDataReceived = true;
+            m_isQuietReported = false;
+            m_quietTimer.restart();
+            m_buffer.append(chunk.constData(),readSize);
+            isEnded = processBuffer(false);
+        }
+        else if(readSize < 0){
+            //Last line may come without line return
+            processBuffer(true);
+            isEnded = true;
+        }
+        else{
+            //Nothing new yet, let the GUI know what was read meanwhile
+            flushBatch(followId);
+
+            //Program without M2 / M30 : its last lines must not wait for more forever. A partial line is kept,
+            //its end may still come
+            if(m_isDataReceived && !m_isQuietReported && m_quietTimer.elapsed() >= FOLLOW_QUIET_PERIOD_MS){
+                m_isQuietReported = true;
+                emit sourceQuiet(followId);
+            }
+            QThread::msleep(FOLLOW_POLL_INTERVAL_MS);
+        }
+
+        if(m_batchTimer.elapsed() >= BATCH_INTERVAL_MS){
+            flushBatch(followId);
+        }
+    }
+
+    closeSource();
+
+    if(!isCancelled(followId)){
+        flushBatch(followId);
+        emit finished(followId,true);
+    }
+}
+
+bool GCodeFollower::openSource(const QString &path){
+    m_isStandardInput = (path == QLatin1String(STANDARD_INPUT_PATH));
+
+#ifdef Q_OS_UNIX
+    m_fd = m_isStandardInput ? STDIN_FILENO : ::open(QFile::encodeName(path).constData(), O_RDONLY | O_NONBLOCK);
+    if(m_fd < 0){
+        return false;
+    }
+
+    //Without writer, a pipe opened non blocking reads as ended : keep polling until first bytes come
+    m_savedFlags = fcntl(m_fd, F_GETFL);
+    fcntl(m_fd, F_SETFL, m_savedFlags | O_NONBLOCK);
+
+    struct stat status;
+    m_isRegularFile = (fstat(m_fd, &status) == 0 && S_ISREG(status.st_mode));
+    return true;
+#else
+    //No non blocking read of pipes and standard input here : a read waiting for a silent writer would hang
+    //cancel and the thread exit, only growing files are followed
+    m_isRegularFile = !m_isStandardInput && QFileInfo(path).isFile();
+    if(!m_isRegularFile){
+        return false;
+    }
+    m_file.setFileName(path);
+    return m_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+#endif
+}
+
+void GCodeFollower::closeSource(){
+#ifdef Q_OS_UNIX
+    if(m_fd >= 0 && m_isStandardInput){
+        if(m_savedFlags >= 0){
+            fcntl(m_fd, F_SETFL, m_savedFlags);
+        }
+    }
+    else if(m_fd >= 0){
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_savedFlags = -1;
+#else
+    m_file.close();
+#endif
+}
+
+int GCodeFollower::readSource(char *data, int maxSize){
+#ifdef Q_OS_UNIX
+    ssize_t readSize = ::read(m_fd, data, size_t(maxSize));
+    if(readSize > 0){
+        return int(readSize);
+    }
+    if(readSize < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)){
+        return 0;
+    }
+    if(readSize < 0){
+        return -1;
+    }
+#else
+    qint64 readSize = m_file.read(data, maxSize);
+    if(readSize > 0){
+        return int(readSize);
+    }
+    if(readSize < 0){
+        return -1;
+    }
+#endif
+
+    //End of bytes available : a file may still grow, a pipe is over once its writer closed it
+    if(m_isRegularFile || !m_isDataReceived){
+        return 0;
+    }
+    return -1;
+}
+
+bool GCodeFollower::processBuffer(bool isSourceEnded){
+    int position = 0;
+    bool isEnded = false;
+
+    while(!isEnded && position < m_buffer.size()){
+        const char *rawLine = m_buffer.constData() + position;
+        int available = m_buffer.size() - position;
+
+        //Lines longer than MAX_LINE_LENGTH are split, as when loading a file
+        int maxLength = qMin(available, MAX_LINE_LENGTH - 1);
+        const char *lineEnd = static_cast<const char*>(memchr(rawLine, END_OF_INSTRUCTION, maxLength));
+
+        int rawLength;
+        if(lineEnd != nullptr){
+            rawLength = int(lineEnd - rawLine) + 1;
+        }
+        else if(available >= MAX_LINE_LENGTH - 1 || isSourceEnded){
+            rawLength = maxLength;
+        }
+        else{
+            //Partial line, rest of it is still to be written
+            break;
+        }
+
+        isEnded = appendLine(rawLine,rawLength);
+        position += rawLength;
+    }
+
+    m_buffer.remove(0,position);
+    return isEnded;
+}
+
+bool GCodeFollower::appendLine(const char *rawLine, int rawLength){
+    m_lineCount++;
+    m_batch.lineCount = m_lineCount;
+
+    int start = 0;
+    int length = rawLength;
+    GCodeJob::cleanupLine(rawLine,&start,&length);
+    if(length <= 0){
+        return false;
+    }
+
+    const char *data = rawLine + start;
+    m_batch.data.append(data,length);
+    m_batch.lengths.append(length);
+    m_batch.lineNumbers.append(m_lineCount);
+    m_usefulLineCount++;
+
+    GCodeParser::Block block;
+    GCodeParser::tokenizeLine(data,length,&block);
+    m_parser->executeBlock(block,m_lineCount);
+    m_batch.estimatedTimes.append(m_parser->getMachineTime());
+
+    //End of program : whatever the producer writes next is not part of this job
+    for(int i = 0 ; i < block.wordCount ; i++){
+        if(block.letters[i] == 'M' && (block.values[i] == 2.0f || block.values[i] == 30.0f)){
+            return true;
+        }
+    }
+    return false;
+}
+
+void GCodeFollower::onPrimitiveParsed(int line, QVector<QVector3D> geometry, bool isWork){
+    GCodePrimitive primitive = {line, geometry, isWork};
+    m_primitives.append(primitive);
+}
+
+void GCodeFollower::flushBatch(int followId){
+    //Line count is only set when lines were read since last batch
+    if(m_batch.lineCount != 0){
+        emit linesRead(followId,m_batch);
+        m_batch = GCodeLineBatch();
+    }
+    if(!m_primitives.isEmpty()){
+        emit primitivesParsed(followId,m_primitives);
+        m_primitives.clear();
+    }
+    m_batchTimer.restart();
+}
@@ -0,0 +1,80 @@
+#ifndef GCODEFOLLOWER_H
+#define GCODEFOLLOWER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QVector>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+
+#include "gcodeparser.h"
+#include "gcodefollowedjob.h"
+
+//Reads a gcode source while it is being written : growing file, named pipe, or standard input ("-")
+//Meant to live in a worker thread, lines and geometry are reported in batches until the source ends
+class GCodeFollower : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GCodeFollower(QObject *parent = nullptr);
+
+    //Thread safe : returns the identifier to use for the next follow request
+    int startNewFollow();
+    //Thread safe : stop reading the source
+    void cancel();
+
+    //Thread safe : count of useful lines consumed by the streamer, reading pauses when too far behind
+    void setConsumedLineCount(int count) {m_consumedLineCount.storeRelease(count);}
+
+signals:
+    void linesRead(int followId, GCodeLineBatch batch);
+    void primitivesParsed(int followId, QVector<GCodePrimitive> primitives);
+
+    //Source stopped growing for a while without ending the program : lines read so far are all there is for now
+    void sourceQuiet(int followId);
+
+    //Source ended, or could not be opened at all
+    void finished(int followId, bool isOpened);
+
+public slots:
+    void follow(const QString &path, int followId);
+
+private slots:
+    void onPrimitiveParsed(int line, QVector<QVector3D> geometry, bool isWork);
+
+private:
+    bool isCancelled(int followId) const;
+    bool openSource(const QString &path);
+    void closeSource();
+    int readSource(char *data, int maxSize);
+    bool processBuffer(bool isSourceEnded);
+    bool appendLine(const char *rawLine, int rawLength);
+    void flushBatch(int followId);
+
+#ifdef Q_OS_UNIX
+    int m_fd;               //Raw descriptor, so that pipes can be read without blocking
+    int m_savedFlags;       //Standard input is shared with the rest of the process, its flags are restored
+#else
+    QFile m_file;           //Only regular files there : a pipe read would block cancel and thread exit
+#endif
+    bool m_isStandardInput;
+    bool m_isRegularFile;   //A regular file never ends by itself, it is polled for new bytes
+    bool m_isDataReceived;
+    QElapsedTimer m_quietTimer;     //Since the source last grew
+    bool m_isQuietReported;
+
+    QByteArray m_buffer;        //Bytes read but not yet split in lines
+    int m_lineCount;
+    int m_usefulLineCount;
+
+    GCodeParser* m_parser;
+    GCodeLineBatch m_batch;
+    QVector<GCodePrimitive> m_primitives;
+    QElapsedTimer m_batchTimer;
+
+    QAtomicInt m_currentFollowId;
+    QAtomicInt m_consumedLineCount;
+};
+
+#endif // GCODEFOLLOWER_H
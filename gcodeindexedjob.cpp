@@ -0,0 +1,222 @@
+#include "gcodeindexedjob.h"
+#include "gcodelinereader.h"
+#include "gcodedecompressor.h"
+#include "grbldefinitions.h"
+
+#include <QFileInfo>
+#include <cstring>
+#include <algorithm>
+
+#define MAX_ARENA_SIZE  (0x7FFFFFFFll - 4096)   //Copied lines are held in a single QByteArray
+
+GCodeIndexedJob::GCodeIndexedJob():
+    m_mapping(nullptr),
+    m_arenaOffset(0),
+    m_sourceSize(0),
+    m_isSourceChanged(false),
+    m_lineCount(0)
+{
+
+}
+
+GCodeIndexedJob::~GCodeIndexedJob(){
+    clear();
+}
+
+bool GCodeIndexedJob::load(const QString &path){
+    clear();
+    m_errorString.clear();
+
+    m_sourcePath = path;
+    m_file.setFileName(path);
+    if(!m_file.open(QIODevice::ReadOnly)){
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    //Taken before indexing, so that a change while indexing is seen too
+    QFileInfo sourceInfo(path);
+    m_sourceSize = sourceInfo.size();
+    m_sourceModified = sourceInfo.lastModified();
+
+    //Compressed files are decompressed while read, only their useful lines are kept
+    qint64 size = m_file.size();
+    GCodeDecompressor::Format format = GCodeDecompressor::detectFormat(path);
+    if(format != GCodeDecompressor::format_none && !GCodeDecompressor::isSupported(format)){
+        m_errorString = tr("Compression format not supported by this build");
+        clear();
+        return false;
+    }
+    if(size > 0 && format == GCodeDecompressor::format_none){
+        m_mapping = m_file.map(0,size);
+    }
+
+    //Mapping can fail on some devices (pipes, special files...), fall back to reading lines
+    if(m_mapping != nullptr){
+        indexMappedFile(size);
+    }
+    else if(!indexCopiedFile(path)){
+        clear();
+        return false;
+    }
+
+    m_offsets.squeeze();
+    m_lineNumbers.squeeze();
+    m_lengthsAndFlags.squeeze();
+    return true;
+}
+
+void GCodeIndexedJob::clear(){
+    if(m_mapping != nullptr){
+        m_file.unmap(m_mapping);
+        m_mapping = nullptr;
+    }
+    m_file.close();
+    m_arenaOffset = 0;
+    m_sourceSize = 0;
+    m_sourceModified = QDateTime();
+    m_isSourceChanged = false;
+
+    m_arena.clear();
+    m_offsets.clear();
+    m_lineNumbers.clear();
+    m_lengthsAndFlags.clear();
+    m_estimatedTimes.clear();
+    m_lineCount = 0;
+    m_sourcePath.clear();
+}
+
+QString GCodeIndexedJob::getFileName() const{
+    return QFileInfo(m_sourcePath).baseName();
+}
+
+const char *GCodeIndexedJob::getArena() const{
+    return (m_mapping != nullptr) ? reinterpret_cast<const char*>(m_mapping) + m_arenaOffset : m_arena.constData();
+}
+
+const char *GCodeIndexedJob::getLineData(int index, int *length){
+    *length = m_lengthsAndFlags.at(index) & LINE_LENGTH_MASK;
+    return getArena() + m_offsets.at(index);
+}
+
+GrblInstruction GCodeIndexedJob::getInstruction(int index){
+    int length;
+    const char *data = getLineData(index,&length);
+    quint16 flags = m_lengthsAndFlags.at(index);
+
+    if(flags & LINE_FLAG_REALTIME_COMMAND){
+        return GrblInstruction::fromRawData(data, length, m_lineNumbers.at(index));
+    }
+    return GrblInstruction::fromRawData(data, length, m_lineNumbers.at(index), (flags & LINE_FLAG_BLOCKING) != 0);
+}
+
+int GCodeIndexedJob::indexOfOffset(qint64 offset) const{
+    //Offsets of a copied or cached job do not match the source file
+    if(m_mapping == nullptr || m_arenaOffset != 0 || m_offsets.isEmpty()){
+        return 0;
+    }
+
+    QVector<quint32>::const_iterator next = std::upper_bound(m_offsets.constBegin(), m_offsets.constEnd(), quint32(qMin<qint64>(offset, 0xFFFFFFFF)));
+    return qMax(int(next - m_offsets.constBegin()) - 1, 0);
+}
+
+quint32 GCodeIndexedJob::getEstimatedTime(int index){
+    return (index < m_estimatedTimes.size()) ? m_estimatedTimes.at(index) : 0;
+}
+
+bool GCodeIndexedJob::isSourceChanged(){
+    //Copied lines and lines mapped from the cache do not depend on the source any more
+    if(m_mapping == nullptr || m_arenaOffset != 0){
+        return false;
+    }
+
+    if(!m_isSourceChanged){
+        QFileInfo sourceInfo(m_sourcePath);
+        m_isSourceChanged = !sourceInfo.exists() || sourceInfo.size() != m_sourceSize || sourceInfo.lastModified() != m_sourceModified;
+    }
+    return m_isSourceChanged;
+}
+
+void GCodeIndexedJob::setSourceChanged(){
+    m_isSourceChanged = true;
+}
+
+int GCodeIndexedJob::indexOfLine(int line){
+    if(m_lineNumbers.isEmpty()){
+        return 0;
+    }
+
+    //Line numbers are strictly increasing, so a binary search finds the first useful line numbered 'line' or more
+    QVector<qint32>::const_iterator found = std::lower_bound(m_lineNumbers.constBegin(), m_lineNumbers.constEnd(), line);
+
+    //Past last line, stick to last line
+    return qMin(int(found - m_lineNumbers.constBegin()), m_lineNumbers.size()-1);
+}
+
+void GCodeIndexedJob::indexMappedFile(qint64 size){
+    const char *data = reinterpret_cast<const char*>(m_mapping);
+    qint64 position = 0;
+
+    while(position < size){
+        //Lines longer than MAX_LINE_LENGTH are split, as QIODevice::readLine(MAX_LINE_LENGTH) would do
+        qint64 maxLength = qMin<qint64>(size - position, MAX_LINE_LENGTH - 1);
+        const char *lineEnd = static_cast<const char*>(memchr(data + position, END_OF_INSTRUCTION, maxLength));
+        int rawLength = (lineEnd != nullptr) ? int(lineEnd - (data + position)) + 1 : int(maxLength);
+
+        int start = 0;
+        int length = rawLength;
+        cleanupLine(data + position, &start, &length);
+
+        m_lineCount++;
+
+        //No need to index a useless line
+        if(length > 0){
+            appendLine(data + position + start, quint32(position + start), length, m_lineCount);
+        }
+
+        position += rawLength;
+    }
+}
+
+bool GCodeIndexedJob::indexCopiedFile(const QString &path){
+    GCodeLineReader reader;
+    if(!reader.open(path)){
+        m_errorString = reader.getErrorString();
+        return false;
+    }
+
+    //Only useful part of the lines is kept
+    GCodeLine line;
+    while(reader.readLine(&line)){
+        //Compressed files are never windowed, since they can not be read back at random positions
+        if(m_arena.size() + qint64(line.length) > MAX_ARENA_SIZE){
+            m_errorString = tr("Content too large to be held in memory, decompress the file first");
+            return false;
+        }
+
+        appendLine(line.data, quint32(m_arena.size()), line.length, line.lineNumber);
+        m_arena.append(line.data, line.length);
+    }
+
+    if(reader.isFailed()){
+        m_errorString = reader.getErrorString();
+        return false;
+    }
+
+    m_lineCount = reader.getLineCount();
+    return true;
+}
+
+void GCodeIndexedJob::appendLine(const char *data, quint32 offset, int length, int lineNumber){
+    quint16 lengthAndFlags = quint16(length) & LINE_LENGTH_MASK;
+    if(GrblInstruction::isBlockingInstruction(data, length)){
+        lengthAndFlags |= LINE_FLAG_BLOCKING;
+    }
+    if(GrblInstruction::containsRealtimeCommand(data, length)){
+        lengthAndFlags |= LINE_FLAG_REALTIME_COMMAND;
+    }
+
+    m_offsets.append(offset);
+    m_lineNumbers.append(lineNumber);
+    m_lengthsAndFlags.append(lengthAndFlags);
+}
@@ -0,0 +1,86 @@
+#ifndef GCODEINDEXEDJOB_H
+#define GCODEINDEXEDJOB_H
+
+#include <QFile>
+#include <QDateTime>
+#include <QVector>
+#include <QByteArray>
+#include <QCoreApplication>
+
+#include "gcodejob.h"
+
+//Holds a gcode file as a compact index of useful lines, stored as separate arrays (about 10 bytes per line)
+//When possible the file is memory-mapped, and instructions are views pointing into the mapping
+class GCodeIndexedJob : public GCodeJob
+{
+    Q_DECLARE_TR_FUNCTIONS(GCodeIndexedJob)
+public:
+    GCodeIndexedJob();
+    ~GCodeIndexedJob();
+
+    //False if the file can not be read to its end, or holds more than fits in memory
+    bool load(const QString &path);
+    QString getErrorString() const {return m_errorString;}
+
+    void clear() Q_DECL_OVERRIDE;
+
+    QString getFileName() const Q_DECL_OVERRIDE;
+
+    int size() const Q_DECL_OVERRIDE {return m_lineNumbers.size();}
+    int getLineCount() const Q_DECL_OVERRIDE {return m_lineCount;}
+
+    int getLineNumber(int index) Q_DECL_OVERRIDE {return m_lineNumbers.at(index);}
+
+    //Returned instruction does not own its bytes, detach it if it must outlive the job
+    GrblInstruction getInstruction(int index) Q_DECL_OVERRIDE;
+
+    const char *getLineData(int index, int *length) Q_DECL_OVERRIDE;
+
+    int indexOfLine(int line) Q_DECL_OVERRIDE;
+
+    //Index of the useful line holding byte at offset in source file, or of the last one before it
+    //Only meaningful when job maps its source file, 0 otherwise
+    int indexOfOffset(qint64 offset) const;
+
+    quint32 getEstimatedTime(int index) Q_DECL_OVERRIDE;
+
+    //Only a job mapping its source file reads it after load
+    bool isSourceChanged() Q_DECL_OVERRIDE;
+    void setSourceChanged() Q_DECL_OVERRIDE;
+    void setEstimatedTimes(const QVector<quint32> &estimatedTimes) {m_estimatedTimes = estimatedTimes;}
+
+private:
+    friend class GCodeJobCache;
+
+    enum LineFlags{
+        LINE_LENGTH_MASK            = 0x01FF,
+        LINE_FLAG_BLOCKING          = 0x8000,
+        LINE_FLAG_REALTIME_COMMAND  = 0x4000    //Line must be cleaned, hence copied, when materialized
+    };
+
+    void indexMappedFile(qint64 size);
+    bool indexCopiedFile(const QString &path);
+    void appendLine(const char *data, quint32 offset, int length, int lineNumber);
+    const char *getArena() const;
+
+    QString m_sourcePath;
+    QString m_errorString;
+    QFile m_file;           //Source file, or cache file when job was loaded from cache
+    uchar *m_mapping;
+    qint64 m_arenaOffset;   //Start of lines in mapping
+    QByteArray m_arena;     //Used when file cannot be mapped
+    qint64 m_sourceSize;            //Source file as it was indexed
+    QDateTime m_sourceModified;
+    bool m_isSourceChanged;
+
+    //One entry per useful line in each array
+    QVector<quint32> m_offsets;             //Start of line in arena
+    QVector<qint32> m_lineNumbers;
+    QVector<quint16> m_lengthsAndFlags;     //Line length, and flags computed once at load
+    QVector<quint32> m_estimatedTimes;      //Machine time once line is executed, empty if not estimated
+    int m_lineCount;
+
+    Q_DISABLE_COPY(GCodeIndexedJob)
+};
+
+#endif // GCODEINDEXEDJOB_H
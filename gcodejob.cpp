@@ -0,0 +1,30 @@
+#include "gcodejob.h"
+#include "grbldefinitions.h"
+
+#include <cstring>
+#include <cctype>
+
+const char *GCodeJob::s_gcodeCommentsDelimiters[] = {GCODE_COMMENTS_DELIM};
+
+void GCodeJob::cleanupLine(const char *data, int *start, int *length){
+    int end = *start + *length;
+
+    //Cut at first comment delimiter
+    int commentDelimiterCount = sizeof(s_gcodeCommentsDelimiters)/sizeof(s_gcodeCommentsDelimiters[0]);
+    for(int i = 0 ; i < commentDelimiterCount ; i++){
+        const char *delimiter = static_cast<const char*>(memchr(data + *start, s_gcodeCommentsDelimiters[i][0], end - *start));
+        if(delimiter != nullptr){
+            end = int(delimiter - data);
+        }
+    }
+
+    //remove any start / and whitespace and special character
+    while(*start < end && isspace(static_cast<unsigned char>(data[*start]))){
+        (*start)++;
+    }
+    while(end > *start && isspace(static_cast<unsigned char>(data[end-1]))){
+        end--;
+    }
+
+    *length = end - *start;
+}
@@ -0,0 +1,57 @@
+#ifndef GCODEJOB_H
+#define GCODEJOB_H
+
+#include <QString>
+
+#include "grblinstruction.h"
+
+//Gives access to the useful lines of a gcode file, whatever the way they are stored
+class GCodeJob
+{
+public:
+    virtual ~GCodeJob() {}
+
+    virtual void clear() = 0;
+
+    virtual QString getFileName() const = 0;
+
+    bool isEmpty() const {return size() == 0;}
+    virtual int size() const = 0;
+
+    //Count of lines in file, including useless ones
+    virtual int getLineCount() const = 0;
+
+    //False while lines may still be appended to the job
+    virtual bool isComplete() const {return true;}
+
+    virtual int getLineNumber(int index) = 0;
+
+    //Returned instruction may not own its bytes, detach it if it must be kept
+    virtual GrblInstruction getInstruction(int index) = 0;
+
+    //Raw bytes of a useful line, without line return, for linear passes over the job. Valid until next access
+    virtual const char *getLineData(int index, int *length) = 0;
+
+    //Index of the first useful line numbered 'line' or more, last index if there is none
+    virtual int indexOfLine(int line) = 0;
+
+    //Estimated machine time (ms) elapsed once useful line at index is executed, 0 if unknown
+    virtual quint32 getEstimatedTime(int index) {Q_UNUSED(index); return 0;}
+
+    //Hint that instructions will soon be requested from index onwards
+    virtual void prefetch(int index) {Q_UNUSED(index);}
+
+    //True once the file lines are still read from was changed on disk : lines not handed out yet may belong
+    //to another program, or lie past its end. Jobs holding their lines in memory never change
+    virtual bool isSourceChanged() {return false;}
+    //File watcher saw a change, which size and modification time may not show yet
+    virtual void setSourceChanged() {}
+
+    //Narrow [*start;*start+*length[ to the useful part of a gcode line
+    static void cleanupLine(const char *data, int *start, int *length);
+
+private:
+    static const char *s_gcodeCommentsDelimiters[];
+};
+
+#endif // GCODEJOB_H
@@ -0,0 +1,414 @@
+#include "gcodejobcache.h"
+#include "gcodeindexedjob.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QHash>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+#define CACHE_MAGIC             "GCODEBIN"
+#define CACHE_VERSION           2           //Increment whenever layout or parsing results change
+#define CACHE_EXTENSION         ".gcbin"
+#define CACHE_DIRECTORY         "jobs"
+#define CACHE_MAX_FILES         32          //Older cache files are removed beyond this count
+#define CACHE_KEY_SIZE          16
+#define CACHE_SECTION_ALIGNMENT 8
+#define CHUNK_SIZE              (64 * 1024)     //Granularity of change detection between two versions of a file
+
+//File starts with this header, followed by sections each aligned on CACHE_SECTION_ALIGNMENT :
+//  arena, line offsets, line numbers, line lengths and flags, estimated times,
+//  primitive lines, primitive vertex starts, primitive work flags, vertices, parser states
+//Values are stored in host byte order, cache files are not meant to be shared between machines
+struct GCodeCacheHeader{
+    char magic[8];
+    quint32 version;
+    quint32 lineCount;
+    quint32 usefulLineCount;
+    quint32 arenaSize;
+    quint32 primitiveCount;
+    quint32 vertexCount;
+    quint32 parserStateCount;
+    quint32 machineTime;
+    float boundsMin[3];
+    float boundsMax[3];
+    char key[CACHE_KEY_SIZE];
+};
+
+Q_STATIC_ASSERT(sizeof(QVector3D) == 3 * sizeof(float));
+
+static qint64 alignSection(qint64 position){
+    return (position + CACHE_SECTION_ALIGNMENT - 1) & ~qint64(CACHE_SECTION_ALIGNMENT - 1);
+}
+
+static bool writeSection(QIODevice *device, const void *data, qint64 size){
+    static const char padding[CACHE_SECTION_ALIGNMENT] = {0};
+
+    if(size > 0 && device->write(static_cast<const char*>(data), size) != size){
+        return false;
+    }
+    qint64 paddingSize = alignSection(device->pos()) - device->pos();
+    return device->write(padding, paddingSize) == paddingSize;
+}
+
+//Reserve a section of sectionSize bytes at *position, false if it does not fit in file
+static bool takeSection(qint64 *position, qint64 sectionSize, qint64 fileSize, qint64 *sectionOffset){
+    *sectionOffset = *position;
+    *position = alignSection(*position + sectionSize);
+    return *sectionOffset + sectionSize <= fileSize;
+}
+
+template<typename T>
+static void copySection(const char *data, qint64 offset, int count, QVector<T> *vector){
+    vector->resize(count);
+    if(count > 0){
+        memcpy(vector->data(), data + offset, size_t(count) * sizeof(T));
+    }
+}
+
+//Field of a parser state as stored in the file, read as its integer type so that it can be checked before use
+template<typename T>
+static bool isStateFieldInRange(const char *state, size_t offset, T lastValue){
+    typename std::underlying_type<T>::type value;
+    memcpy(&value, state + offset, sizeof(value));
+    return qint64(value) >= 0 && qint64(value) <= qint64(lastValue);
+}
+
+//Parsing resumes from these states, anything out of range would index the parser's tables out of bounds
+static bool isParserStateValid(const char *state){
+    quint8 isCurrentPosValid;
+    memcpy(&isCurrentPosValid, state + offsetof(GCodeParser::State, isCurrentPosValid), sizeof(isCurrentPosValid));
+
+    return isStateFieldInRange(state, offsetof(GCodeParser::State, g0NonModal), GCodeParser::NON_MODAL_RESET_COORDINATE_OFFSET)
+            && isStateFieldInRange(state, offsetof(GCodeParser::State, g1Motion), GCodeParser::MOTION_MODE_NONE)
+            && isStateFieldInRange(state, offsetof(GCodeParser::State, g2Plane), GCodeParser::PLANE_SELECT_YZ)
+            && isStateFieldInRange(state, offsetof(GCodeParser::State, g3Distance), GCodeParser::DISTANCE_MODE_INCREMENTAL)
+            && isStateFieldInRange(state, offsetof(GCodeParser::State, g6Units), GCodeParser::UNITS_MODE_INCHES)
+            && isCurrentPosValid <= 1;
+}
+
+GCodeJobCache::GCodeJobCache():
+    m_machineTime(0)
+{
+
+}
+
+QByteArray GCodeJobCache::computeKey(const QString &path, QVector<uint> *chunkHashes){
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)){
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    if(chunkHashes == nullptr){
+        if(!hash.addData(&file)){
+            return QByteArray();
+        }
+        return hash.result();
+    }
+
+    chunkHashes->clear();
+    QByteArray chunk;
+    do{
+        chunk = file.read(CHUNK_SIZE);
+        if(!chunk.isEmpty()){
+            hash.addData(chunk);
+            chunkHashes->append(qHashBits(chunk.constData(), size_t(chunk.size())));
+        }
+    }while(chunk.size() == CHUNK_SIZE);
+
+    if(!file.atEnd()){
+        return QByteArray();
+    }
+    return hash.result();
+}
+
+qint64 GCodeJobCache::findFirstChange(const QVector<uint> &previousChunkHashes, const QVector<uint> &chunkHashes){
+    int commonChunkCount = qMin(previousChunkHashes.size(), chunkHashes.size());
+    for(int i = 0 ; i < commonChunkCount ; i++){
+        if(previousChunkHashes.at(i) != chunkHashes.at(i)){
+            return qint64(i) * CHUNK_SIZE;
+        }
+    }
+
+    //One file is the beginning of the other : last chunk of the shortest one differs, or it is complete and data was appended / removed after it
+    if(previousChunkHashes.size() != chunkHashes.size()){
+        return qint64(qMax(commonChunkCount - 1, 0)) * CHUNK_SIZE;
+    }
+    return -1;
+}
+
+QString GCodeJobCache::getCachePath(const QByteArray &key){
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return QDir(directory).filePath(QStringLiteral(CACHE_DIRECTORY "/") + QString::fromLatin1(key.toHex()) + QStringLiteral(CACHE_EXTENSION));
+}
+
+void GCodeJobCache::clear(){
+    m_primitiveLines.clear();
+    m_primitiveVertexStarts.clear();
+    m_primitiveWork.clear();
+    m_vertices.clear();
+    m_parserStates.clear();
+    m_boundsMin = QVector3D();
+    m_boundsMax = QVector3D();
+    m_machineTime = 0;
+}
+
+void GCodeJobCache::appendPrimitive(const GCodePrimitive &primitive){
+    if(m_primitiveVertexStarts.isEmpty()){
+        m_primitiveVertexStarts.append(0);
+    }
+
+    for(int i = 0 ; i < primitive.geometry.size() ; i++){
+        updateBounds(primitive.geometry.at(i));
+        m_vertices.append(primitive.geometry.at(i));
+    }
+
+    m_primitiveLines.append(primitive.line);
+    m_primitiveWork.append(primitive.isWork ? 1 : 0);
+    m_primitiveVertexStarts.append(quint32(m_vertices.size()));
+}
+
+void GCodeJobCache::updateBounds(const QVector3D &vertex){
+    //Bounds are updated before vertex is appended
+    if(m_vertices.isEmpty()){
+        m_boundsMin = vertex;
+        m_boundsMax = vertex;
+    }
+    else{
+        m_boundsMin = QVector3D(qMin(m_boundsMin.x(),vertex.x()), qMin(m_boundsMin.y(),vertex.y()), qMin(m_boundsMin.z(),vertex.z()));
+        m_boundsMax = QVector3D(qMax(m_boundsMax.x(),vertex.x()), qMax(m_boundsMax.y(),vertex.y()), qMax(m_boundsMax.z(),vertex.z()));
+    }
+}
+
+void GCodeJobCache::truncate(int firstLine, int parserStateCount){
+    if(parserStateCount < m_parserStates.size()){
+        m_parserStates.resize(parserStateCount);
+    }
+
+    //Primitives are stored in line order
+    int primitiveCount = int(std::lower_bound(m_primitiveLines.constBegin(), m_primitiveLines.constEnd(), firstLine) - m_primitiveLines.constBegin());
+    if(primitiveCount == m_primitiveLines.size()){
+        return;
+    }
+
+    m_primitiveLines.resize(primitiveCount);
+    m_primitiveWork.resize(primitiveCount);
+    m_primitiveVertexStarts.resize(primitiveCount + 1);
+
+    //Bounds can only be computed again from remaining vertices
+    QVector<QVector3D> vertices = m_vertices.mid(0, int(m_primitiveVertexStarts.last()));
+    m_vertices.clear();
+    m_vertices.reserve(vertices.size());
+    for(int i = 0 ; i < vertices.size() ; i++){
+        updateBounds(vertices.at(i));
+        m_vertices.append(vertices.at(i));
+    }
+}
+
+GCodePrimitive GCodeJobCache::getPrimitive(int index) const{
+    GCodePrimitive primitive;
+    primitive.line = m_primitiveLines.at(index);
+    primitive.isWork = m_primitiveWork.at(index) != 0;
+
+    int start = int(m_primitiveVertexStarts.at(index));
+    int end = int(m_primitiveVertexStarts.at(index+1));
+    primitive.geometry.reserve(end - start);
+    for(int i = start ; i < end ; i++){
+        primitive.geometry.append(m_vertices.at(i));
+    }
+    return primitive;
+}
+
+bool GCodeJobCache::save(const QString &cachePath, const QByteArray &key, const GCodeIndexedJob &job) const{
+    int lineTotal = job.m_lineNumbers.size();
+    if(key.size() != CACHE_KEY_SIZE || job.m_estimatedTimes.size() != lineTotal){
+        return false;
+    }
+
+    QFileInfo cacheInfo(cachePath);
+    if(!QDir().mkpath(cacheInfo.absolutePath())){
+        return false;
+    }
+
+    //Only cleaned lines are kept, packed one after the other
+    QVector<quint32> offsets;
+    offsets.reserve(lineTotal);
+    quint32 arenaSize = 0;
+    for(int i = 0 ; i < lineTotal ; i++){
+        offsets.append(arenaSize);
+        arenaSize += job.m_lengthsAndFlags.at(i) & GCodeIndexedJob::LINE_LENGTH_MASK;
+    }
+
+    GCodeCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.lineCount = quint32(job.m_lineCount);
+    header.usefulLineCount = quint32(lineTotal);
+    header.arenaSize = arenaSize;
+    header.primitiveCount = quint32(m_primitiveLines.size());
+    header.vertexCount = quint32(m_vertices.size());
+    header.parserStateCount = quint32(m_parserStates.size());
+    header.machineTime = m_machineTime;
+    for(int i = 0 ; i < 3 ; i++){
+        header.boundsMin[i] = m_boundsMin[i];
+        header.boundsMax[i] = m_boundsMax[i];
+    }
+    memcpy(header.key, key.constData(), CACHE_KEY_SIZE);
+
+    //Cache file is replaced atomically, a reader never sees a partial file
+    QSaveFile file(cachePath);
+    if(!file.open(QIODevice::WriteOnly)){
+        return false;
+    }
+
+    bool isWritten = writeSection(&file, &header, sizeof(header));
+
+    for(int i = 0 ; isWritten && i < lineTotal ; i++){
+        int length = job.m_lengthsAndFlags.at(i) & GCodeIndexedJob::LINE_LENGTH_MASK;
+        isWritten = (file.write(job.getArena() + job.m_offsets.at(i), length) == length);
+    }
+    isWritten = isWritten && writeSection(&file, nullptr, 0);
+
+    //Primitive vertex starts are written even when empty, so that the section always has primitiveCount+1 entries
+    quint32 noVertex = 0;
+    isWritten = isWritten
+            && writeSection(&file, offsets.constData(), qint64(lineTotal) * sizeof(quint32))
+            && writeSection(&file, job.m_lineNumbers.constData(), qint64(lineTotal) * sizeof(qint32))
+            && writeSection(&file, job.m_lengthsAndFlags.constData(), qint64(lineTotal) * sizeof(quint16))
+            && writeSection(&file, job.m_estimatedTimes.constData(), qint64(lineTotal) * sizeof(quint32))
+            && writeSection(&file, m_primitiveLines.constData(), qint64(m_primitiveLines.size()) * sizeof(qint32))
+            && (m_primitiveVertexStarts.isEmpty() ? writeSection(&file, &noVertex, sizeof(noVertex))
+                                                  : writeSection(&file, m_primitiveVertexStarts.constData(), qint64(m_primitiveVertexStarts.size()) * sizeof(quint32)))
+            && writeSection(&file, m_primitiveWork.constData(), qint64(m_primitiveWork.size()) * sizeof(quint8))
+            && writeSection(&file, m_vertices.constData(), qint64(m_vertices.size()) * sizeof(QVector3D))
+            && writeSection(&file, m_parserStates.constData(), qint64(m_parserStates.size()) * sizeof(GCodeParser::State));
+
+    if(!isWritten){
+        file.cancelWriting();
+        return false;
+    }
+    if(!file.commit()){
+        return false;
+    }
+
+    //Keep cache directory bounded, most recently written files are kept
+    QFileInfoList cacheFiles = cacheInfo.absoluteDir().entryInfoList(QStringList(QStringLiteral("*" CACHE_EXTENSION)), QDir::Files, QDir::Time);
+    for(int i = CACHE_MAX_FILES ; i < cacheFiles.size() ; i++){
+        QFile::remove(cacheFiles.at(i).absoluteFilePath());
+    }
+
+    return true;
+}
+
+GCodeIndexedJob *GCodeJobCache::load(const QString &cachePath, const QByteArray &key, const QString &sourcePath){
+    clear();
+
+    if(key.size() != CACHE_KEY_SIZE || !QFile::exists(cachePath)){
+        return nullptr;
+    }
+
+    GCodeIndexedJob* job = new GCodeIndexedJob();
+    job->m_sourcePath = sourcePath;
+    job->m_file.setFileName(cachePath);
+
+    //Cache file is mapped, cleaned lines are used straight from the mapping
+    qint64 fileSize = 0;
+    if(job->m_file.open(QIODevice::ReadOnly)){
+        fileSize = job->m_file.size();
+        if(fileSize >= qint64(sizeof(GCodeCacheHeader))){
+            job->m_mapping = job->m_file.map(0,fileSize);
+        }
+    }
+    if(job->m_mapping == nullptr){
+        delete job;
+        return nullptr;
+    }
+
+    const char *data = reinterpret_cast<const char*>(job->m_mapping);
+    GCodeCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    if(memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0
+            || header.version != CACHE_VERSION
+            || memcmp(header.key, key.constData(), CACHE_KEY_SIZE) != 0){
+        delete job;
+        return nullptr;
+    }
+
+    qint64 lineTotal = header.usefulLineCount;
+    qint64 primitiveTotal = header.primitiveCount;
+    qint64 arenaOffset, offsetsOffset, lineNumbersOffset, lengthsOffset, timesOffset;
+    qint64 primitiveLinesOffset, vertexStartsOffset, primitiveWorkOffset, verticesOffset, parserStatesOffset;
+
+    qint64 position = alignSection(sizeof(header));
+    bool isValid = takeSection(&position, header.arenaSize, fileSize, &arenaOffset)
+            && takeSection(&position, lineTotal * sizeof(quint32), fileSize, &offsetsOffset)
+            && takeSection(&position, lineTotal * sizeof(qint32), fileSize, &lineNumbersOffset)
+            && takeSection(&position, lineTotal * sizeof(quint16), fileSize, &lengthsOffset)
+            && takeSection(&position, lineTotal * sizeof(quint32), fileSize, &timesOffset)
+            && takeSection(&position, primitiveTotal * sizeof(qint32), fileSize, &primitiveLinesOffset)
+            && takeSection(&position, (primitiveTotal + 1) * sizeof(quint32), fileSize, &vertexStartsOffset)
+            && takeSection(&position, primitiveTotal * sizeof(quint8), fileSize, &primitiveWorkOffset)
+            && takeSection(&position, qint64(header.vertexCount) * sizeof(QVector3D), fileSize, &verticesOffset)
+            && takeSection(&position, qint64(header.parserStateCount) * sizeof(GCodeParser::State), fileSize, &parserStatesOffset);
+
+    //Parser states are checked as raw bytes, before being copied into fields they could hold invalid values for
+    for(quint32 i = 0 ; isValid && i < header.parserStateCount ; i++){
+        isValid = isParserStateValid(data + parserStatesOffset + qint64(i) * qint64(sizeof(GCodeParser::State)));
+    }
+
+    if(!isValid){
+        delete job;
+        return nullptr;
+    }
+
+    job->m_arenaOffset = arenaOffset;
+    job->m_lineCount = int(header.lineCount);
+    copySection(data, offsetsOffset, int(lineTotal), &job->m_offsets);
+    copySection(data, lineNumbersOffset, int(lineTotal), &job->m_lineNumbers);
+    copySection(data, lengthsOffset, int(lineTotal), &job->m_lengthsAndFlags);
+    copySection(data, timesOffset, int(lineTotal), &job->m_estimatedTimes);
+
+    copySection(data, primitiveLinesOffset, int(primitiveTotal), &m_primitiveLines);
+    copySection(data, vertexStartsOffset, int(primitiveTotal + 1), &m_primitiveVertexStarts);
+    copySection(data, primitiveWorkOffset, int(primitiveTotal), &m_primitiveWork);
+    copySection(data, verticesOffset, int(header.vertexCount), &m_vertices);
+    copySection(data, parserStatesOffset, int(header.parserStateCount), &m_parserStates);
+
+    //A corrupted index must not let the job read outside the arena, computed wide so that it can not wrap
+    //Line numbers are searched by bisection, they must be increasing and within the file
+    qint64 previousLine = 0;
+    for(int i = 0 ; isValid && i < lineTotal ; i++){
+        qint64 line = job->m_lineNumbers.at(i);
+        isValid = qint64(job->m_offsets.at(i)) + (job->m_lengthsAndFlags.at(i) & GCodeIndexedJob::LINE_LENGTH_MASK) <= qint64(header.arenaSize)
+                && line > previousLine && line <= qint64(header.lineCount);
+        previousLine = line;
+    }
+    previousLine = 0;
+    for(int i = 0 ; isValid && i < primitiveTotal ; i++){
+        qint64 line = m_primitiveLines.at(i);
+        isValid = m_primitiveVertexStarts.at(i) <= m_primitiveVertexStarts.at(i+1)
+                && line >= previousLine && line <= qint64(header.lineCount);
+        previousLine = line;
+    }
+    isValid = isValid && m_primitiveVertexStarts.last() == header.vertexCount;
+
+    if(!isValid){
+        clear();
+        delete job;
+        return nullptr;
+    }
+
+    m_boundsMin = QVector3D(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    m_boundsMax = QVector3D(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    m_machineTime = header.machineTime;
+    return job;
+}
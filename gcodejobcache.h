@@ -0,0 +1,70 @@
+#ifndef GCODEJOBCACHE_H
+#define GCODEJOBCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QVector3D>
+
+#include "gcodeparser.h"
+
+class GCodeIndexedJob;
+
+//Versioned binary image of a parsed job : cleaned lines, geometry, estimated times and bounding box
+//Cache files are named after a hash of the gcode content, so that an edited file never hits a stale cache
+class GCodeJobCache
+{
+public:
+    GCodeJobCache();
+
+    //Empty key if file cannot be read. Hashes of fixed size chunks of the file can be computed in the same pass
+    static QByteArray computeKey(const QString &path, QVector<uint> *chunkHashes = nullptr);
+    static QString getCachePath(const QByteArray &key);
+
+    //Offset of the first byte that may differ between two versions of a file, -1 if chunks are all the same
+    static qint64 findFirstChange(const QVector<uint> &previousChunkHashes, const QVector<uint> &chunkHashes);
+
+    void clear();
+
+    //Geometry is accumulated while the file is parsed, in a compact form
+    void appendPrimitive(const GCodePrimitive &primitive);
+
+    int getPrimitiveCount() const {return m_primitiveLines.size();}
+    GCodePrimitive getPrimitive(int index) const;
+
+    //Parser states are recorded at regular intervals of useful lines
+    void appendParserState(const GCodeParser::State &state) {m_parserStates.append(state);}
+    int getParserStateCount() const {return m_parserStates.size();}
+    GCodeParser::State getParserState(int index) const {return m_parserStates.at(index);}
+
+    //Drop geometry from line firstLine onwards, and parser states from parserStateCount onwards
+    void truncate(int firstLine, int parserStateCount);
+
+    bool hasBounds() const {return !m_vertices.isEmpty();}
+    QVector3D getBoundsMin() const {return m_boundsMin;}
+    QVector3D getBoundsMax() const {return m_boundsMax;}
+
+    quint32 getMachineTime() const {return m_machineTime;}
+    void setMachineTime(quint32 machineTime) {m_machineTime = machineTime;}
+
+    bool save(const QString &cachePath, const QByteArray &key, const GCodeIndexedJob &job) const;
+
+    //Returns nullptr if cache is missing, outdated or corrupted. Geometry is loaded in this object
+    GCodeIndexedJob* load(const QString &cachePath, const QByteArray &key, const QString &sourcePath);
+
+private:
+    void updateBounds(const QVector3D &vertex);
+
+    QVector<qint32> m_primitiveLines;
+    QVector<quint32> m_primitiveVertexStarts;   //One more entry than primitives, last one is vertex count
+    QVector<quint8> m_primitiveWork;
+    QVector<QVector3D> m_vertices;
+    QVector<GCodeParser::State> m_parserStates;
+
+    QVector3D m_boundsMin;
+    QVector3D m_boundsMax;
+
+    quint32 m_machineTime;
+};
+
+#endif // GCODEJOBCACHE_H
@@ -0,0 +1,125 @@
+#include "gcodelinereader.h"
+#include "gcodejob.h"
+#include "gcodedecompressor.h"
+#include "grbldefinitions.h"
+
+#include <QFile>
+#include <cstring>
+
+#define READ_CHUNK_SIZE     65536
+
+GCodeLineReader::GCodeLineReader():
+    m_isCompressed(false),
+    m_isFailed(false),
+    m_bufferPosition(0),
+    m_bufferFileOffset(0),
+    m_lineCount(0)
+{
+
+}
+
+bool GCodeLineReader::open(const QString &path){
+    m_isCompressed = (GCodeDecompressor::detectFormat(path) != GCodeDecompressor::format_none);
+    if(m_isCompressed){
+        m_device.reset(new GCodeDecompressor(path));
+    }
+    else{
+        m_device.reset(new QFile(path));
+    }
+
+    return m_device->open(QIODevice::ReadOnly) && seek(0,0);
+}
+
+bool GCodeLineReader::seek(qint64 fileOffset, int lineCount){
+    m_buffer.clear();
+    m_bufferPosition = 0;
+    m_bufferFileOffset = fileOffset;
+    m_lineCount = lineCount;
+    m_isFailed = false;
+
+    //Decompression can only go forward
+    if(m_isCompressed){
+        return fileOffset == 0;
+    }
+    return m_device->seek(fileOffset);
+}
+
+qint64 GCodeLineReader::getFilePosition() const{
+    if(m_isCompressed){
+        return static_cast<GCodeDecompressor*>(m_device.data())->getCompressedPosition();
+    }
+    return getPosition();
+}
+
+qint64 GCodeLineReader::getFileSize() const{
+    if(m_isCompressed){
+        return static_cast<GCodeDecompressor*>(m_device.data())->getCompressedSize();
+    }
+    return m_device->size();
+}
+
+bool GCodeLineReader::fillBuffer(){
+    //Drop consumed bytes, only the beginning of a line can remain
+    m_buffer.remove(0,m_bufferPosition);
+    m_bufferFileOffset += m_bufferPosition;
+    m_bufferPosition = 0;
+
+    QByteArray chunk = m_device->read(READ_CHUNK_SIZE);
+    if(chunk.isEmpty()){
+        if(m_isCompressed){
+            m_isFailed = static_cast<GCodeDecompressor*>(m_device.data())->isFailed();
+        }
+        else{
+            m_isFailed = (static_cast<QFile*>(m_device.data())->error() != QFileDevice::NoError);
+        }
+        return false;
+    }
+
+    m_buffer.append(chunk);
+    return true;
+}
+
+bool GCodeLineReader::readLine(GCodeLine *line){
+    forever{
+        int available = m_buffer.size() - m_bufferPosition;
+        const char *rawLine = m_buffer.constData() + m_bufferPosition;
+
+        //Lines longer than MAX_LINE_LENGTH are split, as QIODevice::readLine(MAX_LINE_LENGTH) would do
+        int maxLength = qMin(available, MAX_LINE_LENGTH - 1);
+        const char *lineEnd = static_cast<const char*>(memchr(rawLine, END_OF_INSTRUCTION, maxLength));
+
+        int rawLength;
+        if(lineEnd != nullptr){
+            rawLength = int(lineEnd - rawLine) + 1;
+        }
+        else if(available >= MAX_LINE_LENGTH - 1){
+            rawLength = MAX_LINE_LENGTH - 1;
+        }
+        else if(fillBuffer()){
+            continue;
+        }
+        else if(available > 0){
+            rawLength = available;      //Last line, without line return
+        }
+        else{
+            return false;
+        }
+
+        qint64 rawLineOffset = getPosition();
+        m_bufferPosition += rawLength;
+        m_lineCount++;
+
+        int start = 0;
+        int length = rawLength;
+        GCodeJob::cleanupLine(rawLine,&start,&length);
+
+        //No need to return a useless line
+        if(length > 0){
+            line->data = rawLine + start;
+            line->length = length;
+            line->lineNumber = m_lineCount;
+            line->fileOffset = rawLineOffset;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef GCODELINEREADER_H
+#define GCODELINEREADER_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QScopedPointer>
+
+//Useful part of a gcode line, as returned by GCodeLineReader
+struct GCodeLine{
+    const char *data;       //Valid until next read
+    int length;
+    int lineNumber;
+    qint64 fileOffset;      //Start of the raw line in file
+};
+
+//Sequentially reads the useful lines of a gcode file through a small buffer
+//Compressed files are decompressed on the fly, they can only be read from start
+class GCodeLineReader
+{
+public:
+    GCodeLineReader();
+
+    bool open(const QString &path);
+
+    //Continue reading from a raw line start, preceded by lineCount lines
+    bool seek(qint64 fileOffset, int lineCount);
+
+    bool isCompressed() const {return m_isCompressed;}
+
+    //Read next useful line, returns false at end of file or on a read error
+    bool readLine(GCodeLine *line);
+
+    //File could not be read to its end : corrupted or truncated compressed data, or an I/O error
+    bool isFailed() const {return m_isFailed;}
+    QString getErrorString() const {return m_device->errorString();}
+
+    //Position in decompressed content
+    qint64 getPosition() const {return m_bufferFileOffset + m_bufferPosition;}
+
+    //Progress through the file as stored on disk
+    qint64 getFilePosition() const;
+    qint64 getFileSize() const;
+    int getLineCount() const {return m_lineCount;}
+
+private:
+    bool fillBuffer();
+
+    QScopedPointer<QIODevice> m_device;
+    bool m_isCompressed;
+    bool m_isFailed;
+    QByteArray m_buffer;
+    int m_bufferPosition;
+    qint64 m_bufferFileOffset;
+    int m_lineCount;
+};
+
+#endif // GCODELINEREADER_H
@@ -0,0 +1,378 @@
+#include "gcodeloader.h"
+#include "gcodeindexedjob.h"
+#include "gcodewindowedjob.h"
+#include "gcodelinereader.h"
+#include "gcodedecompressor.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThread>
+#include <QtConcurrent>
+
+#define BATCH_INTERVAL_MS           100     //Bound the rate of results sent to the GUI
+#define CANCEL_CHECK_INTERVAL       1024    //Lines parsed between two cancellation checks
+#define WINDOWED_JOB_MIN_FILE_SIZE  (256ll * 1024 * 1024)   //Files from this size are not held in memory
+#define PARSER_STATE_INTERVAL       4096    //Useful lines between two recorded parser states, also size of parallel parsing chunks
+#define CHUNKS_PER_THREAD           4       //Chunks parsed by wave, per thread
+
+GCodeLoader::GCodeLoader(QObject *parent) :
+    QObject(parent),
+    m_isGeometryKept(true),
+    m_currentLoadId(0)
+{
+    //Parser is a child, so it follows the loader in its thread
+    m_parser = new GCodeParser(this);
+    connect(m_parser,&GCodeParser::parsedPrimitive,this,&GCodeLoader::onPrimitiveParsed);
+}
+
+int GCodeLoader::startNewLoad(){
+    return m_currentLoadId.fetchAndAddOrdered(1) + 1;
+}
+
+void GCodeLoader::cancel(){
+    m_currentLoadId.fetchAndAddOrdered(1);
+}
+
+bool GCodeLoader::isCancelled(int loadId) const{
+    return m_currentLoadId.loadAcquire() != loadId;
+}
+
+void GCodeLoader::load(const QString &path, int loadId){
+    if(isCancelled(loadId)){
+        return;
+    }
+
+    startLoad();
+    finishLoad(loadId,loadJob(path,loadId));
+}
+
+void GCodeLoader::reload(const QString &path, int loadId){
+    if(isCancelled(loadId)){
+        return;
+    }
+
+    startLoad();
+
+    //Only a file loaded as an indexed job and cached can be reloaded incrementally
+    GCodeJob* job = nullptr;
+    if(path == m_lastPath && !isWindowedJobNeeded(path)){
+        job = reloadIndexedJob(path,loadId);
+    }
+
+    //Otherwise whole file is loaded again
+    if(job == nullptr){
+        startLoad();
+        emit geometryTruncated(loadId,0);
+        job = loadJob(path,loadId);
+    }
+
+    finishLoad(loadId,job);
+}
+
+void GCodeLoader::startLoad(){
+    m_parser->reset();
+    m_cache.clear();
+    m_batch.clear();
+    m_batchTimer.start();
+}
+
+void GCodeLoader::finishLoad(int loadId, GCodeJob *job){
+    quint32 machineTime = m_cache.getMachineTime();
+    QVector3D boundsMin = m_cache.getBoundsMin();
+    QVector3D boundsMax = m_cache.getBoundsMax();
+    bool hasBounds = m_cache.hasBounds();
+    m_cache.clear();
+
+    if(isCancelled(loadId)){
+        delete job;
+        m_batch.clear();
+        return;
+    }
+
+    flushBatch(loadId);
+    if(hasBounds){
+        emit boundsComputed(loadId,boundsMin,boundsMax);
+    }
+    emit loaded(loadId,job,machineTime);
+}
+
+bool GCodeLoader::isWindowedJobNeeded(const QString &path){
+    //Windows are read back from the file at random positions, which a compressed file does not allow
+    return QFileInfo(path).size() >= WINDOWED_JOB_MIN_FILE_SIZE
+            && GCodeDecompressor::detectFormat(path) == GCodeDecompressor::format_none;
+}
+
+GCodeJob *GCodeLoader::loadJob(const QString &path, int loadId){
+    if(isWindowedJobNeeded(path)){
+        m_lastPath.clear();
+        return loadWindowedJob(path,loadId);
+    }
+    return loadIndexedJob(path,loadId);
+}
+
+GCodeJob *GCodeLoader::loadIndexedJob(const QString &path, int loadId){
+    m_isGeometryKept = true;
+    m_lastPath.clear();
+
+    //A file already parsed is reloaded from its cache, without parsing it again
+    QVector<uint> chunkHashes;
+    QByteArray cacheKey = GCodeJobCache::computeKey(path,&chunkHashes);
+    if(!cacheKey.isEmpty()){
+        GCodeIndexedJob* cachedJob = m_cache.load(GCodeJobCache::getCachePath(cacheKey),cacheKey,path);
+        if(cachedJob != nullptr){
+            rememberCachedFile(path,cacheKey,chunkHashes);
+            sendCachedGeometry(loadId);
+            return cachedJob;
+        }
+    }
+
+    GCodeIndexedJob* job = new GCodeIndexedJob();
+    if(!job->load(path)){
+        emit loadFailed(loadId,job->getErrorString());
+        delete job;
+        return nullptr;
+    }
+
+    QVector<quint32> estimatedTimes;
+    if(parseIndexedJob(job,0,&estimatedTimes,loadId)){
+        saveIndexedJob(job,path,cacheKey,chunkHashes);
+    }
+    return job;
+}
+
+GCodeJob *GCodeLoader::reloadIndexedJob(const QString &path, int loadId){
+    m_isGeometryKept = true;
+
+    //Locate the first modified bytes. Identical content is simply taken back from cache by a full load
+    QVector<uint> chunkHashes;
+    QByteArray cacheKey = GCodeJobCache::computeKey(path,&chunkHashes);
+    qint64 changeOffset = GCodeJobCache::findFirstChange(m_lastChunkHashes,chunkHashes);
+    if(cacheKey.isEmpty() || cacheKey == m_lastKey || changeOffset < 0){
+        return nullptr;
+    }
+
+    //Previous version of the job, with its geometry and parser states, is found in its cache
+    GCodeIndexedJob* previousJob = m_cache.load(GCodeJobCache::getCachePath(m_lastKey),m_lastKey,path);
+    if(previousJob == nullptr){
+        return nullptr;
+    }
+
+    GCodeIndexedJob* job = new GCodeIndexedJob();
+    if(!job->load(path) || m_cache.getParserStateCount() == 0){
+        delete previousJob;
+        delete job;
+        m_cache.clear();
+        return nullptr;
+    }
+
+    //Useful lines before the change are the same in both versions,
+    //parsing resumes from the last parser state recorded before the change
+    int changedIndex = qMin(job->indexOfOffset(changeOffset),previousJob->size());
+    int stateIndex = qMin(changedIndex / PARSER_STATE_INTERVAL, m_cache.getParserStateCount() - 1);
+    int resumeIndex = stateIndex * PARSER_STATE_INTERVAL;
+    //Resuming from the first useful line is a full parse, reported from line 0 whatever comes before that line
+    int firstChangedLine = (resumeIndex == 0) ? 0 : previousJob->getLineNumber(resumeIndex);
+
+    QVector<quint32> estimatedTimes;
+    estimatedTimes.reserve(job->size());
+    for(int i = 0 ; i < resumeIndex ; i++){
+        estimatedTimes.append(previousJob->getEstimatedTime(i));
+    }
+    delete previousJob;
+
+    m_parser->setState(m_cache.getParserState(stateIndex));
+    m_cache.truncate(firstChangedLine,stateIndex);
+    emit geometryTruncated(loadId,firstChangedLine);
+
+    if(parseIndexedJob(job,resumeIndex,&estimatedTimes,loadId)){
+        saveIndexedJob(job,path,cacheKey,chunkHashes);
+    }
+    return job;
+}
+
+bool GCodeLoader::parseIndexedJob(GCodeIndexedJob *job, int firstIndex, QVector<quint32> *estimatedTimes, int loadId){
+    //Lines are parsed in chunks, which start where parser states are recorded. Chunks are processed by waves, to bound memory use
+    int lineTotal = job->size();
+    int waveLineCount = PARSER_STATE_INTERVAL * qMax(QThread::idealThreadCount(), 1) * CHUNKS_PER_THREAD;
+
+    for(int waveIndex = firstIndex ; waveIndex < lineTotal ; waveIndex += waveLineCount){
+        QVector<ParsedChunk> chunks;
+        for(int chunkIndex = waveIndex ; chunkIndex < qMin(waveIndex + waveLineCount, lineTotal) ; chunkIndex += PARSER_STATE_INTERVAL){
+            ParsedChunk chunk;
+            chunk.job = job;
+            chunk.firstIndex = chunkIndex;
+            chunk.lineCount = qMin(PARSER_STATE_INTERVAL, lineTotal - chunkIndex);
+            chunks.append(chunk);
+        }
+
+        //Tokenizing does not depend on modal state, chunks are tokenized in parallel
+        QtConcurrent::blockingMap(chunks, &GCodeLoader::tokenizeChunk);
+        if(isCancelled(loadId)){
+            return false;
+        }
+
+        //Cheap sequential pass, following modal state and position only, gives the parser state at start of each chunk
+        m_parser->setGeometryComputed(false);
+        for(int c = 0 ; c < chunks.size() ; c++){
+            chunks[c].startState = m_parser->getState();
+            for(int i = 0 ; i < chunks[c].lineCount ; i++){
+                m_parser->executeBlock(chunks[c].blocks.at(i), job->getLineNumber(chunks[c].firstIndex + i));
+            }
+        }
+        m_parser->setGeometryComputed(true);
+
+        //Then chunks are tessellated in parallel, each one by its own parser
+        QtConcurrent::blockingMap(chunks, &GCodeLoader::tessellateChunk);
+        if(isCancelled(loadId)){
+            return false;
+        }
+
+        //Machine time is summed up, results are handed over in file order
+        quint32 machineTime = m_parser->getMachineTime();
+        for(int c = 0 ; c < chunks.size() ; c++){
+            //Parser state is recorded, so that a modified file can be parsed again from the middle
+            GCodeParser::State state = chunks.at(c).startState;
+            state.machineTime = machineTime;
+            m_cache.appendParserState(state);
+
+            const QVector<quint32> &chunkTimes = chunks.at(c).estimatedTimes;
+            for(int i = 0 ; i < chunkTimes.size() ; i++){
+                estimatedTimes->append(machineTime + chunkTimes.at(i));
+            }
+            machineTime += chunks.at(c).machineTime;
+
+            for(int i = 0 ; i < chunks.at(c).primitives.size() ; i++){
+                onPrimitiveParsed(chunks.at(c).primitives.at(i).line, chunks.at(c).primitives.at(i).geometry, chunks.at(c).primitives.at(i).isWork);
+            }
+            reportProgress(loadId, chunks.at(c).firstIndex + chunks.at(c).lineCount - firstIndex, lineTotal - firstIndex);
+        }
+
+        //Prefix pass left the parser in the state following the wave, but without machine time
+        GCodeParser::State state = m_parser->getState();
+        state.machineTime = machineTime;
+        m_parser->setState(state);
+    }
+
+    job->setEstimatedTimes(*estimatedTimes);
+    m_cache.setMachineTime(m_parser->getMachineTime());
+    return true;
+}
+
+void GCodeLoader::tokenizeChunk(ParsedChunk &chunk){
+    chunk.blocks.resize(chunk.lineCount);
+    for(int i = 0 ; i < chunk.lineCount ; i++){
+        int length;
+        const char *data = chunk.job->getLineData(chunk.firstIndex + i, &length);
+        GCodeParser::tokenizeLine(data, length, &chunk.blocks[i]);
+    }
+}
+
+void GCodeLoader::tessellateChunk(ParsedChunk &chunk){
+    //Machine time of the chunk is counted from 0, chunks are summed up afterwards
+    GCodeParser::State state = chunk.startState;
+    state.machineTime = 0;
+
+    GCodeParser parser;
+    parser.setState(state);
+    connect(&parser, &GCodeParser::parsedPrimitive, [&chunk](int line, QVector<QVector3D> geometry, bool isWork){
+        GCodePrimitive primitive = {line, geometry, isWork};
+        chunk.primitives.append(primitive);
+    });
+
+    chunk.estimatedTimes.reserve(chunk.lineCount);
+    for(int i = 0 ; i < chunk.lineCount ; i++){
+        parser.executeBlock(chunk.blocks.at(i), chunk.job->getLineNumber(chunk.firstIndex + i));
+        chunk.estimatedTimes.append(parser.getMachineTime());
+    }
+
+    chunk.machineTime = parser.getMachineTime();
+    chunk.blocks.clear();
+}
+
+void GCodeLoader::saveIndexedJob(const GCodeIndexedJob *job, const QString &path, const QByteArray &cacheKey, const QVector<uint> &chunkHashes){
+    //Failing to write cache only means next load will parse file again
+    if(!cacheKey.isEmpty() && m_cache.save(GCodeJobCache::getCachePath(cacheKey),cacheKey,*job)){
+        rememberCachedFile(path,cacheKey,chunkHashes);
+    }
+}
+
+void GCodeLoader::rememberCachedFile(const QString &path, const QByteArray &cacheKey, const QVector<uint> &chunkHashes){
+    //Needed to reload the file incrementally when it changes
+    m_lastPath = path;
+    m_lastKey = cacheKey;
+    m_lastChunkHashes = chunkHashes;
+}
+
+void GCodeLoader::sendCachedGeometry(int loadId){
+    int primitiveTotal = m_cache.getPrimitiveCount();
+    for(int i = 0 ; i < primitiveTotal ; i++){
+        if((i % CANCEL_CHECK_INTERVAL) == 0 && isCancelled(loadId)){
+            return;
+        }
+
+        m_batch.append(m_cache.getPrimitive(i));
+        reportProgress(loadId,i+1,primitiveTotal);
+    }
+}
+
+GCodeJob *GCodeLoader::loadWindowedJob(const QString &path, int loadId){
+    GCodeLineReader reader;
+    if(!reader.open(path)){
+        emit loadFailed(loadId,reader.getErrorString());
+        return nullptr;
+    }
+
+    //Whole geometry of such a file would not fit in memory either, only duration is estimated
+    m_isGeometryKept = false;
+
+    GCodeWindowedJob* job = new GCodeWindowedJob();
+    job->setFilePath(path);
+
+    //Indexing and parsing are done in a single pass
+    GCodeLine line;
+    int lineIndex = 0;
+    while(reader.readLine(&line)){
+        if((lineIndex++ % CANCEL_CHECK_INTERVAL) == 0 && isCancelled(loadId)){
+            break;
+        }
+
+        job->appendIndexedLine(line,m_parser->getMachineTime());
+        m_parser->parseLine(line.data,line.length,line.lineNumber);
+        reportProgress(loadId,reader.getFilePosition(),reader.getFileSize());
+    }
+
+    //A job cut short by a read error would be streamed as if it were complete
+    if(reader.isFailed()){
+        emit loadFailed(loadId,reader.getErrorString());
+        delete job;
+        return nullptr;
+    }
+
+    job->finishIndexing(reader.getLineCount(),m_parser->getMachineTime());
+    m_cache.setMachineTime(m_parser->getMachineTime());
+    return job;
+}
+
+void GCodeLoader::reportProgress(int loadId, qint64 done, qint64 total){
+    //Hand results over to the GUI at a bounded rate
+    if(m_batchTimer.elapsed() >= BATCH_INTERVAL_MS || done == total){
+        flushBatch(loadId);
+        emit progress(loadId,done,total);
+        m_batchTimer.restart();
+    }
+}
+
+void GCodeLoader::onPrimitiveParsed(int line, QVector<QVector3D> geometry, bool isWork){
+    if(m_isGeometryKept){
+        GCodePrimitive primitive = {line, geometry, isWork};
+        m_batch.append(primitive);
+        m_cache.appendPrimitive(primitive);
+    }
+}
+
+void GCodeLoader::flushBatch(int loadId){
+    if(!m_batch.isEmpty()){
+        emit primitivesParsed(loadId,m_batch);
+        m_batch.clear();
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef GCODELOADER_H
+#define GCODELOADER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QVector>
+#include <QElapsedTimer>
+
+#include "gcodejob.h"
+#include "gcodeparser.h"
+#include "gcodejobcache.h"
+
+class GCodeIndexedJob;
+
+//Loads and parses a gcode file. Meant to live in a worker thread, results are reported in batches
+class GCodeLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GCodeLoader(QObject *parent = nullptr);
+
+    //Thread safe : returns the identifier to use for the next load request
+    int startNewLoad();
+    //Thread safe : abort any running load
+    void cancel();
+
+signals:
+    void progress(int loadId, qint64 done, qint64 total);
+    void primitivesParsed(int loadId, QVector<GCodePrimitive> primitives);
+    void boundsComputed(int loadId, QVector3D boundsMin, QVector3D boundsMax);
+
+    //On reload, geometry previously sent from line firstLine onwards is outdated
+    void geometryTruncated(int loadId, int firstLine);
+
+    //Ownership of job is given to the receiver. Job is nullptr if the file could not be opened
+    void loaded(int loadId, GCodeJob *job, quint32 machineTime);
+
+    //Emitted before loaded when the file could not be read to its end
+    void loadFailed(int loadId, const QString &reason);
+
+public slots:
+    void load(const QString &path, int loadId);
+
+    //Same as load, but only parse again from the first change when path is the last file loaded
+    void reload(const QString &path, int loadId);
+
+private slots:
+    void onPrimitiveParsed(int line, QVector<QVector3D> geometry, bool isWork);
+
+private:
+    //Chunk of useful lines parsed in a worker thread
+    struct ParsedChunk{
+        GCodeIndexedJob* job;
+        int firstIndex;
+        int lineCount;
+        QVector<GCodeParser::Block> blocks;
+        GCodeParser::State startState;
+        QVector<GCodePrimitive> primitives;
+        QVector<quint32> estimatedTimes;    //Counted from start of chunk
+        quint32 machineTime;
+    };
+
+    static void tokenizeChunk(ParsedChunk &chunk);
+    static void tessellateChunk(ParsedChunk &chunk);
+
+    bool isCancelled(int loadId) const;
+    static bool isWindowedJobNeeded(const QString &path);
+    void startLoad();
+    void finishLoad(int loadId, GCodeJob *job);
+    GCodeJob* loadJob(const QString &path, int loadId);
+    GCodeJob* loadIndexedJob(const QString &path, int loadId);
+    GCodeJob* reloadIndexedJob(const QString &path, int loadId);
+    GCodeJob* loadWindowedJob(const QString &path, int loadId);
+    bool parseIndexedJob(GCodeIndexedJob *job, int firstIndex, QVector<quint32> *estimatedTimes, int loadId);
+    void saveIndexedJob(const GCodeIndexedJob *job, const QString &path, const QByteArray &cacheKey, const QVector<uint> &chunkHashes);
+    void rememberCachedFile(const QString &path, const QByteArray &cacheKey, const QVector<uint> &chunkHashes);
+    void sendCachedGeometry(int loadId);
+    void reportProgress(int loadId, qint64 done, qint64 total);
+    void flushBatch(int loadId);
+
+    GCodeParser* m_parser;
+    QVector<GCodePrimitive> m_batch;
+    QElapsedTimer m_batchTimer;
+    bool m_isGeometryKept;
+    GCodeJobCache m_cache;      //Geometry and duration of the job being loaded
+
+    //Last file loaded and cached, for incremental reloads
+    QString m_lastPath;
+    QByteArray m_lastKey;
+    QVector<uint> m_lastChunkHashes;
+
+    QAtomicInt m_currentLoadId;
+};
+
+Q_DECLARE_METATYPE(GCodeJob*)
+
+#endif // GCODELOADER_H
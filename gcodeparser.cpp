@@ -1,16 +1,17 @@
 #include "gcodeparser.h"
 
-#include <QRegularExpression>
 #include <QVector>
 #include <QVector2D>
 #include <qmath.h>
+#include <cctype>
 #include "grbldefinitions.h"
 
 #define ANGLE_QUANTUM_DEG           5.0f
 
 const int GCodeParser::s_axisArray[3][3] = {{0,1,2},{1,2,0},{2,0,1}};
 
-GCodeParser::GCodeParser(QObject *parent) : QObject(parent)
+GCodeParser::GCodeParser(QObject *parent) : QObject(parent),
+    m_isGeometryComputed(true)
 {
     reset();
 }
@@ -25,69 +26,174 @@ void GCodeParser::reset(){
     m_machineTime = 0;
     m_machineSpeed = 0.0f;
 
-    m_wordMap.clear();
+    m_block.wordCount = 0;
 
     m_currentPos = QVector3D();
     m_isCurrentPosValid = false;
 }
 
+GCodeParser::State GCodeParser::getState() const{
+    State state;
+    state.g0NonModal = m_g0NonModal;
+    state.g1Motion = m_g1Motion;
+    state.g2Plane = m_g2Plane;
+    state.g3Distance = m_g3Distance;
+    state.g6Units = m_g6Units;
+    state.machineTime = m_machineTime;
+    state.machineSpeed = m_machineSpeed;
+    state.currentPos = m_currentPos;
+    state.isCurrentPosValid = m_isCurrentPosValid;
+    return state;
+}
+
+void GCodeParser::setState(const State &state){
+    m_g0NonModal = state.g0NonModal;
+    m_g1Motion = state.g1Motion;
+    m_g2Plane = state.g2Plane;
+    m_g3Distance = state.g3Distance;
+    m_g6Units = state.g6Units;
+    m_machineTime = state.machineTime;
+    m_machineSpeed = state.machineSpeed;
+    m_currentPos = state.currentPos;
+    m_isCurrentPosValid = state.isCurrentPosValid;
+
+    m_block.wordCount = 0;
+}
 
 void GCodeParser::parseInstruction(GrblInstruction instruction){
-    const QRegularExpression whitespaceExpression = QRegularExpression("\\s+");
-    const QRegularExpression wordBeginExpression = QRegularExpression("[A-Z]");
+    QByteArray bytes = instruction.getBytes();
+    parseLine(bytes.constData(), bytes.size(), instruction.getLineNumber());
+}
 
-    //Simplify gcode
-    QString simplifiedGCode = instruction.getString().toUpper();
-    simplifiedGCode.remove(whitespaceExpression);       //Removes whitespaces (incl line return characters)
+void GCodeParser::parseLine(const char *data, int length, int lineNumber){
+    Block block;
+    tokenizeLine(data, length, &block);
+    executeBlock(block, lineNumber);
+}
 
-    //Find first gcode word (should be at index 0, but better test it)
-    int index = simplifiedGCode.indexOf(wordBeginExpression);
+void GCodeParser::tokenizeLine(const char *data, int length, Block *block){
+    block->wordCount = 0;
 
-    //If not gcode word found, no need to try to parse this line
-    if(index<0){
-        return;
+    //Simplify gcode : upper case, without whitespaces (incl line return characters)
+    char simplifiedGCode[MAX_LINE_LENGTH];
+    int size = 0;
+    for(int i = 0 ; i < length && size < MAX_LINE_LENGTH ; i++){
+        unsigned char character = static_cast<unsigned char>(data[i]);
+        if(!isspace(character)){
+            simplifiedGCode[size++] = char(toupper(character));
+        }
+    }
+
+    //Find first gcode word (should be at index 0, but better test it)
+    int index = 0;
+    while(index < size && !isupper(static_cast<unsigned char>(simplifiedGCode[index]))){
+        index++;
     }
 
-    while(index < simplifiedGCode.size()){
+    while(index < size && block->wordCount < MAX_BLOCK_WORDS){
         //Extract letter
-        char letter = simplifiedGCode.at(index).toLatin1();
+        char letter = simplifiedGCode[index];
 
         //Now we will use index+1 as reference (the character after the beginning of the Gcode word)
         index++;
 
-        //Locate next gcode word
-        int nextIndex = simplifiedGCode.indexOf(wordBeginExpression,index);
-
-        //If no next index found, next index is the end of the string
-        if(nextIndex<0){
-            nextIndex=simplifiedGCode.size();
+        //Locate next gcode word, or the end of the string
+        int nextIndex = index;
+        while(nextIndex < size && !isupper(static_cast<unsigned char>(simplifiedGCode[nextIndex]))){
+            nextIndex++;
         }
 
-        //Extract value
-        QStringRef valueStringRef = simplifiedGCode.midRef(index,nextIndex-index);
-        bool success = true;
-        float value = valueStringRef.toFloat(&success);
-
-        //If parsing went successful, add this word to map
-        if(success){
-            m_wordMap.insert(letter,value);
+        //If parsing went successful, add this word to block
+        float value;
+        if(parseValue(simplifiedGCode + index, nextIndex - index, &value)){
+            block->letters[block->wordCount] = letter;
+            block->values[block->wordCount] = value;
+            block->wordCount++;
         }
 
         //Get ready to locate next word
         index = nextIndex;
     }
+}
+
+void GCodeParser::executeBlock(const Block &block, int lineNumber){
+    //If not gcode word found, no need to try to parse this line
+    if(block.wordCount == 0){
+        return;
+    }
 
-    computeMovement(instruction.getLineNumber());
+    m_block = block;
+    computeMovement(lineNumber);
 
-    m_wordMap.clear();
+    m_block.wordCount = 0;
     m_g0NonModal = NON_MODAL_NO_ACTION;
 }
 
+bool GCodeParser::hasWord(char letter) const{
+    for(int i = 0 ; i < m_block.wordCount ; i++){
+        if(m_block.letters[i] == letter){
+            return true;
+        }
+    }
+    return false;
+}
+
+float GCodeParser::getWordValue(char letter, float defaultValue) const{
+    //Last one wins if a word is repeated
+    for(int i = m_block.wordCount-1 ; i >= 0 ; i--){
+        if(m_block.letters[i] == letter){
+            return m_block.values[i];
+        }
+    }
+    return defaultValue;
+}
+
+bool GCodeParser::parseValue(const char *text, int length, float *value){
+    //Plain decimal number, as found in gcode words. Not locale dependent
+    int index = 0;
+    bool isNegative = false;
+    if(index < length && (text[index] == '-' || text[index] == '+')){
+        isNegative = (text[index] == '-');
+        index++;
+    }
+
+    double result = 0.0;
+    double decimalFactor = 0.0;
+    int digitCount = 0;
+    for( ; index < length ; index++){
+        char character = text[index];
+        if(character >= '0' && character <= '9'){
+            if(decimalFactor > 0.0){
+                result += (character - '0') * decimalFactor;
+                decimalFactor /= 10.0;
+            }
+            else{
+                result = result * 10.0 + (character - '0');
+            }
+            digitCount++;
+        }
+        else if(character == '.' && decimalFactor == 0.0){
+            decimalFactor = 0.1;
+        }
+        else{
+            return false;
+        }
+    }
+
+    if(digitCount == 0){
+        return false;
+    }
+
+    *value = float(isNegative ? -result : result);
+    return true;
+}
+
 
 void GCodeParser::computeMovement(int line){
 
     //Process 'F' words
-    foreach(float value,m_wordMap.values('F')){
+    if(hasWord('F')){
+        float value = getWordValue('F');
         //Convert it to mm
         if(m_g6Units == UNITS_MODE_INCHES){
             value *= MM_PER_INCH;
@@ -107,6 +213,12 @@ void GCodeParser::computeMovement(int line){
         return;
     }
 
+    //Only position is followed
+    if(!m_isGeometryComputed){
+        m_currentPos=targetPos;
+        return;
+    }
+
     //Fill the point vector
     QVector<QVector3D> pointsVector;
 
@@ -174,7 +286,7 @@ QVector<QVector3D> GCodeParser::buildArcPointsVector(QVector3D target){
     float deltaHeight =  endHeight - startHeight;
 
     //Ensure angles are correct, and take number of turn into account
-    float revolutionCount = qAbs(m_wordMap.value('P',0.0f));
+    float revolutionCount = qAbs(getWordValue('P'));
     if(deltaAngle < 0){
         revolutionCount += 1;
     }
@@ -216,8 +328,8 @@ QVector2D GCodeParser::computeArcCenter(QVector3D target){
 
 
     //try with radius definition
-    if(m_wordMap.contains('R')){
-        float r = m_wordMap.value('R');
+    if(hasWord('R')){
+        float r = getWordValue('R');
 
         if(m_g6Units == UNITS_MODE_INCHES){
             r *= MM_PER_INCH;
@@ -258,7 +370,7 @@ QVector2D GCodeParser::computeArcCenter(QVector3D target){
     else{
         const char axisLetter[] = {'I','J','K'};
             for(int i = 0 ; i < 2 ; i++){
-                float value = m_wordMap.value(axisLetter[axis[i]],0.0f);
+                float value = getWordValue(axisLetter[axis[i]]);
 
                 if(m_g6Units == UNITS_MODE_INCHES){
                     value *= MM_PER_INCH;
@@ -294,7 +406,11 @@ void GCodeParser::computeMachineTime(QVector<QVector3D> pointsVector)
 
 
 void GCodeParser::processGValues(){
-    foreach(float value,m_wordMap.values('G')){
+    for(int wordIndex = 0 ; wordIndex < m_block.wordCount ; wordIndex++){
+        if(m_block.letters[wordIndex] != 'G'){
+            continue;
+        }
+        float value = m_block.values[wordIndex];
 
         int mantissa = qAbs(value);
         int decimal = qRound((value-mantissa)*10.0f);
@@ -410,12 +526,12 @@ QVector3D GCodeParser::processXYZValues(){
     //For each axis
     for(quint8 i = 0 ; i < 3 ; i++){
         //Only if this axis letter is mentionned in wordMap
-        if(!m_wordMap.contains(axisLetter[i])){
+        if(!hasWord(axisLetter[i])){
             continue;
         }
 
         //Get its value
-        float axisValue = m_wordMap.value(axisLetter[i]);
+        float axisValue = getWordValue(axisLetter[i]);
 
         //Convert it to mm
         if(m_g6Units == UNITS_MODE_INCHES){
@@ -3,8 +3,17 @@
 
 #include <QObject>
 #include <QVector3D>
-#include <QMultiMap>
 #include "grblinstruction.h"
+#include "grbldefinitions.h"
+
+//Geometry produced by a single gcode line
+struct GCodePrimitive{
+    int line;
+    QVector<QVector3D> geometry;
+    bool isWork;
+};
+
+Q_DECLARE_METATYPE(GCodePrimitive)
 
 class GCodeParser : public QObject
 {
@@ -22,10 +31,43 @@ public:
 
     enum G6_UnitsMode{UNITS_MODE_MM = 0, UNITS_MODE_INCHES};
 
+    //Everything carried over from one line to the next, so that parsing can resume in the middle of a file
+    struct State{
+        G0_NonModalActions  g0NonModal;
+        G1_MotionModes      g1Motion;
+        G2_PlaneSelect      g2Plane;
+        G3_DistanceMode     g3Distance;
+        G6_UnitsMode        g6Units;
+        uint32_t machineTime;
+        float machineSpeed;
+        QVector3D currentPos;
+        bool isCurrentPosValid;
+    };
+
+    //Words of a single gcode line, as read by the tokenizer
+    struct Block{
+        int wordCount;
+        char letters[MAX_BLOCK_WORDS];
+        float values[MAX_BLOCK_WORDS];
+    };
+
     explicit GCodeParser(QObject *parent = 0);
 
     uint32_t getMachineTime() const;
 
+    State getState() const;
+    void setState(const State &state);
+
+    //Same as parseInstruction, straight from raw bytes
+    void parseLine(const char *data, int length, int lineNumber);
+
+    //parseLine in two steps : tokenizing does not depend on parser state, so lines can be tokenized in any thread, in any order
+    static void tokenizeLine(const char *data, int length, Block *block);
+    void executeBlock(const Block &block, int lineNumber);
+
+    //Without geometry, only modal state and position are followed : no primitive is emitted, machine time is not computed
+    void setGeometryComputed(bool isGeometryComputed) {m_isGeometryComputed = isGeometryComputed;}
+
 signals:
 
     void parsedPrimitive(int line, QVector<QVector3D> geometry, bool isWork);
@@ -36,6 +78,10 @@ public slots:
     void reset();
 
 private:
+    static bool parseValue(const char *text, int length, float *value);
+
+    bool hasWord(char letter) const;
+    float getWordValue(char letter, float defaultValue = 0.0f) const;
 
     void computeMovement(int line);
     QVector<QVector3D> buildLinePointsVector(QVector3D target);
@@ -67,7 +113,8 @@ private:
     QVector3D m_currentPos; //in mm
     bool m_isCurrentPosValid;
 
-    QMultiMap<char,float> m_wordMap;
+    Block m_block;      //Line being executed
+    bool m_isGeometryComputed;
 
     static const int s_axisArray[3][3];
 };
@@ -1,23 +1,87 @@
 #include "gcodestreamer.h"
+#include "gcodeindexedjob.h"
+#include "gcodefollowedjob.h"
 #include "grbldefinitions.h"
 
-#include <QFile>
 #include <QFileInfo>
 
-#define MAX_LINE_LENGTH         256     //Defined by gcode standard
 #define DEFAULT_FIFO_DEPTH      1000
-
-const char *GCodeStreamer::s_gcodeCommentsDelimiters[] = {GCODE_COMMENTS_DELIM};
+#define STREAM_QUEUE_DEPTH      256     //Lines queued to the board ahead of those it accepted, covers GUI stalls
+#define RELOAD_DELAY_MS         500
+#define FOLLOW_LOOKAHEAD_LINES  100     //Useful lines buffered ahead before a job still being written is sent
+#define SOURCE_CHECK_INTERVAL_MS 100    //Job source is looked at on disk at most this often while streaming
 
 GCodeStreamer::GCodeStreamer(QObject *parent) :
     QObject(parent),
-    m_run(false)
+    m_lineToQueueIndex(0),
+    m_queueGeneration(0),
+    m_isQueueFlushPending(false),
+    m_isQueueingLine(false),
+    m_isQueueFull(false),
+    m_run(false),
+    m_loadId(0),
+    m_followId(0),
+    m_isLookaheadReached(false),
+    m_isSourceQuiet(false),
+    m_isFileWatched(false),
+    m_isReloadPending(false),
+    m_isReloading(false),
+    m_job(new GCodeIndexedJob()),
+    m_estimatedDuration(0)
 {
+    qRegisterMetaType<QVector<GCodePrimitive> >();
+    qRegisterMetaType<GCodeJob*>();
+    qRegisterMetaType<GCodeLineBatch>();
+
+    m_loader = new GCodeLoader();
+    m_loader->moveToThread(&m_loaderThread);
+    connect(&m_loaderThread,&QThread::finished,m_loader,&QObject::deleteLater);
+    connect(this,&GCodeStreamer::loadRequested,m_loader,&GCodeLoader::load);
+    connect(this,&GCodeStreamer::reloadRequested,m_loader,&GCodeLoader::reload);
+    connect(m_loader,&GCodeLoader::progress,this,&GCodeStreamer::onLoaderProgress);
+    connect(m_loader,&GCodeLoader::primitivesParsed,this,&GCodeStreamer::onLoaderPrimitivesParsed);
+    connect(m_loader,&GCodeLoader::boundsComputed,this,&GCodeStreamer::onLoaderBoundsComputed);
+    connect(m_loader,&GCodeLoader::geometryTruncated,this,&GCodeStreamer::onLoaderGeometryTruncated);
+    connect(m_loader,&GCodeLoader::loaded,this,&GCodeStreamer::onLoaderJobLoaded);
+    connect(m_loader,&GCodeLoader::loadFailed,this,&GCodeStreamer::onLoaderLoadFailed);
+    m_loaderThread.start();
+
+    m_follower = new GCodeFollower();
+    m_follower->moveToThread(&m_followerThread);
+    connect(&m_followerThread,&QThread::finished,m_follower,&QObject::deleteLater);
+    connect(this,&GCodeStreamer::followRequested,m_follower,&GCodeFollower::follow);
+    connect(m_follower,&GCodeFollower::linesRead,this,&GCodeStreamer::onFollowerLinesRead);
+    connect(m_follower,&GCodeFollower::primitivesParsed,this,&GCodeStreamer::onFollowerPrimitivesParsed);
+    connect(m_follower,&GCodeFollower::sourceQuiet,this,&GCodeStreamer::onFollowerSourceQuiet);
+    connect(m_follower,&GCodeFollower::finished,this,&GCodeStreamer::onFollowerFinished);
+    m_followerThread.start();
+
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(RELOAD_DELAY_MS);
+    connect(&m_reloadTimer,&QTimer::timeout,this,&GCodeStreamer::onReloadTimeout);
+    connect(&m_fileWatcher,&QFileSystemWatcher::fileChanged,this,&GCodeStreamer::onWatchedFileChanged);
+
     clear();
 }
 
+GCodeStreamer::~GCodeStreamer(){
+    m_loader->cancel();
+    m_loaderThread.quit();
+    m_loaderThread.wait();
+
+    m_follower->cancel();
+    m_followerThread.quit();
+    m_followerThread.wait();
+
+    delete m_job;
+}
+
 GCodeStreamer::states GCodeStreamer::getState(void){
-    if(!m_usefulLinesVector.isEmpty()){
+    //A followed source is loading until its first useful line comes
+    if(m_loadId != 0 || (m_followId != 0 && m_job->isEmpty())){
+        return state_loading;
+    }
+    else if(!m_job->isEmpty()){
         if(m_run){
             return state_running;
         }
@@ -34,64 +98,239 @@ void GCodeStreamer::loadFile(const QString &path){
 
     clear();
 
-    QFile file(path);
+    //File is indexed and parsed in the loader thread, GUI stays responsive meanwhile
+    m_filePath = path;
+    if(m_isFileWatched){
+        m_fileWatcher.addPath(m_filePath);
+    }
 
-    if (file.open(QIODevice::ReadOnly))
-    {
-        //file.reset();
+    m_loadId = m_loader->startNewLoad();
+    emit stateChanged(state_loading);
+    emit loadRequested(path,m_loadId);
+}
 
-        //Store file in linevector
-        while(!file.atEnd()){
+void GCodeStreamer::followFile(const QString &path){
 
-            //Get line
-            QByteArray gcodeLine = file.readLine(MAX_LINE_LENGTH);
-            cleanupLine(&gcodeLine);
+    clear();
 
-            m_lineCount++;
+    //Lines are appended to the job as the follower thread reads them
+    delete m_job;
+    m_job = new GCodeFollowedJob(path);
 
-            //No need to process a useless line
-            if(gcodeLine.isEmpty()){
-                continue;
-            }
+    m_isSourceQuiet = false;
+    m_followId = m_follower->startNewFollow();
+    emit fileLoaded(m_job->getFileName());
+    emit stateChanged(state_loading);
+    emit followRequested(path,m_followId);
+}
 
-            //Add it to line vector
-            GrblInstruction instruction(gcodeLine,m_lineCount);
-            m_usefulLinesVector.append(instruction);
+void GCodeStreamer::onFollowerLinesRead(int followId, GCodeLineBatch batch){
+    if(followId != m_followId){
+        return;
+    }
 
-            emit instructionLoaded(instruction);
+    //Source grows again, next lines wait for a full lookahead again
+    m_isSourceQuiet = false;
+
+    bool wasEmpty = m_job->isEmpty();
+    if(!static_cast<GCodeFollowedJob*>(m_job)->appendBatch(batch)){
+        //Source is no longer read : lines held so far make the whole job, the machine is not left to run it unattended
+        m_follower->cancel();
+        m_followId = 0;
+        static_cast<GCodeFollowedJob*>(m_job)->setComplete();
+        if(m_run){
+            stop();
         }
+        emit streamError(tr("%1 is too long to be held in memory : reading stopped after line %2")
+                         .arg(m_job->getFileName()).arg(m_job->getLineCount()));
+        emit stateChanged(getState());
+        return;
+    }
+    if(!batch.estimatedTimes.isEmpty()){
+        m_estimatedDuration = batch.estimatedTimes.last();
+        emit estimatedDurationUpdated(m_estimatedDuration);
+    }
+    emit lineCountUpdated(m_job->getLineCount());
+
+    if(wasEmpty && !m_job->isEmpty()){
+        rewind();
+        emit stateChanged(getState());
+    }
+
+    //Machine may be waiting for these lines
+    if(m_run){
+        tryToSendNextInstruction();
+    }
+}
+
+void GCodeStreamer::onFollowerPrimitivesParsed(int followId, QVector<GCodePrimitive> primitives){
+    if(followId == m_followId){
+        emit primitivesLoaded(primitives);
+    }
+}
+
+void GCodeStreamer::onFollowerSourceQuiet(int followId){
+    if(followId != m_followId){
+        return;
+    }
+
+    m_isSourceQuiet = true;
+    if(m_run){
+        tryToSendNextInstruction();
+    }
+}
+
+void GCodeStreamer::onFollowerFinished(int followId, bool isOpened){
+    if(followId != m_followId){
+        return;
+    }
 
-        emit fileLoaded(QFileInfo(file).baseName());
+    m_followId = 0;
+    if(!isOpened){
+        clear();
+        return;
     }
 
-    emit lineCountUpdated(m_lineCount);
+    static_cast<GCodeFollowedJob*>(m_job)->setComplete();
+
+    //Last lines no longer wait for a full lookahead
+    if(m_run){
+        tryToSendNextInstruction();
+    }
     emit stateChanged(getState());
+}
 
-    //Make the file ready to start from the beginning
-    //not necessary if file is not open
-   // rewind();
+void GCodeStreamer::setFileWatched(bool isWatched){
+    m_isFileWatched = isWatched;
+    if(!m_fileWatcher.files().isEmpty()){
+        m_fileWatcher.removePaths(m_fileWatcher.files());
+    }
+    if(m_isFileWatched && !m_filePath.isEmpty()){
+        m_fileWatcher.addPath(m_filePath);
+    }
 }
 
-void GCodeStreamer::cleanupLine(QByteArray* code){
-    int commentDelimiterCount = sizeof(s_gcodeCommentsDelimiters)/sizeof(s_gcodeCommentsDelimiters[0]);
-    for(int i = 0 ; i < commentDelimiterCount ; i++){
-        int delimiterPosition = code->indexOf(s_gcodeCommentsDelimiters[i]); //Return start of comment or -1
-        if(delimiterPosition >= 0){
-            code->truncate(delimiterPosition);     //Resize to start of comment. If -1, do nothing
-        }
+void GCodeStreamer::onWatchedFileChanged(){
+    //Lines not handed out yet may already be the new file's, whatever the reload does later
+    m_job->setSourceChanged();
+    m_sourceCheckTimer.invalidate();
+    m_reloadTimer.start();
+}
+
+void GCodeStreamer::onReloadTimeout(){
+    if(m_filePath.isEmpty() || !m_isFileWatched){
+        return;
     }
 
-    //remove any start / and whitespace and special character
-    (*code) = code->trimmed();
+    //A file replaced by a new one is no longer watched
+    if(!m_fileWatcher.files().contains(m_filePath) && QFileInfo::exists(m_filePath)){
+        m_fileWatcher.addPath(m_filePath);
+    }
+
+    //Job is never swapped while the machine runs it
+    if(m_run){
+        m_isReloadPending = true;
+        return;
+    }
+    if(m_loadId != 0){
+        m_reloadTimer.start();
+        return;
+    }
+
+    //Only lines from the first change are parsed again, in the loader thread
+    m_isReloadPending = false;
+    m_isReloading = true;
+    m_loadId = m_loader->startNewLoad();
+    emit stateChanged(state_loading);
+    emit reloadRequested(m_filePath,m_loadId);
+}
+
+void GCodeStreamer::onLoaderGeometryTruncated(int loadId, int firstLine){
+    if(loadId != m_loadId){
+        return;
+    }
+
+    //Reload fell back to parsing the whole file : the view is rebuilt, bounds with it
+    if(firstLine == 0){
+        m_isReloading = false;
+    }
+    emit primitivesTruncated(firstLine);
+}
+
+void GCodeStreamer::onLoaderProgress(int loadId, qint64 done, qint64 total){
+    if(loadId == m_loadId && total > 0){
+        emit loadingProgress(int(done * 100 / total));
+    }
+}
+
+void GCodeStreamer::onLoaderPrimitivesParsed(int loadId, QVector<GCodePrimitive> primitives){
+    if(loadId == m_loadId){
+        emit primitivesLoaded(primitives);
+    }
+}
+
+void GCodeStreamer::onLoaderBoundsComputed(int loadId, QVector3D boundsMin, QVector3D boundsMax){
+    if(loadId == m_loadId && !m_isReloading){
+        emit boundsUpdated(boundsMin,boundsMax);
+    }
+}
+
+void GCodeStreamer::onLoaderJobLoaded(int loadId, GCodeJob *job, quint32 machineTime){
+    //Result of a cancelled load
+    if(loadId != m_loadId){
+        delete job;
+        return;
+    }
+
+    m_loadId = 0;
+    m_isReloading = false;
+
+    if(job != nullptr){
+        delete m_job;
+        m_job = job;
+        m_estimatedDuration = machineTime;
+        rewind();
+
+        emit fileLoaded(m_job->getFileName());
+        emit estimatedDurationUpdated(m_estimatedDuration);
+    }
+
+    emit lineCountUpdated(m_job->getLineCount());
+    emit stateChanged(getState());
+}
+
+void GCodeStreamer::onLoaderLoadFailed(int loadId, const QString &reason){
+    if(loadId != m_loadId){
+        return;
+    }
+    emit streamError(tr("%1 could not be loaded : %2").arg(QFileInfo(m_filePath).fileName()).arg(reason));
 }
 
 
 
 void GCodeStreamer::clear(){
+    //Abort any load in progress
+    if(m_loadId != 0){
+        m_loader->cancel();
+        m_loadId = 0;
+    }
+    if(m_followId != 0){
+        m_follower->cancel();
+        m_followId = 0;
+    }
+
+    m_filePath.clear();
+    m_isReloadPending = false;
+    m_isReloading = false;
+    m_reloadTimer.stop();
+    if(!m_fileWatcher.files().isEmpty()){
+        m_fileWatcher.removePaths(m_fileWatcher.files());
+    }
+
     rewind();
 
-    m_lineCount = 0;
-    m_usefulLinesVector.clear();
+    m_job->clear();
+    m_estimatedDuration = 0;
 
     emit lineCountUpdated(0);
     emit stateChanged(state_clear);
@@ -100,44 +339,23 @@ void GCodeStreamer::clear(){
 
 
 void GCodeStreamer::goToLine(int line){
-    if(m_usefulLinesVector.isEmpty()){
-        return;
-    }
-
-    int firstUsefulLineNumber = m_usefulLinesVector.first().getLineNumber();
-    int lastUsefulLineNumber = m_usefulLinesVector.last().getLineNumber();
-    int lastLineIndex = m_usefulLinesVector.size()-1;
+    //Lines still queued to the board must not move the read head anymore
+    m_queueGeneration++;
+    requestQueueFlush();
 
-    //First line
-    if(line <= firstUsefulLineNumber){
+    if(m_job->isEmpty()){
         m_lineToSendIndex = 0;
-        m_lastLineParsedByGrbl = 0;
+        m_lineToQueueIndex = 0;
+        m_lastIndexParsedByGrbl = -1;
+        return;
     }
-    else {
-        //Last Line
-        if(line >= lastUsefulLineNumber){
-            m_lineToSendIndex = lastLineIndex;
-        }
 
-        //Any other line, we need to iterate to find the correct line
-        else{
-            //Start from 'line' index, which is always greater than the correct index (due to useless lines not added to linevector)
-            //then iterate until we find the perfect line number, or a smaller one
-            m_lineToSendIndex = qMin(line,lastLineIndex-1);
-            while(m_lineToSendIndex > 0 && getCurrentLineNumber() >= line){
-                m_lineToSendIndex--;
-            }
-
-            //If we did not find the exact index (due to seeked line being useless, so not part of vector),
-            // Go to the next line
-            if(line > getCurrentLineNumber()){
-                m_lineToSendIndex++;
-            }
-        }
+    m_lineToSendIndex = m_job->indexOfLine(line);
+    m_lineToQueueIndex = m_lineToSendIndex;
 
-        //Set previous instruction as parsed
-        m_lastLineParsedByGrbl = m_usefulLinesVector.at(m_lineToSendIndex-1).getLineNumber();
-    }
+    //Set previous instruction as parsed
+    m_lastIndexParsedByGrbl = m_lineToSendIndex - 1;
+    m_follower->setConsumedLineCount(m_lineToSendIndex);
 
     //Next instruction to be processed is the first on in buffer
     emit currentLineUpdated(getCurrentLineNumber());
@@ -145,49 +363,75 @@ void GCodeStreamer::goToLine(int line){
 
 
 void GCodeStreamer::go(void){
-    if(!m_usefulLinesVector.isEmpty()){
+    if(!m_job->isEmpty() && checkJobSource()){
         m_run = true;
+        m_isLookaheadReached = false;
         tryToSendNextInstruction();
         emit stateChanged(state_running);
     }
 }
 
 void GCodeStreamer::step(){
-    if(!m_usefulLinesVector.isEmpty()){
+    if(!m_job->isEmpty() && checkJobSource()){
         m_run = false;
+        m_isLookaheadReached = true;
         tryToSendNextInstruction();
         emit stateChanged(state_ready);
     }
 }
 
 void GCodeStreamer::stop(){
+    //Stop while loading cancels the load, or the follow of a source which gave no line yet
+    if(getState() == state_loading){
+        clear();
+        return;
+    }
+
     m_run = false;
+    requestQueueFlush();
     emit stateChanged(state_ready);
+
+    if(m_isReloadPending){
+        m_reloadTimer.start();
+    }
 }
 
 
 void GCodeStreamer::onGrblStatusUpdated(GrblStatus* const status){
     int instructionsInPlanningBuffer = status->containsMotionsPlanned() ? status->getMotionsPlanned() : 0;
 
-    int executedLine = m_lastLineParsedByGrbl - instructionsInPlanningBuffer;
+    //Planned instructions are counted in useful lines, not in file lines
+    int executedIndex = qMin(m_lastIndexParsedByGrbl - instructionsInPlanningBuffer, m_job->size()-1);
+    int executedLine = (executedIndex >= 0) ? m_job->getLineNumber(executedIndex) : 0;
     emit currentLineUpdated(executedLine);
 
+    //Remaining duration, from the time estimated for each line at load
+    if(m_run && executedIndex >= 0){
+        quint32 elapsed = m_job->getEstimatedTime(executedIndex);
+        emit estimatedDurationUpdated(m_estimatedDuration - qMin(elapsed,m_estimatedDuration));
+    }
+
     //work should be complete when :
     //  - currently running
     //  - line count is not null
+    //  - no line is to be appended anymore
     //  - last line was executed
     //  - board is not in "run" state anymore
-    if(m_run && !m_usefulLinesVector.isEmpty() && executedLine == m_usefulLinesVector.last().getLineNumber() && status->getState() != GrblStatus::state_run){
+    if(m_run && !m_job->isEmpty() && m_job->isComplete() && executedIndex == m_job->size()-1 && status->getState() != GrblStatus::state_run){
         m_run = false;
         emit workCompleted();
         emit stateChanged(state_ready);
+
+        if(m_isReloadPending){
+            m_reloadTimer.start();
+        }
     }
 }
 
 void GCodeStreamer::onInstructionParsedByGrbl(const GrblInstruction &parsedInstruction){
     int parsedLineNumber = parsedInstruction.getLineNumber();
-    if( parsedLineNumber >= 0){
-        m_lastLineParsedByGrbl = parsedLineNumber;
+    if( parsedLineNumber >= 0 && !m_job->isEmpty()){
+        m_lastIndexParsedByGrbl = m_job->indexOfLine(parsedLineNumber);
     }
 
     if(m_run){
@@ -196,51 +440,147 @@ void GCodeStreamer::onInstructionParsedByGrbl(const GrblInstruction &parsedInstr
 }
 
 void GCodeStreamer::onInstructionSentToGrbl(const GrblInstruction &acceptedInstruction){
-    //If there is actually something to send
-    if(m_usefulLinesVector.isEmpty()){
+    //Only lines queued by the streamer move the read head, they are sent in order
+    if(m_queuedLines.isEmpty() || acceptedInstruction != m_queuedLines.head().instruction){
         return;
     }
 
-    //If we already sent all useful lines, no need to continue
-    if(m_lineToSendIndex >= m_usefulLinesVector.size()){
-        return;
+    QueuedLine sentLine = m_queuedLines.dequeue();
+    if(sentLine.generation == m_queueGeneration){
+        m_lineToSendIndex = sentLine.index + 1;
+        m_follower->setConsumedLineCount(m_lineToSendIndex);
     }
 
-    //This is not the instruction you're looking for
-    if(acceptedInstruction != m_usefulLinesVector.at(m_lineToSendIndex)){
+    if(m_isQueueFlushPending){
+        if(m_queuedLines.isEmpty()){
+            finishQueueFlush();
+        }
+    }
+    else if(m_run){
+        //Keep the board queue filled ahead
+        tryToSendNextInstruction();
+    }
+}
+
+void GCodeStreamer::onInstructionDiscardedByGrbl(const GrblInstruction &discardedInstruction){
+    //Line being queued never reached the board, the ones before it are still on their way : it is taken back once they are
+    if(m_isQueueingLine){
+        m_isQueueFull = true;
         return;
     }
 
-    //Try to avoid an index out of range
-    int lastUsefulLineIndex = m_usefulLinesVector.size()-1;
-    if(m_lineToSendIndex > lastUsefulLineIndex){
+    if(m_queuedLines.isEmpty() || discardedInstruction != m_queuedLines.head().instruction){
         return;
     }
 
-    //Then we cant safely increment
-    m_lineToSendIndex++;
+    m_queuedLines.dequeue();
+
+    //Whatever the reason, lines queued after it must not be sent either : resume from the first line not sent
+    requestQueueFlush();
+    if(m_queuedLines.isEmpty()){
+        finishQueueFlush();
+    }
+}
+
+void GCodeStreamer::requestQueueFlush(){
+    if(!m_queuedLines.isEmpty() && !m_isQueueFlushPending){
+        m_isQueueFlushPending = true;
+        emit queueFlushRequested();
+    }
+}
+
+void GCodeStreamer::finishQueueFlush(){
+    //Every queued line came back as sent or discarded
+    m_isQueueFlushPending = false;
+    m_lineToQueueIndex = m_lineToSendIndex;
 
-    //Schedule sending next instruction
     if(m_run){
-        QTimer::singleShot(0, this, &GCodeStreamer::tryToSendNextInstruction);
+        tryToSendNextInstruction();
     }
 }
 
 
 void GCodeStreamer::tryToSendNextInstruction(){
-    if(m_lineToSendIndex < m_usefulLinesVector.size() ){
-        m_usefulLinesVector[m_lineToSendIndex].regenerate();
-        emit instructionToSend(m_usefulLinesVector.at(m_lineToSendIndex));
+    //Queue is refilled only once lines queued before a flush all came back
+    if(m_isQueueFlushPending){
+        return;
+    }
+
+    //A job still being written is started, or resumed after running dry, once enough lines are buffered ahead
+    if(!m_job->isComplete() && !m_isLookaheadReached && !m_isSourceQuiet){
+        if(m_job->size() - m_lineToQueueIndex < FOLLOW_LOOKAHEAD_LINES){
+            return;
+        }
+        m_isLookaheadReached = true;
+    }
+    if(!m_job->isComplete() && m_lineToQueueIndex >= m_job->size()){
+        m_isLookaheadReached = false;
+    }
+
+    //Board sends queued lines itself as soon as they fit, a step only queues one
+    int maxQueuedLines = m_run ? STREAM_QUEUE_DEPTH : 1;
+    if(m_lineToQueueIndex >= m_job->size() || m_queuedLines.size() >= maxQueuedLines){
+        return;
+    }
+
+    //Checked once per refill, not per line : it may stat the file
+    if(!checkJobSource()){
+        return;
+    }
+
+    while(m_lineToQueueIndex < m_job->size() && m_queuedLines.size() < maxQueuedLines && !m_isQueueFlushPending){
+        //Let the job read ahead of the send head if it needs to
+        m_job->prefetch(m_lineToQueueIndex);
+
+        //Materialize the instruction : from now on, it may outlive the job
+        QueuedLine line = {m_job->getInstruction(m_lineToQueueIndex), m_lineToQueueIndex, m_queueGeneration};
+        line.instruction.detach();
+        m_queuedLines.enqueue(line);
+        m_lineToQueueIndex++;
+
+        m_isQueueingLine = true;
+        emit instructionToSend(line.instruction);
+        m_isQueueingLine = false;
+
+        //Board queue is full : nothing after this line may be queued, it is queued again on the next refill
+        if(m_isQueueFull){
+            m_isQueueFull = false;
+            m_queuedLines.removeLast();
+            m_lineToQueueIndex--;
+            return;
+        }
+    }
+}
+
+bool GCodeStreamer::checkJobSource(){
+    //Stat of the file is done at a bounded rate, a change seen by the file watcher is taken at once
+    if(m_sourceCheckTimer.isValid() && m_sourceCheckTimer.elapsed() < SOURCE_CHECK_INTERVAL_MS){
+        return true;
+    }
+    m_sourceCheckTimer.start();
+
+    if(!m_job->isSourceChanged()){
+        return true;
+    }
+
+    //Old offsets in a new file would mix two programs in one toolpath : lines already queued are the old file's,
+    //nothing more is sent until the file is loaded again
+    int line = getCurrentLineNumber();
+    if(m_run){
+        stop();
     }
+    emit streamError(tr("%1 changed on disk while it was being streamed : stopped at line %2, load it again to go on")
+                     .arg(QFileInfo(m_filePath).fileName()).arg(line));
+    return false;
 }
 
 int GCodeStreamer::getCurrentLineNumber(){
     int currentLineNumber = 0;
-    if(!m_usefulLinesVector.isEmpty()){
+    if(!m_job->isEmpty()){
         //Since m_currentLinuxIndex can go 1 unit after last line, clamp it
-        int currentLineIndex = qMin(m_lineToSendIndex, m_usefulLinesVector.size()-1);
+        int currentLineIndex = qMin(m_lineToSendIndex, m_job->size()-1);
 
-        currentLineNumber = m_usefulLinesVector.at(currentLineIndex).getLineNumber();
+        currentLineNumber = m_job->getLineNumber(currentLineIndex);
     }
     return (currentLineNumber);
 }
@@ -4,8 +4,16 @@
 #include <QObject>
 #include <QVector>
 #include <QByteArray>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QQueue>
 
 #include "grblinstruction.h"
+#include "gcodejob.h"
+#include "gcodeloader.h"
+#include "gcodefollower.h"
 #include "grblboard.h"
 #include "grblstatus.h"
 
@@ -13,15 +21,25 @@ class GCodeStreamer : public QObject
 {
     Q_OBJECT
 public:
-    enum states {state_clear, state_ready, state_running};
+    enum states {state_clear, state_loading, state_ready, state_running};
 
     explicit GCodeStreamer(QObject *parent = 0);
+    ~GCodeStreamer();
 
     states getState(void);
 
 signals:
     void fileLoaded(QString filename);
-    void instructionLoaded(GrblInstruction instruction);
+
+    //Loading runs in a worker thread, results are delivered in batches
+    void loadRequested(const QString &path, int loadId);
+    void reloadRequested(const QString &path, int loadId);
+    void followRequested(const QString &path, int followId);
+    void loadingProgress(int percent);
+    void primitivesLoaded(QVector<GCodePrimitive> primitives);
+    void primitivesTruncated(int firstLine);
+    void estimatedDurationUpdated(uint32_t duration);
+    void boundsUpdated(QVector3D boundsMin, QVector3D boundsMax);
 
     void cleared();
 
@@ -32,7 +50,12 @@ signals:
 
     void workCompleted(void);
 
+    //Stream was stopped because its lines can no longer be trusted, or file could not be loaded
+    void streamError(const QString &message);
+
+    //Lines are queued to the board ahead, it sends them as soon as they fit
     void instructionToSend(GrblInstruction instruction);
+    void queueFlushRequested();
 
 public slots:
 
@@ -43,33 +66,82 @@ public slots:
 
     //open / close file
     void loadFile(const QString &m_file);
+    //Stream a file while it is written : growing file, named pipe, or standard input ("-")
+    void followFile(const QString &path);
     void clear();
 
+    //Reload file when it is modified on disk
+    void setFileWatched(bool isWatched);
+
     //Move inside file
     void rewind(){goToLine(0);}
     void goToLine(int line);
 
     //Grbl board related slots
     void onInstructionSentToGrbl(const GrblInstruction &acceptedInstruction);
+    void onInstructionDiscardedByGrbl(const GrblInstruction &discardedInstruction);
     void onInstructionParsedByGrbl(const GrblInstruction &parsedInstruction);
     void onGrblStatusUpdated(GrblStatus* const status);
 
+private slots:
+    void onLoaderProgress(int loadId, qint64 done, qint64 total);
+    void onLoaderPrimitivesParsed(int loadId, QVector<GCodePrimitive> primitives);
+    void onLoaderBoundsComputed(int loadId, QVector3D boundsMin, QVector3D boundsMax);
+    void onLoaderGeometryTruncated(int loadId, int firstLine);
+    void onWatchedFileChanged();
+    void onReloadTimeout();
+    void onLoaderJobLoaded(int loadId, GCodeJob *job, quint32 machineTime);
+    void onLoaderLoadFailed(int loadId, const QString &reason);
+    void onFollowerLinesRead(int followId, GCodeLineBatch batch);
+    void onFollowerPrimitivesParsed(int followId, QVector<GCodePrimitive> primitives);
+    void onFollowerSourceQuiet(int followId);
+    void onFollowerFinished(int followId, bool isOpened);
 
 private:
-    //void bufferizeIntructions(void);
-    void cleanupLine(QByteArray* code);
     void tryToSendNextInstruction();
+    bool checkJobSource();
+    void requestQueueFlush();
+    void finishQueueFlush();
     int getCurrentLineNumber();
 
-    int m_lineCount;
+    //Line handed to the board, neither sent nor discarded yet
+    struct QueuedLine{
+        GrblInstruction instruction;
+        int index;
+        int generation;
+    };
+
     int m_lineToSendIndex; //Position of read head in the file
-    int m_lastLineParsedByGrbl;       //Last line accepted in planning buffer by grbl
+    int m_lineToQueueIndex;     //Next line to queue to the board, ahead of the read head
+    QQueue<QueuedLine> m_queuedLines;
+    int m_queueGeneration;      //Bumped on each jump in the file, lines queued before no longer move the read head
+    bool m_isQueueFlushPending; //Waiting for queued lines to come back before queueing again
+    bool m_isQueueingLine;      //Line being handed to the board, which discards it at once when its queue is full
+    bool m_isQueueFull;
+    int m_lastIndexParsedByGrbl;       //Index of last line accepted in planning buffer by grbl, -1 if none
 
     bool m_run;
 
-    QVector<GrblInstruction> m_usefulLinesVector;
-
-    static const char *s_gcodeCommentsDelimiters[]; //List of EEPROM related instructions, requiring use of simpler "blocking" protocol
+    QThread m_loaderThread;
+    GCodeLoader* m_loader;
+    int m_loadId;           //Identifier of the load in progress, 0 if none
+
+    QThread m_followerThread;
+    GCodeFollower* m_follower;
+    int m_followId;             //Identifier of the followed source still being read, 0 if none
+    bool m_isLookaheadReached;  //Lines of a job still being written are only sent once enough of them are buffered
+    bool m_isSourceQuiet;       //Followed source stopped growing : lines buffered so far are sent without lookahead
+
+    QString m_filePath;
+    QFileSystemWatcher m_fileWatcher;
+    QTimer m_reloadTimer;       //Writers often save a file in several steps, wait for the last one
+    QElapsedTimer m_sourceCheckTimer;   //Since the job source was last checked on disk
+    bool m_isFileWatched;
+    bool m_isReloadPending;     //File changed while running, reload once stopped
+    bool m_isReloading;         //Load in progress only updates current job, view is kept
+
+    GCodeJob* m_job;
+    quint32 m_estimatedDuration;    //Machine time of the whole job, ms
 
 };
 
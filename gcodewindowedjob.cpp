@@ -0,0 +1,217 @@
+#include "gcodewindowedjob.h"
+
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <algorithm>
+
+#define WINDOW_LINE_COUNT   4096    //Useful lines per window, also spacing of sparse index checkpoints
+
+GCodeWindowedJob::GCodeWindowedJob():
+    m_sourceSize(0),
+    m_isSourceChanged(false),
+    m_size(0),
+    m_lineCount(0),
+    m_lastLineNumber(0),
+    m_machineTime(0),
+    m_nextWindowNumber(-1)
+{
+    m_window.firstIndex = 0;
+    m_previousWindow.firstIndex = 0;
+}
+
+GCodeWindowedJob::~GCodeWindowedJob(){
+    clear();
+}
+
+void GCodeWindowedJob::setFilePath(const QString &path){
+    clear();
+    m_path = path;
+
+    //Taken before indexing, so that a change while indexing is seen too
+    QFileInfo sourceInfo(path);
+    m_sourceSize = sourceInfo.size();
+    m_sourceModified = sourceInfo.lastModified();
+    m_isSourceChanged = false;
+}
+
+void GCodeWindowedJob::appendIndexedLine(const GCodeLine &line, quint32 machineTime){
+    //Each window starts with a checkpoint
+    if(m_size % WINDOW_LINE_COUNT == 0){
+        Checkpoint checkpoint = {line.fileOffset, line.lineNumber - 1, line.lineNumber, machineTime};
+        m_checkpoints.append(checkpoint);
+    }
+
+    m_size++;
+    m_lastLineNumber = line.lineNumber;
+}
+
+void GCodeWindowedJob::finishIndexing(int lineCount, quint32 machineTime){
+    m_lineCount = lineCount;
+    m_machineTime = machineTime;
+    m_checkpoints.squeeze();
+}
+
+void GCodeWindowedJob::clear(){
+    //A window being read ahead is simply dropped, it does not depend on this object
+    m_nextWindow = QFuture<Window>();
+    m_nextWindowNumber = -1;
+
+    m_window = Window();
+    m_window.firstIndex = 0;
+    m_previousWindow = Window();
+    m_previousWindow.firstIndex = 0;
+
+    m_checkpoints.clear();
+    m_size = 0;
+    m_lineCount = 0;
+    m_lastLineNumber = 0;
+    m_machineTime = 0;
+}
+
+QString GCodeWindowedJob::getFileName() const{
+    return QFileInfo(m_path).baseName();
+}
+
+int GCodeWindowedJob::getLineNumber(int index){
+    //Those do not require any read
+    if(index == m_size-1){
+        return m_lastLineNumber;
+    }
+    if(index % WINDOW_LINE_COUNT == 0){
+        return m_checkpoints.at(index / WINDOW_LINE_COUNT).firstLineNumber;
+    }
+
+    //File may have been altered since it was indexed
+    const Window &window = windowFor(index);
+    if(!window.contains(index)){
+        return 0;
+    }
+
+    return window.entries.at(index - window.firstIndex).lineNumber;
+}
+
+GrblInstruction GCodeWindowedJob::getInstruction(int index){
+    const Window &window = windowFor(index);
+    if(!window.contains(index)){
+        return GrblInstruction();
+    }
+
+    const WindowEntry &entry = window.entries.at(index - window.firstIndex);
+
+    //Window may be replaced at any time, so instruction must own its bytes
+    GrblInstruction instruction = GrblInstruction::fromRawData(window.arena.constData() + entry.offset, entry.length, entry.lineNumber);
+    instruction.detach();
+    return instruction;
+}
+
+const char *GCodeWindowedJob::getLineData(int index, int *length){
+    const Window &window = windowFor(index);
+    if(!window.contains(index)){
+        *length = 0;
+        return window.arena.constData();
+    }
+
+    const WindowEntry &entry = window.entries.at(index - window.firstIndex);
+    *length = entry.length;
+    return window.arena.constData() + entry.offset;
+}
+
+int GCodeWindowedJob::indexOfLine(int line){
+    if(m_size == 0){
+        return 0;
+    }
+
+    //Locate the window containing the line thanks to the sparse index : last checkpoint not after line
+    QVector<Checkpoint>::const_iterator checkpoint = std::upper_bound(m_checkpoints.constBegin(), m_checkpoints.constEnd(), line,
+                                                                      [](int seekedLine, const Checkpoint &c){return seekedLine < c.firstLineNumber;});
+    int windowNumber = qMax(0, int(checkpoint - m_checkpoints.constBegin()) - 1);
+
+    //Then search inside the window. When line is after the last one of the window, next window starts with the right index
+    const Window &window = windowFor(windowNumber * WINDOW_LINE_COUNT);
+    QVector<WindowEntry>::const_iterator entry = std::lower_bound(window.entries.constBegin(), window.entries.constEnd(), line,
+                                                                  [](const WindowEntry &e, int seekedLine){return e.lineNumber < seekedLine;});
+
+    return qMin(window.firstIndex + int(entry - window.entries.constBegin()), m_size - 1);
+}
+
+quint32 GCodeWindowedJob::getEstimatedTime(int index){
+    if(index < 0 || index >= m_size){
+        return 0;
+    }
+
+    //Lines of a window are taken as lasting the same time, no read is needed
+    int windowNumber = index / WINDOW_LINE_COUNT;
+    int firstIndex = windowNumber * WINDOW_LINE_COUNT;
+    int windowSize = qMin(WINDOW_LINE_COUNT, m_size - firstIndex);
+    quint32 timeBefore = m_checkpoints.at(windowNumber).machineTimeBefore;
+    quint32 timeAfter = (windowNumber + 1 < m_checkpoints.size()) ? m_checkpoints.at(windowNumber + 1).machineTimeBefore : m_machineTime;
+
+    return timeBefore + quint32(quint64(timeAfter - timeBefore) * quint64(index - firstIndex + 1) / quint64(windowSize));
+}
+
+bool GCodeWindowedJob::isSourceChanged(){
+    if(!m_isSourceChanged && !m_path.isEmpty()){
+        QFileInfo sourceInfo(m_path);
+        m_isSourceChanged = !sourceInfo.exists() || sourceInfo.size() != m_sourceSize || sourceInfo.lastModified() != m_sourceModified;
+    }
+    return m_isSourceChanged;
+}
+
+void GCodeWindowedJob::prefetch(int index){
+    if(!m_window.contains(index)){
+        return;
+    }
+
+    //Once read head is past the middle of the window, start reading the next one
+    int nextWindowNumber = index / WINDOW_LINE_COUNT + 1;
+    if(index - m_window.firstIndex >= WINDOW_LINE_COUNT / 2 && nextWindowNumber < m_checkpoints.size() && m_nextWindowNumber != nextWindowNumber){
+        m_nextWindow = QtConcurrent::run(&GCodeWindowedJob::readWindow, m_path, m_checkpoints.at(nextWindowNumber), nextWindowNumber * WINDOW_LINE_COUNT, WINDOW_LINE_COUNT);
+        m_nextWindowNumber = nextWindowNumber;
+    }
+}
+
+const GCodeWindowedJob::Window &GCodeWindowedJob::windowFor(int index){
+    if(m_window.contains(index)){
+        return m_window;
+    }
+
+    //Lines just executed are looked up while the read head is already in the next window
+    if(m_previousWindow.contains(index)){
+        return m_previousWindow;
+    }
+
+    int windowNumber = index / WINDOW_LINE_COUNT;
+    m_previousWindow = m_window;
+
+    //Use the window read ahead if it is the right one, otherwise read it now
+    if(windowNumber == m_nextWindowNumber){
+        m_window = m_nextWindow.result();
+        m_nextWindow = QFuture<Window>();
+        m_nextWindowNumber = -1;
+    }
+    else{
+        m_window = readWindow(m_path, m_checkpoints.at(windowNumber), windowNumber * WINDOW_LINE_COUNT, WINDOW_LINE_COUNT);
+    }
+
+    return m_window;
+}
+
+GCodeWindowedJob::Window GCodeWindowedJob::readWindow(const QString &path, const Checkpoint &checkpoint, int firstIndex, int lineCount){
+    Window window;
+    window.firstIndex = firstIndex;
+    window.entries.reserve(lineCount);
+
+    GCodeLineReader reader;
+    if(!reader.open(path) || !reader.seek(checkpoint.fileOffset, checkpoint.lineCountBefore)){
+        return window;
+    }
+
+    GCodeLine line;
+    while(window.entries.size() < lineCount && reader.readLine(&line)){
+        WindowEntry entry = {window.arena.size(), line.length, line.lineNumber};
+        window.entries.append(entry);
+        window.arena.append(line.data, line.length);
+    }
+
+    return window;
+}
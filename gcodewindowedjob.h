@@ -0,0 +1,95 @@
+#ifndef GCODEWINDOWEDJOB_H
+#define GCODEWINDOWEDJOB_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QFuture>
+#include <QDateTime>
+
+#include "gcodejob.h"
+#include "gcodelinereader.h"
+
+//Gives access to a gcode file too large to be held in memory
+//Only a sparse index and a sliding window of lines around the read head are kept, next window is read ahead in background
+class GCodeWindowedJob : public GCodeJob
+{
+public:
+    GCodeWindowedJob();
+    ~GCodeWindowedJob();
+
+    //Indexing is driven by the reader of the file, lines must be appended in order
+    void setFilePath(const QString &path);
+    //Machine time is the one estimated before line is executed
+    void appendIndexedLine(const GCodeLine &line, quint32 machineTime);
+    void finishIndexing(int lineCount, quint32 machineTime);
+
+    void clear() Q_DECL_OVERRIDE;
+
+    QString getFileName() const Q_DECL_OVERRIDE;
+
+    int size() const Q_DECL_OVERRIDE {return m_size;}
+    int getLineCount() const Q_DECL_OVERRIDE {return m_lineCount;}
+
+    int getLineNumber(int index) Q_DECL_OVERRIDE;
+
+    //Returned instruction owns its bytes
+    GrblInstruction getInstruction(int index) Q_DECL_OVERRIDE;
+
+    const char *getLineData(int index, int *length) Q_DECL_OVERRIDE;
+
+    int indexOfLine(int line) Q_DECL_OVERRIDE;
+
+    //Interpolated within a window, from the times recorded at its checkpoint and at the next one
+    quint32 getEstimatedTime(int index) Q_DECL_OVERRIDE;
+
+    void prefetch(int index) Q_DECL_OVERRIDE;
+
+    //Windows are read from the file all along the job
+    bool isSourceChanged() Q_DECL_OVERRIDE;
+    void setSourceChanged() Q_DECL_OVERRIDE {m_isSourceChanged = true;}
+
+private:
+    //Position of the first useful line of each window
+    struct Checkpoint{
+        qint64 fileOffset;
+        int lineCountBefore;
+        int firstLineNumber;
+        quint32 machineTimeBefore;      //Estimated machine time before the first line of the window
+    };
+
+    struct WindowEntry{
+        int offset;
+        int length;
+        int lineNumber;
+    };
+
+    struct Window{
+        int firstIndex;
+        QByteArray arena;
+        QVector<WindowEntry> entries;
+
+        bool contains(int index) const {return index >= firstIndex && index < firstIndex + entries.size();}
+    };
+
+    const Window &windowFor(int index);
+    static Window readWindow(const QString &path, const Checkpoint &checkpoint, int firstIndex, int lineCount);
+
+    QString m_path;
+    qint64 m_sourceSize;            //File as it was indexed
+    QDateTime m_sourceModified;
+    bool m_isSourceChanged;
+    QVector<Checkpoint> m_checkpoints;
+    int m_size;
+    int m_lineCount;
+    int m_lastLineNumber;
+    quint32 m_machineTime;          //Estimated for the whole job
+
+    Window m_window;
+    Window m_previousWindow;    //Kept so that lines behind the read head do not evict the current window
+    QFuture<Window> m_nextWindow;
+    int m_nextWindowNumber;     //Window being read ahead, -1 if none
+
+    Q_DISABLE_COPY(GCodeWindowedJob)
+};
+
+#endif // GCODEWINDOWEDJOB_H
@@ -0,0 +1,72 @@
+#-------------------------------------------------
+#
+# Board, streaming and job loading code, without any
+# widget : shared by G-Commander and its tests
+#
+#-------------------------------------------------
+
+INCLUDEPATH += $$PWD
+
+#Compressed gcode files are supported for each library found
+CONFIG += link_pkgconfig
+packagesExist(zlib){
+    PKGCONFIG += zlib
+    DEFINES += HAVE_ZLIB
+}
+packagesExist(libzstd){
+    PKGCONFIG += libzstd
+    DEFINES += HAVE_ZSTD
+}
+
+SOURCES += \
+    $$PWD/grblboard.cpp \
+    $$PWD/grblstatus.cpp \
+    $$PWD/grblinstruction.cpp \
+    $$PWD/gcodestreamer.cpp \
+    $$PWD/gcodeparser.cpp \
+    $$PWD/grblconfiguration.cpp \
+    $$PWD/gcodejob.cpp \
+    $$PWD/gcodeindexedjob.cpp \
+    $$PWD/gcodewindowedjob.cpp \
+    $$PWD/gcodelinereader.cpp \
+    $$PWD/gcodeloader.cpp \
+    $$PWD/gcodejobcache.cpp \
+    $$PWD/gcodedecompressor.cpp \
+    $$PWD/gcodefollowedjob.cpp \
+    $$PWD/gcodefollower.cpp \
+    $$PWD/grblserialworker.cpp \
+    $$PWD/grblresponsereader.cpp \
+    $$PWD/grblcharbuffer.cpp \
+    $$PWD/grblfeedgovernor.cpp \
+    $$PWD/grblemulator.cpp \
+    $$PWD/grbllatencyhistogram.cpp \
+    $$PWD/grbldiagnostics.cpp \
+    $$PWD/grbltelemetry.cpp
+
+HEADERS += \
+    $$PWD/grblboard.h \
+    $$PWD/grblstatus.h \
+    $$PWD/grbldefinitions.h \
+    $$PWD/grblinstruction.h \
+    $$PWD/gcodestreamer.h \
+    $$PWD/gcodeparser.h \
+    $$PWD/grblconfiguration.h \
+    $$PWD/gcodejob.h \
+    $$PWD/gcodeindexedjob.h \
+    $$PWD/gcodewindowedjob.h \
+    $$PWD/gcodelinereader.h \
+    $$PWD/gcodeloader.h \
+    $$PWD/gcodejobcache.h \
+    $$PWD/gcodedecompressor.h \
+    $$PWD/gcodefollowedjob.h \
+    $$PWD/gcodefollower.h \
+    $$PWD/grblserialworker.h \
+    $$PWD/spscqueue.h \
+    $$PWD/grblresponsereader.h \
+    $$PWD/grblcharbuffer.h \
+    $$PWD/grblprioritymetrics.h \
+    $$PWD/grblfeedgovernor.h \
+    $$PWD/grblemulator.h \
+    $$PWD/grbllatencyhistogram.h \
+    $$PWD/grbldiagnostics.h \
+    $$PWD/grbltelemetry.h
@@ -1,43 +1,72 @@
 #include "grblboard.h"
+#include "grblserialworker.h"
 #include "grbldefinitions.h"
 
-#define DEFAULT_STATUS_REQUEST_INTERVAL 250
-
-
-const QMap<int,QString> GrblBoard::errorTranslationMap = GrblBoard::generateErrorTranslationMap();
+#define REPLAY_INTERVAL_MS      10
+#define REPLAY_MAX_SPEED        100
 
 GrblBoard::GrblBoard(QObject *parent) :
     QObject(parent),
-    m_status(false)
+    m_status(false),
+    m_rxBufferSize(BOARD_RX_BUFFER_SIZE),
+    m_plannerBlockCount(BOARD_PLANNER_BLOCKS),
+    m_replaySpeed(1),
+    m_hasReplayRecord(false),
+    m_replayTime(0)
 {
-    m_serialPort = new QSerialPort(this);
-    connect(m_serialPort, &QSerialPort::readyRead, this, &GrblBoard::onSerialDataAvailable);
+    m_worker = new GrblSerialWorker();
+    m_worker->moveToThread(&m_serialThread);
+    connect(&m_serialThread,&QThread::finished,m_worker,&QObject::deleteLater);
+    connect(m_worker,&GrblSerialWorker::eventsAvailable,this,&GrblBoard::onEventsAvailable);
+
+    m_replayTimer = new QTimer(this);
+    m_replayTimer->setTimerType(Qt::PreciseTimer);
+    m_replayTimer->setInterval(REPLAY_INTERVAL_MS);
+    connect(m_replayTimer,&QTimer::timeout,this,&GrblBoard::onReplayTimeout);
+
+    //Board must be served before anything displayed
+    m_serialThread.start(QThread::TimeCriticalPriority);
+}
+
+GrblBoard::~GrblBoard(){
+    m_serialThread.quit();
+    m_serialThread.wait();
+}
 
-    m_statusTimer = new QTimer(this);
-    m_statusTimer->setInterval(DEFAULT_STATUS_REQUEST_INTERVAL);
-    connect(m_statusTimer,&QTimer::timeout,this,&GrblBoard::rtCmdRequestStatus);
+bool GrblBoard::postCommand(const GrblBoardCommand &command){
+    return m_worker->postCommand(command);
+}
 
-    //Build instruction to send at startup list
-    m_startupInstructionList.append(GrblInstruction(QStringLiteral(INST_GET_PARAMS)));
+void GrblBoard::postRealtimeCommand(const QByteArray &command){
+    GrblBoardCommand realtimeCommand;
+    realtimeCommand.type = GrblBoardCommand::command_realtime;
+    realtimeCommand.bytes = command;
+    realtimeCommand.requestTime = m_worker->getTime();      //Latency of feed hold and the like is timed from here
+    postRealtimeCommand(realtimeCommand);
+}
+
+void GrblBoard::postRealtimeCommand(const GrblBoardCommand &command){
+    //Only a serial thread stuck for a while lets the realtime queue fill : the operator must know
+    if(!m_worker->postRealtimeCommand(command)){
+        emit realtimeCommandRejected(tr("Board is not served, real time command was not sent"));
+    }
 }
 
 void GrblBoard::setSerialSettings(const QString &portName, const qint32 &baudRate){
-    m_serialPort->setPortName(portName);
-    m_serialPort->setBaudRate(baudRate);
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_serial_settings;
+    command.portName = portName;
+    command.value = baudRate;
+    postCommand(command);
 }
 
 void GrblBoard::toggleSerial(){
-    if(m_serialPort->isOpen()){
-        m_serialPort->close();
-        m_statusTimer->stop();
-        m_status = GrblStatus(false);
-    }
-    else if(m_serialPort->open(QSerialPort::ReadWrite)){
-        m_status = GrblStatus(true);
-        rtCmdSoftReset();     //Immediately performs a soft reset so the board is in a known state
-    }
+    //Replayed statuses would mix with the board ones
+    stopTelemetryReplay();
 
-    emit statusUpdated(&m_status);
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_toggle_serial;
+    postCommand(command);
 }
 
 const GrblStatus *GrblBoard::getLastStatus(void) const{
@@ -48,202 +77,268 @@ QMap<int,GrblConfiguration> *GrblBoard::getParametersMap(void){
     return &m_parametersMapComplete;
 }
 
-void GrblBoard::setStatusRequestInterval(const int &interval){
-    m_statusTimer->setInterval( interval);
+int GrblBoard::getQueuedInstructionCount(void) const{
+    return m_worker->getQueuedInstructionCount();
 }
 
-void GrblBoard::onSerialDataAvailable(){
-    m_bufferFromBoard.append(m_serialPort->readAll());
-
-    while(m_bufferFromBoard.contains(LINE_SEPARATOR_STRING)){
-        //Locate next line separator, marking end of the current line
-        int lineSeparatorIndex = m_bufferFromBoard.indexOf(LINE_SEPARATOR_STRING,0);
-
-        //We got a complete line to parse, extract it from buffer
-        QString line = QString::fromLatin1(m_bufferFromBoard.left(lineSeparatorIndex));
-        m_bufferFromBoard.remove(0,lineSeparatorIndex+LINE_SEPARATOR_LENGTH);
-
-        //Get the instruction currently executed by the board
-        GrblInstruction relatedInstruction = m_boardCharBuffer.isEmpty() ? GrblInstruction("") : m_boardCharBuffer.first();
-
-        //Ok
-        if(line == QStringLiteral(RESPONSE_OK)){
-            if(!m_boardCharBuffer.isEmpty())m_boardCharBuffer.removeFirst();    //Instruction processed, not in char buffer any more
-
-            //If received "ok" for a parameter fetch instruction, swap the parameter maps to make the new one available
-            if(relatedInstruction.isParameterFetch()){
-                m_parametersMapComplete.swap(m_parametersMapBeingFilled);
-                m_parametersMapBeingFilled.clear();
-                emit parametersMapUpdated(&m_parametersMapComplete);
-            }
-
-            emit ok(relatedInstruction);
-        }
-
-        //Error message
-        else if(line.startsWith(RESPONSE_ERROR)){
-            if(!m_boardCharBuffer.isEmpty())m_boardCharBuffer.removeFirst();    //Instruction processed, not in char buffer any more
-            addErrorTranslation(&line);
-            emit error(relatedInstruction,line);
-        }
-
-        //Alarm message
-        else if(line.startsWith(RESPONSE_ALARM)){
-            emit alarm(relatedInstruction,line);
-        }
-
-        //Status message
-        else if(line.startsWith(RESPONSE_STATUS_START) && line.endsWith(RESPONSE_STATUS_END)){
-            bool isBoardReportingInches = m_parametersMapComplete.value(GRBL_PARAM_REPORT_INCHES).getValue().toBool();
+int GrblBoard::getPendingWriteSize(void) const{
+    return m_worker->getPendingWriteSize();
+}
 
-            m_status = GrblStatus(line,isBoardReportingInches,&m_status);
+int GrblBoard::getStatusRequestInterval(void) const{
+    return m_worker->getStatusRequestInterval();
+}
 
-            emit statusUpdated(&m_status);
-        }
+int GrblBoard::getLastStatusLatency(void) const{
+    return m_worker->getLastStatusLatency();
+}
 
-        //Feedback message
-        else if(line.startsWith(RESPONSE_FEEDBACK_START) && line.endsWith(RESPONSE_FEEDBACK_END)){
-            emit feedback(relatedInstruction,line);
-        }
+int GrblBoard::getAverageStatusLatency(void) const{
+    return m_worker->getAverageStatusLatency();
+}
 
-        //Startup message
-        else if(line.startsWith(VERSION_STRING)){
-            m_boardCharBuffer.clear();      //Board char buffer emptied by reset
+GrblPriorityMetrics GrblBoard::getPriorityMetrics(GrblPriorityMetrics::Class priorityClass) const{
+    return m_worker->getPriorityMetrics(priorityClass);
+}
 
-            //Request status and start status timer
-            rtCmdRequestStatus();
-            m_statusTimer->start();
+GrblDiagnostics GrblBoard::getDiagnostics(void) const{
+    GrblDiagnostics diagnostics = m_worker->getDiagnostics();
+    diagnostics.eventDelay = m_eventDelayHistogram;
+    return diagnostics;
+}
 
-            //Build startup instructions
-            for(int i = 0 ; i < m_startupInstructionList.size() ; i++){
-                m_startupInstructionList[i].regenerate();
-            }
+void GrblBoard::clearDiagnostics(void){
+    m_eventDelayHistogram.clear();
 
-            emit boardStartup(line,m_startupInstructionList);
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_clear_diagnostics;
+    postCommand(command);
+}
 
-            //Give the board some time to send us messages, then send startup instructions
-            QTimer::singleShot(100,this,&GrblBoard::sendStartupInstructions);
-        }
+int GrblBoard::getFeedGovernorReduction(void) const{
+    return m_worker->getFeedGovernorReduction();
+}
 
-        //Parameter value
-        else if(GrblConfiguration::isAValidParameter(line)){
-            GrblConfiguration param = GrblConfiguration::fromString(line);
+int GrblBoard::getEmulatorStarvedTime(void) const{
+    return m_worker->getEmulatorStarvedTime();
+}
 
-            m_parametersMapBeingFilled.insert(param.getKey(),param);
+int GrblBoard::getEmulatorRxOverflowCount(void) const{
+    return m_worker->getEmulatorRxOverflowCount();
+}
 
-            emit text(relatedInstruction,line);
-        }
+void GrblBoard::setStatusRequestInterval(const int &interval){
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_status_interval;
+    command.value = interval;
+    postCommand(command);
+}
 
-        //else it is just text
-        else if(!line.simplified().isEmpty()){
-            emit text(relatedInstruction,line);
-        }
-    }
+bool GrblBoard::startTelemetryRecording(const QString &path){
+    //Records are timed on the worker clock, the one events are stamped with
+    return m_telemetryRecorder.open(path,m_worker->getTime());
 }
 
+void GrblBoard::stopTelemetryRecording(void){
+    m_telemetryRecorder.close();
+}
 
-void GrblBoard::sendInstruction(const GrblInstruction &instruction){
-    //If serial link not opened, or a blocking instruction is in buffer, reject instruction
-    if(!m_serialPort->isOpen() || isBlockingInstructionInBuffer()){
-        return;
+bool GrblBoard::startTelemetryReplay(const QString &path, int speed){
+    if(m_status.isStateOnline() || !m_telemetryReader.open(path)){
+        return false;
     }
 
-    //if instruction would not fit in board rx buffer, reject it
-    if(instruction.getLength() > getAvailableSpaceInCharBuffer()){
+    m_replaySpeed = qBound(1,speed,REPLAY_MAX_SPEED);
+    m_hasReplayRecord = m_telemetryReader.readRecord(&m_replayStatus,&m_replayTime);
+    m_replayClock.start();
+    m_replayTimer->start();
+    return true;
+}
+
+void GrblBoard::stopTelemetryReplay(void){
+    if(!m_telemetryReader.isOpen()){
         return;
     }
 
-    //Send instruction and keep track of its place in rx buffer of the board
-    if(m_serialPort->write(instruction.getBytes()) > 0){
-        m_boardCharBuffer.append(instruction);
-        emit instructionSent(instruction);
-    }
+    m_replayTimer->stop();
+    m_telemetryReader.close();
+    m_hasReplayRecord = false;
 
-    return;
+    m_status = GrblStatus(false);
+    emit statusUpdated(&m_status);
+    emit telemetryReplayFinished();
 }
 
-void GrblBoard::sendStartupInstructions(void){
-    foreach(GrblInstruction instruction,m_startupInstructionList){
-        sendInstruction(instruction);
+void GrblBoard::onReplayTimeout(){
+    //Every record due is emitted, so that nothing is skipped even at high speed
+    qint64 replayTime = m_replayClock.elapsed() * m_replaySpeed;
+    while(m_hasReplayRecord && m_replayTime <= replayTime){
+        m_status = m_replayStatus;
+        emit statusUpdated(&m_status);
+        m_hasReplayRecord = m_telemetryReader.readRecord(&m_replayStatus,&m_replayTime);
     }
-}
 
-bool GrblBoard::isBlockingInstructionInBuffer(void){
-    foreach(GrblInstruction inst,  m_boardCharBuffer){
-        if(inst.isBlocking()){
-            return true;
-        }
+    if(!m_hasReplayRecord){
+        stopTelemetryReplay();
     }
-    return false;
 }
 
+void GrblBoard::onEventsAvailable(){
+    //Events posted from now on need a new wake up
+    m_worker->acknowledgeEvents();
 
-int GrblBoard::getAvailableSpaceInCharBuffer(void){
-    int freeSizeInBoardRxBuffer = BOARD_RX_BUFFER_SIZE;
-    foreach(GrblInstruction inst, m_boardCharBuffer){
-        freeSizeInBoardRxBuffer -= inst.getLength();
+    GrblBoardEvent event;
+    while(m_worker->takeEvent(&event)){
+        m_eventDelayHistogram.record(m_worker->getTime() - event.postedTime);
+
+        switch(event.type){
+        case GrblBoardEvent::event_status:
+            m_telemetryRecorder.record(event.status,event.postedTime);
+            m_status = event.status;
+            emit statusUpdated(&m_status);
+            break;
+        case GrblBoardEvent::event_startup:
+            emit boardStartup(event.message,event.instructions);
+            emit versionDetected(event.isVersion11OrLater);
+            break;
+        case GrblBoardEvent::event_ok:
+            emit ok(event.instruction);
+            break;
+        case GrblBoardEvent::event_error:
+            emit error(event.instruction,event.message);
+            break;
+        case GrblBoardEvent::event_alarm:
+            emit alarm(event.instruction,event.message);
+            break;
+        case GrblBoardEvent::event_feedback:
+            emit feedback(event.instruction,event.message);
+            break;
+        case GrblBoardEvent::event_text:
+            emit text(event.instruction,event.message);
+            break;
+        case GrblBoardEvent::event_parameters:
+            m_parametersMapComplete = event.parameters;
+            emit parametersMapUpdated(&m_parametersMapComplete);
+            break;
+        case GrblBoardEvent::event_sent:
+            emit instructionSent(event.instruction);
+            break;
+        case GrblBoardEvent::event_discarded:
+            emit instructionDiscarded(event.instruction);
+            break;
+        case GrblBoardEvent::event_rejected:
+            emit instructionRejected(event.instruction,event.message);
+            break;
+        case GrblBoardEvent::event_buffer_sizes:
+            m_rxBufferSize = event.rxBufferSize;
+            m_plannerBlockCount = event.plannerBlockCount;
+            emit bufferSizesChanged(m_rxBufferSize,m_plannerBlockCount);
+            break;
+        }
     }
-    return freeSizeInBoardRxBuffer;
 }
 
 
+void GrblBoard::sendInstruction(const GrblInstruction &instruction){
+    //Instruction may point to bytes owned by the caller
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_send;
+    command.instruction = instruction;
+    command.instruction.detach();
+
+    if(!postCommand(command)){
+        emit instructionRejected(instruction,tr("Too many instructions waiting for the board"));
+    }
+}
 
-void GrblBoard::addErrorTranslation(QString *errorString){
-    static const QRegularExpression errorIdRegExp = QRegularExpression(GRBL_ERR_REGEXP);
+void GrblBoard::queueInstruction(const GrblInstruction &instruction){
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_queue;
+    command.instruction = instruction;
+    command.instruction.detach();
 
-    QRegularExpressionMatch match = errorIdRegExp.match(errorString);
-    if(match.hasMatch()){
-        int id = match.captured("id").toInt();
-        if(errorTranslationMap.contains(id)){
-            errorString->append(" : ");
-            errorString->append(errorTranslationMap.value(id));
-        }
+    //Caller tracks every queued instruction until it is sent or discarded
+    if(!postCommand(command)){
+        emit instructionDiscarded(instruction);
     }
 }
 
-QMap<int, QString> GrblBoard::generateErrorTranslationMap(){
-    QMap<int,QString> errorTranslationMap;
-    errorTranslationMap.insert(23,GRBL_ERR_23);
-    errorTranslationMap.insert(24,GRBL_ERR_24);
-    errorTranslationMap.insert(25,GRBL_ERR_25);
-    errorTranslationMap.insert(26,GRBL_ERR_26);
-    errorTranslationMap.insert(27,GRBL_ERR_27);
-    errorTranslationMap.insert(28,GRBL_ERR_28);
-    errorTranslationMap.insert(29,GRBL_ERR_29);
-    errorTranslationMap.insert(30,GRBL_ERR_30);
-    errorTranslationMap.insert(31,GRBL_ERR_31);
-    errorTranslationMap.insert(32,GRBL_ERR_32);
-    errorTranslationMap.insert(33,GRBL_ERR_33);
-    errorTranslationMap.insert(34,GRBL_ERR_34);
-    errorTranslationMap.insert(35,GRBL_ERR_35);
-    errorTranslationMap.insert(36,GRBL_ERR_36);
-    errorTranslationMap.insert(37,GRBL_ERR_37);
-
-    return errorTranslationMap;
+void GrblBoard::flushInstructionQueue(){
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_flush;
+    postCommand(command);
 }
 
 
 void GrblBoard::rtCmdPauseCycle(){
-    m_serialPort->write(CMD_PAUSE_STRING);
-    QTimer::singleShot(RT_CMD_PROCESS_TIME_MS,this,&GrblBoard::rtCmdRequestStatus);
+    postRealtimeCommand(QByteArrayLiteral(CMD_PAUSE_STRING));
 }
 
 void GrblBoard::rtCmdResumeCycle(){
-    m_serialPort->write(CMD_RESUME_STRING);
-    QTimer::singleShot(RT_CMD_PROCESS_TIME_MS,this,&GrblBoard::rtCmdRequestStatus);
+    postRealtimeCommand(QByteArrayLiteral(CMD_RESUME_STRING));
 }
 
 void GrblBoard::rtCmdRequestStatus(){
-    m_serialPort->write(CMD_STATUS_REQ_STRING);
+    postRealtimeCommand(QByteArrayLiteral(CMD_STATUS_REQ_STRING));
 }
 
 void GrblBoard::rtCmdSoftReset(){
-    m_serialPort->write(CMD_SOFT_RESET_STRING);
+    postRealtimeCommand(QByteArrayLiteral(CMD_SOFT_RESET_STRING));
 }
 
 void GrblBoard::rtCmdSafetyDoor(){
-    m_serialPort->write(CMD_SAFETY_DOOR);
-    QTimer::singleShot(RT_CMD_PROCESS_TIME_MS,this,&GrblBoard::rtCmdRequestStatus);
+    postRealtimeCommand(QByteArrayLiteral(CMD_SAFETY_DOOR));
+}
+
+void GrblBoard::rtCmdFeedOverride(int change){
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_feed_override;
+    command.value = change;
+    postRealtimeCommand(command);
 }
 
+void GrblBoard::rtCmdSpindleOverride(int change){
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_spindle_override;
+    command.value = change;
+    postRealtimeCommand(command);
+}
 
+void GrblBoard::rtCmdRapidOverride(int percent){
+    if(percent <= 25){
+        postRealtimeCommand(QByteArrayLiteral(CMD_RAPID_OVR_LOW));
+    }
+    else if(percent <= 50){
+        postRealtimeCommand(QByteArrayLiteral(CMD_RAPID_OVR_MEDIUM));
+    }
+    else{
+        postRealtimeCommand(QByteArrayLiteral(CMD_RAPID_OVR_RESET));
+    }
+}
+
+void GrblBoard::setFeedGovernorEnabled(bool isEnabled){
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_feed_governor;
+    command.value = isEnabled ? 1 : 0;
+    postCommand(command);
+}
+
+void GrblBoard::jogStart(const QVector3D &direction, int feedRate){
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_jog_start;
+    command.vector = direction;
+    command.value = feedRate;
+    postCommand(command);
+}
+
+void GrblBoard::jogKeepAlive(){
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_jog_keep_alive;
+    postCommand(command);
+}
+
+void GrblBoard::jogStop(){
+    GrblBoardCommand command;
+    command.type = GrblBoardCommand::command_jog_stop;
+    postCommand(command);
+}
@@ -2,20 +2,30 @@
 #define GRBLBOARD_H
 
 #include <QObject>
-#include <QSerialPort>
+#include <QThread>
 #include <QVector3D>
 #include <QTimer>
+#include <QElapsedTimer>
 
 #include "grblstatus.h"
 #include "grblconfiguration.h"
 #include "grblinstruction.h"
+#include "grblprioritymetrics.h"
+#include "grbldiagnostics.h"
+#include "grbltelemetry.h"
 
+class GrblSerialWorker;
+struct GrblBoardCommand;
+
+//GUI thread side of the board : serial link and protocol run in a dedicated thread
+//Requests and results go through lock-free queues, so a busy GUI never starves the board
 class GrblBoard : public QObject
 {
     Q_OBJECT
 public:
 
     explicit GrblBoard(QObject *parent = nullptr);
+    ~GrblBoard();
 
     void setSerialSettings(const QString &portName, const qint32 &baudRate);
 
@@ -24,6 +34,41 @@ public:
     const GrblStatus *getLastStatus(void) const;
     QMap<int,GrblConfiguration> *getParametersMap(void);
 
+    //Back-pressure : instructions queued and not admitted in board char buffer yet, bytes not written to the link yet
+    int getQueuedInstructionCount(void) const;
+    int getPendingWriteSize(void) const;
+
+    //Status polling : current interval in milliseconds, report latency in microseconds
+    int getStatusRequestInterval(void) const;
+    int getLastStatusLatency(void) const;
+    int getAverageStatusLatency(void) const;
+
+    //How each class of instructions has been served since the application started
+    GrblPriorityMetrics getPriorityMetrics(GrblPriorityMetrics::Class priorityClass) const;
+
+    //Latency histograms and queue depths over time, since the application started or diagnostics were cleared
+    GrblDiagnostics getDiagnostics(void) const;
+
+    //Percents of feed override currently taken away by the feed governor
+    int getFeedGovernorReduction(void) const;
+
+    //Emulated board only : milliseconds the planner starved while streaming, bytes lost by rx buffer overflow
+    int getEmulatorStarvedTime(void) const;
+    int getEmulatorRxOverflowCount(void) const;
+
+    //Flow control sizes : learned from the board, or from previous sessions on the same port
+    int getRxBufferSize(void) const {return m_rxBufferSize;}
+    int getPlannerBlockCount(void) const {return m_plannerBlockCount;}
+
+    //Status reports are written to path until stopped : false if the file could not be created
+    bool startTelemetryRecording(const QString &path);
+    void stopTelemetryRecording(void);
+    bool isTelemetryRecording(void) const {return m_telemetryRecorder.isOpen();}
+
+    //Recorded statuses are emitted again by statusUpdated, speed times faster than recorded
+    //False while the serial link is open, or if the recording can not be read
+    bool startTelemetryReplay(const QString &path, int speed);
+    bool isTelemetryReplaying(void) const {return m_telemetryReader.isOpen();}
 
 
 signals:
@@ -34,6 +79,9 @@ signals:
     //Board sent hello message after a reset
     void boardStartup(const QString &versionString, const QList<GrblInstruction> &startupRelatedInstructions);
 
+    //Version read from the hello message : Grbl 1.1 and later have overrides and jog motions
+    void versionDetected(bool isVersion11OrLater);
+
     //Instruction has been processed, board sent response. After one of these we can iterate to the next command
     void ok(const GrblInstruction &instruction);
     void error(const GrblInstruction &instruction,const QString &errorMessage);        //Remember to freeze on this  if processsing a file
@@ -49,6 +97,22 @@ signals:
     //Emitted when instruction is placed in char buffer
     void instructionSent(const GrblInstruction &instruction);
 
+    //Queued instruction was dropped without being sent : queue flushed, serial link closed or board reset
+    //When the board queue is full, emitted from queueInstruction itself, before it returns
+    void instructionDiscarded(const GrblInstruction &instruction);
+
+    //Operator instruction was refused without being sent : too many waiting, serial link closed or board reset
+    void instructionRejected(const GrblInstruction &instruction, const QString &reason);
+
+    //Real time command or override could not be handed to the serial thread
+    void realtimeCommandRejected(const QString &reason);
+
+    //Board rx buffer and planner sizes used for flow control changed
+    void bufferSizesChanged(int rxBufferSize, int plannerBlockCount);
+
+    //Replay reached the end of the recording or was stopped, board is shown offline again
+    void telemetryReplayFinished(void);
+
 public slots:
 
     //Open / close serial link
@@ -61,37 +125,61 @@ public slots:
     void rtCmdSoftReset(void);
     void rtCmdSafetyDoor(void);
 
-    //Send an instruction
-    void sendInstruction(const GrblInstruction &instruction);
+    //Grbl 1.1 overrides : change in percents, 0 restores programmed value. Rapid override is 100, 50 or 25 percents
+    void rtCmdFeedOverride(int change);
+    void rtCmdSpindleOverride(int change);
+    void rtCmdRapidOverride(int percent);
 
-private slots:
+    //Start diagnostics over
+    void clearDiagnostics(void);
 
+    void stopTelemetryReplay(void);
 
-    void onSerialDataAvailable(void);
+    //Lower feed override slightly when the planner is about to starve during a stream, restore it afterwards
+    void setFeedGovernorEnabled(bool isEnabled);
 
-    void sendStartupInstructions(void);
+    //Grbl 1.1 continuous jog : moves along direction until stopped, feed rate in mm/min
+    //Board cancels the jog unless kept alive more often than every half second
+    void jogStart(const QVector3D &direction, int feedRate);
+    void jogKeepAlive(void);
+    void jogStop(void);
 
+    //Operator instruction : sent before queued ones as soon as it fits in board char buffer, or rejected
+    void sendInstruction(const GrblInstruction &instruction);
 
-private:
-    int getAvailableSpaceInCharBuffer();
-    bool isBlockingInstructionInBuffer(void);
+    //Queue an instruction, sent in order as soon as it fits in board char buffer
+    void queueInstruction(const GrblInstruction &instruction);
+    //Discard instructions queued and not sent yet
+    void flushInstructionQueue(void);
 
-    void addErrorTranslation(QString* errorString);
+private slots:
+    void onEventsAvailable(void);
+    void onReplayTimeout(void);
 
+private:
+    bool postCommand(const GrblBoardCommand &command);
+    void postRealtimeCommand(const QByteArray &command);
+    void postRealtimeCommand(const GrblBoardCommand &command);
 
-    QList<GrblInstruction> m_boardCharBuffer;
-    QByteArray m_bufferFromBoard;
-    QSerialPort *m_serialPort;
-    QTimer* m_statusTimer;
-    GrblStatus m_status;
+    QThread m_serialThread;
+    GrblSerialWorker* m_worker;
 
+    //Copies of the serial thread data, for the GUI thread
+    GrblStatus m_status;
     QMap<int,GrblConfiguration> m_parametersMapComplete;
-    QMap<int,GrblConfiguration> m_parametersMapBeingFilled;
-
-    QList<GrblInstruction> m_startupInstructionList;
-
-    static const QMap<int,QString> errorTranslationMap;
-    static QMap<int,QString> generateErrorTranslationMap();
+    int m_rxBufferSize;
+    int m_plannerBlockCount;
+
+    GrblLatencyHistogram m_eventDelayHistogram;     //Measured here, as events are taken by the GUI thread
+
+    GrblTelemetryRecorder m_telemetryRecorder;
+    GrblTelemetryReader m_telemetryReader;
+    QTimer* m_replayTimer;
+    QElapsedTimer m_replayClock;
+    int m_replaySpeed;
+    bool m_hasReplayRecord;         //Next record, read ahead and emitted once due
+    GrblStatus m_replayStatus;
+    qint64 m_replayTime;
 };
 
 #endif // GRBLBOARD_H
@@ -0,0 +1,50 @@
+#include "grblcharbuffer.h"
+
+#define ENTRY_MASK  (CHAR_BUFFER_MAX_INSTRUCTIONS - 1)
+
+GrblCharBuffer::GrblCharBuffer(int capacity):
+    m_head(0),
+    m_count(0),
+    m_capacity(capacity),
+    m_usedSize(0),
+    m_blockingCount(0)
+{
+
+}
+
+void GrblCharBuffer::clear(){
+    //Entries are overwritten when reused
+    m_head = 0;
+    m_count = 0;
+    m_usedSize = 0;
+    m_blockingCount = 0;
+}
+
+void GrblCharBuffer::append(const GrblInstruction &instruction, int priorityClass, qint64 sentTime){
+    Entry &entry = m_entries[(m_head + m_count) & ENTRY_MASK];
+    entry.instruction = instruction;
+    entry.length = instruction.getLength();
+    entry.isBlocking = instruction.isBlocking();
+    entry.priorityClass = priorityClass;
+    entry.sentTime = sentTime;
+
+    m_count++;
+    m_usedSize += entry.length;
+    if(entry.isBlocking){
+        m_blockingCount++;
+    }
+}
+
+GrblInstruction GrblCharBuffer::takeFirst(){
+    Entry &entry = m_entries[m_head];
+    GrblInstruction instruction = entry.instruction;
+
+    m_head = (m_head + 1) & ENTRY_MASK;
+    m_count--;
+    m_usedSize -= entry.length;
+    if(entry.isBlocking){
+        m_blockingCount--;
+    }
+
+    return instruction;
+}
@@ -0,0 +1,55 @@
+#ifndef GRBLCHARBUFFER_H
+#define GRBLCHARBUFFER_H
+
+#include "grblinstruction.h"
+
+#define CHAR_BUFFER_MAX_INSTRUCTIONS    2048    //Power of two, at least one byte per instruction in board rx buffer
+
+//Instructions sent to the board and not acknowledged yet, in the order the board will answer them
+//Byte count and blocking instructions are tracked as instructions come and go, so that admission is O(1)
+class GrblCharBuffer
+{
+public:
+    explicit GrblCharBuffer(int capacity);
+
+    void clear();
+
+    //Size of the board rx buffer, in bytes
+    int getCapacity() const {return m_capacity;}
+    void setCapacity(int capacity) {m_capacity = capacity;}
+
+    bool isEmpty() const {return m_count == 0;}
+    int getInstructionCount() const {return m_count;}
+    int getUsedSize() const {return m_usedSize;}
+    int getAvailableSize() const {return m_capacity - m_usedSize;}
+    bool containsBlockingInstruction() const {return m_blockingCount != 0;}
+
+    //Room and blocking instructions must have been checked by the caller
+    bool canAppend(int length) const {return length <= getAvailableSize() && m_count < CHAR_BUFFER_MAX_INSTRUCTIONS;}
+    void append(const GrblInstruction &instruction, int priorityClass = 0, qint64 sentTime = 0);
+
+    const GrblInstruction &first() const {return m_entries[m_head].instruction;}
+    int getFirstPriorityClass() const {return m_entries[m_head].priorityClass;}
+    qint64 getFirstSentTime() const {return m_entries[m_head].sentTime;}
+    GrblInstruction takeFirst();
+
+private:
+    //Length and blocking property are computed once, when the instruction is sent
+    struct Entry{
+        GrblInstruction instruction;
+        int length;
+        bool isBlocking;
+        int priorityClass;
+        qint64 sentTime;
+    };
+
+    Entry m_entries[CHAR_BUFFER_MAX_INSTRUCTIONS];
+    int m_head;
+    int m_count;
+
+    int m_capacity;
+    int m_usedSize;
+    int m_blockingCount;
+};
+
+#endif // GRBLCHARBUFFER_H
@@ -5,9 +5,9 @@
 
 #define ARC_ERROR   0.1
 
+//Usable sizes of genuine Grbl on ATmega328p, until the board tells its own
 #define BOARD_RX_BUFFER_SIZE    127
-
-#define RT_CMD_PROCESS_TIME_MS  200
+#define BOARD_PLANNER_BLOCKS    15
 
 #define LINE_SEPARATOR_STRING   "\r\n"
 #define LINE_SEPARATOR_LENGTH   2
@@ -27,6 +27,26 @@
 #define CMD_SOFT_RESET_STRING   "\x18"
 #define CMD_SAFETY_DOOR         "@"
 
+//Grbl 1.1 override commands, percentages of programmed values
+#define CMD_FEED_OVR_RESET          "\x90"
+#define CMD_FEED_OVR_COARSE_PLUS    "\x91"     //10%
+#define CMD_FEED_OVR_COARSE_MINUS   "\x92"
+#define CMD_FEED_OVR_FINE_PLUS      "\x93"     //1%
+#define CMD_FEED_OVR_FINE_MINUS     "\x94"
+#define CMD_RAPID_OVR_RESET         "\x95"     //100%
+#define CMD_RAPID_OVR_MEDIUM        "\x96"     //50%
+#define CMD_RAPID_OVR_LOW           "\x97"     //25%
+#define CMD_SPINDLE_OVR_RESET       "\x99"
+#define CMD_SPINDLE_OVR_COARSE_PLUS "\x9A"
+#define CMD_SPINDLE_OVR_COARSE_MINUS "\x9B"
+#define CMD_SPINDLE_OVR_FINE_PLUS   "\x9C"
+#define CMD_SPINDLE_OVR_FINE_MINUS  "\x9D"
+#define CMD_SAFETY_DOOR_1_1         "\x84"     //Grbl 1.1 moved safety door out of printable characters
+#define CMD_JOG_CANCEL              "\x85"
+#define OVR_COARSE_STEP             10
+#define OVR_MIN_PERCENT             10
+#define OVR_MAX_PERCENT             200
+
 #define STATE_IDLE_STRING       "Idle"
 #define STATE_RUN_STRING        "Run"
 #define STATE_HOLD_STRING       "Hold"
@@ -34,11 +54,21 @@
 #define STATE_HOME_STRING       "Home"
 #define STATE_ALARM_STRING      "Alarm"
 #define STATE_CHECK_STRING      "Check"
+#define STATE_JOG_STRING        "Jog"
+#define STATE_SLEEP_STRING      "Sleep"
 
 #define STATUS_MACHINE_POS      "MPos:"
 #define STATUS_WORK_POS         "WPos:"
 #define STATUS_MOTION_NUM       "Buf:"
 #define STATUS_CHARACTER_NUM    "RX:"
+#define STATUS_BUFFER_STATE     "Bf:"
+#define STATUS_WORK_OFFSET      "WCO:"
+#define STATUS_FEED_SPEED       "FS:"
+#define STATUS_FEED             "F:"
+#define STATUS_LINE_NUMBER      "Ln:"
+#define STATUS_OVERRIDES        "Ov:"
+
+#define FEEDBACK_OPTIONS        "[OPT:"
 
 #define VERSION_STRING          "Grbl "
 
@@ -46,6 +76,8 @@
 #define INST_TOGGLE_CHECK       "$C"
 #define INST_KILL_ALARM         "$X"
 #define INST_HOMING             "$H"
+#define INST_GET_BUILD_INFO     "$I"
+#define INST_JOG_PREFIX         "$J="       //Grbl 1.1 jog motion, not EEPROM related and cancellable
 
 //Those are command requiring simple question / answer protocol rather than buffered protocol
 //For simplification, any $ command is considered EEPROM related
@@ -53,6 +85,9 @@
 
 #define END_OF_INSTRUCTION      '\n'
 
+#define MAX_LINE_LENGTH         256     //Defined by gcode standard
+#define MAX_BLOCK_WORDS         32      //Words kept from a single gcode line by the parser
+
 #define GCODE_COMMENTS_DELIM    "(",";","%"
 
 
@@ -73,7 +108,12 @@
 #define GRBL_ERR_36             "Unused G-code words detected"
 #define GRBL_ERR_37             "G43.1 can only apply on its configured axis"
 
+#define GRBL_PARAM_STATUS_MASK      10
 #define GRBL_PARAM_REPORT_INCHES    13
 
+//Status report fields the application consumes, work position is derived from machine position and WCO in 1.1
+#define STATUS_MASK_GRBL_0_9        7       //MPos, WPos, Buf
+#define STATUS_MASK_GRBL_1_1        3       //MPos, Bf
+
 
 #endif // GRBLDEFINITIONS_H
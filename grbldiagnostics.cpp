@@ -0,0 +1,104 @@
+#include "grbldiagnostics.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+static const double s_exportPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+static const char *s_realtimeCommandNames[GrblDiagnostics::realtime_command_count] = {"feed_hold", "resume", "safety_door", "soft_reset"};
+
+static QJsonObject histogramToJson(const GrblLatencyHistogram &histogram){
+    QJsonObject object;
+    object.insert("count", double(histogram.getCount()));
+    object.insert("min", double(histogram.getMin()));
+    object.insert("mean", double(histogram.getMean()));
+    object.insert("max", double(histogram.getMax()));
+
+    QJsonObject percentiles;
+    for(double percentile : s_exportPercentiles){
+        percentiles.insert(QString::number(percentile), double(histogram.getValueAtPercentile(percentile)));
+    }
+    object.insert("percentiles", percentiles);
+
+    //Empty buckets are left out, the file stays small
+    QJsonArray buckets;
+    for(int bucket = 0 ; bucket < HISTOGRAM_BUCKETS ; bucket++){
+        if(histogram.getBucketHits(bucket) != 0){
+            QJsonArray entry;
+            entry.append(double(GrblLatencyHistogram::getBucketLowValue(bucket)));
+            entry.append(double(GrblLatencyHistogram::getBucketHighValue(bucket)));
+            entry.append(double(histogram.getBucketHits(bucket)));
+            buckets.append(entry);
+        }
+    }
+    object.insert("buckets", buckets);
+    return object;
+}
+
+static void histogramToCsv(QTextStream &stream, const char *name, const GrblLatencyHistogram &histogram){
+    for(int bucket = 0 ; bucket < HISTOGRAM_BUCKETS ; bucket++){
+        if(histogram.getBucketHits(bucket) != 0){
+            stream << name << ',' << GrblLatencyHistogram::getBucketLowValue(bucket) << ','
+                   << GrblLatencyHistogram::getBucketHighValue(bucket) << ',' << histogram.getBucketHits(bucket) << '\n';
+        }
+    }
+}
+
+QString GrblDiagnostics::toCsv() const{
+    //Tables one after the other, latencies in microseconds
+    QString csv;
+    QTextStream stream(&csv);
+
+    stream << "histogram,low_us,high_us,count\n";
+    histogramToCsv(stream, "queue_wait", queueWait);
+    histogramToCsv(stream, "response_time", responseTime);
+    histogramToCsv(stream, "event_delay", eventDelay);
+    for(int command = 0 ; command < realtime_command_count ; command++){
+        histogramToCsv(stream, s_realtimeCommandNames[command], realtimeLatency[command]);
+    }
+
+    stream << "\nrealtime_command,timeout_count\n";
+    for(int command = 0 ; command < realtime_command_count ; command++){
+        stream << s_realtimeCommandNames[command] << ',' << realtimeTimeoutCount[command] << '\n';
+    }
+
+    stream << "\ntime_us,operator_queued,stream_queued,char_buffer_instructions,char_buffer_bytes,planner_blocks\n";
+    foreach(const GrblQueueDepthSample &sample, depthHistory){
+        stream << sample.time << ',' << sample.operatorQueued << ',' << sample.streamQueued << ','
+               << sample.charBufferInstructions << ',' << sample.charBufferBytes << ',' << sample.plannerBlocks << '\n';
+    }
+
+    stream.flush();
+    return csv;
+}
+
+QByteArray GrblDiagnostics::toJson() const{
+    QJsonObject root;
+    root.insert("queue_wait_us", histogramToJson(queueWait));
+    root.insert("response_time_us", histogramToJson(responseTime));
+    root.insert("event_delay_us", histogramToJson(eventDelay));
+
+    QJsonObject realtime;
+    for(int command = 0 ; command < realtime_command_count ; command++){
+        QJsonObject entry = histogramToJson(realtimeLatency[command]);
+        entry.insert("timeout_count", realtimeTimeoutCount[command]);
+        realtime.insert(s_realtimeCommandNames[command], entry);
+    }
+    root.insert("realtime_latency_us", realtime);
+
+    QJsonArray depths;
+    foreach(const GrblQueueDepthSample &sample, depthHistory){
+        QJsonObject entry;
+        entry.insert("time_us", double(sample.time));
+        entry.insert("operator_queued", sample.operatorQueued);
+        entry.insert("stream_queued", sample.streamQueued);
+        entry.insert("char_buffer_instructions", sample.charBufferInstructions);
+        entry.insert("char_buffer_bytes", sample.charBufferBytes);
+        entry.insert("planner_blocks", sample.plannerBlocks);
+        depths.append(entry);
+    }
+    root.insert("queue_depths", depths);
+
+    return QJsonDocument(root).toJson();
+}
@@ -0,0 +1,37 @@
+#ifndef GRBLDIAGNOSTICS_H
+#define GRBLDIAGNOSTICS_H
+
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+
+#include "grbllatencyhistogram.h"
+
+//Where instructions were waiting at a given time, taken along with status reports
+struct GrblQueueDepthSample{
+    qint64 time;                    //Microseconds, on the serial worker clock
+    int operatorQueued;             //Waiting for room in board char buffer
+    int streamQueued;
+    int charBufferInstructions;     //Sent, not acknowledged yet
+    int charBufferBytes;
+    int plannerBlocks;              //Planned motions, -1 if the board does not tell
+};
+
+//Snapshot telling whether the link, the board planner or the GUI thread holds instructions back :
+//long queue waits mean a full link, long send to ok times a full planner, long event delays a busy GUI
+struct GrblDiagnostics{
+    //Real time commands timed from request to the board showing their effect
+    enum RealtimeCommands{realtime_feed_hold, realtime_resume, realtime_safety_door, realtime_soft_reset, realtime_command_count};
+
+    GrblLatencyHistogram queueWait;         //From request to admission in board char buffer
+    GrblLatencyHistogram responseTime;      //From admission to board answer
+    GrblLatencyHistogram eventDelay;        //From serial thread event to GUI thread handling
+    GrblLatencyHistogram realtimeLatency[realtime_command_count];   //From request to matching state report, or startup line
+    int realtimeTimeoutCount[realtime_command_count] = {};          //Effect never seen
+    QVector<GrblQueueDepthSample> depthHistory;
+
+    QString toCsv() const;
+    QByteArray toJson() const;
+};
+
+#endif // GRBLDIAGNOSTICS_H
@@ -0,0 +1,863 @@
+#include "grblemulator.h"
+#include "grbldefinitions.h"
+
+#include <QtMath>
+
+#include <cstring>
+
+#define STEP_INTERVAL_MS            1       //Real time between two simulation steps
+#define MAX_STEP_REAL_TIME_US       100000  //Thread was busy : do not catch up more than this at once
+#define MOTION_STEP_S               0.001   //Virtual time integrated at once
+#define BITS_PER_BYTE               10      //Start and stop bits included
+#define REPORT_SLOW_FIELDS_PERIOD   10      //Reports between two WCO: and Ov: fields
+#define JUNCTION_COS_LIMIT          0.999999
+#define MIN_JUNCTION_SPEED          0.0
+
+#define SETTING_STATUS_MASK         10
+#define SETTING_JUNCTION_DEVIATION  11
+#define SETTING_REPORT_INCHES       13
+#define SETTING_SOFT_LIMITS         20
+#define SETTING_HOMING              22
+#define SETTING_MAX_RATE            110     //X, then Y and Z
+#define SETTING_ACCELERATION        120
+#define SETTING_MAX_TRAVEL          130
+
+#define ERROR_EXPECTED_COMMAND      1
+#define ERROR_BAD_NUMBER            2
+#define ERROR_INVALID_STATEMENT     3
+#define ERROR_SETTING_DISABLED      5
+#define ERROR_NOT_IDLE              8
+#define ERROR_ALARM_LOCK            9
+#define ERROR_TRAVEL_EXCEEDED       15
+#define ERROR_INVALID_JOG           16
+#define ERROR_UNSUPPORTED_COMMAND   20
+#define ERROR_UNDEFINED_FEED_RATE   22
+
+#define ALARM_SOFT_LIMIT            2
+
+#define STARTUP_LINE                "Grbl 1.1f ['$' for help]"
+
+
+GrblEmulator::GrblEmulator(QObject *parent) :
+    QIODevice(parent),
+    m_baudRate(115200),
+    m_timeScale(1.0),
+    m_rxBufferSize(EMULATOR_RX_BUFFER_SIZE),
+    m_plannerBlockCount(EMULATOR_PLANNER_BLOCKS),
+    m_settings(generateDefaultSettings()),
+    m_lastStepTime(0),
+    m_virtualTime(0.0),
+    m_linkInTime(0.0),
+    m_linkOutTime(0.0),
+    m_rxOverflowCount(0),
+    m_receivedSize(0),
+    m_isRelative(false),
+    m_isInches(false),
+    m_isRapid(true),
+    m_feedRate(0.0),
+    m_spindleSpeed(0.0),
+    m_speed(0.0),
+    m_currentDistance(0.0),
+    m_isHoldRequested(false),
+    m_isJogCancelRequested(false),
+    m_starvedTime(0.0),
+    m_state(state_idle),
+    m_feedOverride(100),
+    m_rapidOverride(100),
+    m_spindleOverride(100),
+    m_reportCount(0)
+{
+    m_stepTimer = new QTimer(this);
+    m_stepTimer->setTimerType(Qt::PreciseTimer);
+    m_stepTimer->setInterval(STEP_INTERVAL_MS);
+    connect(m_stepTimer,&QTimer::timeout,this,&GrblEmulator::step);
+}
+
+bool GrblEmulator::open(OpenMode mode){
+    //Bytes go straight to the link : nothing buffered by QIODevice
+    if(!QIODevice::open(mode | QIODevice::Unbuffered)){
+        return false;
+    }
+
+    //Board just powered on
+    m_linkIn.clear();
+    m_linkOut.clear();
+    m_readBuffer.clear();
+    m_rxOverflowCount = 0;
+    m_receivedSize = 0;
+    m_starvedTime = 0.0;
+    m_machinePosition = QVector3D();
+    m_workOffset = QVector3D();
+    m_speed = 0.0;
+    m_state = state_idle;
+    softReset();
+    m_linkOut.clear();      //Nobody listens before the host resets the board
+
+    m_virtualTime = 0.0;
+    m_realClock.start();
+    m_lastStepTime = 0;
+    m_stepTimer->start();
+    return true;
+}
+
+void GrblEmulator::close(){
+    m_stepTimer->stop();
+    m_linkIn.clear();
+    m_linkOut.clear();
+    m_readBuffer.clear();
+    QIODevice::close();
+}
+
+qint64 GrblEmulator::bytesAvailable() const{
+    return m_readBuffer.size() + QIODevice::bytesAvailable();
+}
+
+qint64 GrblEmulator::readData(char *data, qint64 maxSize){
+    int readSize = int(qMin(maxSize, qint64(m_readBuffer.size())));
+    memcpy(data, m_readBuffer.constData(), size_t(readSize));
+    m_readBuffer.remove(0, readSize);
+    return readSize;
+}
+
+qint64 GrblEmulator::writeData(const char *data, qint64 maxSize){
+    //Idle link : first byte starts crossing it now
+    if(m_linkIn.isEmpty()){
+        m_linkInTime = m_virtualTime;
+    }
+    m_linkIn.append(data, int(maxSize));
+    return maxSize;
+}
+
+void GrblEmulator::step(){
+    qint64 now = m_realClock.nsecsElapsed() / 1000;
+    qint64 realElapsed = qMin(now - m_lastStepTime, qint64(MAX_STEP_REAL_TIME_US));
+    m_lastStepTime = now;
+
+    double byteTime = double(BITS_PER_BYTE) / m_baudRate;
+    double stepEnd = m_virtualTime + realElapsed * m_timeScale / 1000000.0;
+    int readBufferSize = m_readBuffer.size();
+
+    //Link, parser and motion advance together, in short slices of virtual time
+    while(m_virtualTime < stepEnd){
+        double duration = qMin(MOTION_STEP_S, stepEnd - m_virtualTime);
+        m_virtualTime += duration;
+
+        if(!m_linkIn.isEmpty()){
+            transferLinkIn(qMin(m_linkIn.size(), int((m_virtualTime - m_linkInTime) / byteTime)));
+        }
+        processRxBuffer();
+        executeMotion(duration);
+        if(!m_linkOut.isEmpty()){
+            transferLinkOut(qMin(m_linkOut.size(), int((m_virtualTime - m_linkOutTime) / byteTime)));
+        }
+    }
+
+    if(m_receivedSize > 0){
+        qint64 receivedSize = m_receivedSize;
+        m_receivedSize = 0;
+        emit bytesWritten(receivedSize);
+    }
+    if(m_readBuffer.size() != readBufferSize){
+        emit readyRead();
+    }
+}
+
+void GrblEmulator::transferLinkIn(int byteCount){
+    if(byteCount <= 0){
+        return;
+    }
+    m_linkInTime += byteCount * double(BITS_PER_BYTE) / m_baudRate;
+
+    for(int i = 0 ; i < byteCount ; i++){
+        char byte = m_linkIn.at(i);
+
+        //Realtime commands are picked from the link, they never reach the rx buffer
+        if(byte == '?' || byte == '!' || byte == '~' || byte == '\x18' || (byte & 0x80) != 0){
+            processRealtimeByte(byte);
+        }
+        else if(m_rxBuffer.size() < m_rxBufferSize){
+            m_rxBuffer.append(byte);
+        }
+        else{
+            m_rxOverflowCount++;
+        }
+    }
+
+    m_linkIn.remove(0, byteCount);
+    m_receivedSize += byteCount;
+}
+
+void GrblEmulator::transferLinkOut(int byteCount){
+    if(byteCount <= 0){
+        return;
+    }
+    m_linkOutTime += byteCount * double(BITS_PER_BYTE) / m_baudRate;
+    m_readBuffer.append(m_linkOut.constData(), byteCount);
+    m_linkOut.remove(0, byteCount);
+}
+
+void GrblEmulator::processRealtimeByte(char byte){
+    switch(quint8(byte)){
+    case '?':
+        sendStatusReport();
+        break;
+    case '!':
+    case 0x84:      //Safety door
+        //Nothing to hold while idle
+        if(!m_planner.isEmpty()){
+            m_isHoldRequested = true;
+        }
+        break;
+    case '~':
+        m_isHoldRequested = false;
+        break;
+    case 0x18:
+        softReset();
+        break;
+    case 0x85:
+        if(!m_planner.isEmpty() && m_planner.head().isJog){
+            m_isJogCancelRequested = true;
+        }
+        break;
+    case 0x90: m_feedOverride = 100; break;
+    case 0x91: m_feedOverride += OVR_COARSE_STEP; break;
+    case 0x92: m_feedOverride -= OVR_COARSE_STEP; break;
+    case 0x93: m_feedOverride++; break;
+    case 0x94: m_feedOverride--; break;
+    case 0x95: m_rapidOverride = 100; break;
+    case 0x96: m_rapidOverride = 50; break;
+    case 0x97: m_rapidOverride = 25; break;
+    case 0x99: m_spindleOverride = 100; break;
+    case 0x9A: m_spindleOverride += OVR_COARSE_STEP; break;
+    case 0x9B: m_spindleOverride -= OVR_COARSE_STEP; break;
+    case 0x9C: m_spindleOverride++; break;
+    case 0x9D: m_spindleOverride--; break;
+    default:
+        return;     //Unknown extended byte, dropped as the board does
+    }
+
+    //Overrides are reported on the next status
+    m_feedOverride = qBound(OVR_MIN_PERCENT, m_feedOverride, OVR_MAX_PERCENT);
+    m_spindleOverride = qBound(OVR_MIN_PERCENT, m_spindleOverride, OVR_MAX_PERCENT);
+    if(quint8(byte) >= 0x90){
+        m_reportCount = 0;
+    }
+}
+
+void GrblEmulator::processRxBuffer(){
+    forever{
+        int endIndex = m_rxBuffer.indexOf(END_OF_INSTRUCTION);
+        int returnIndex = m_rxBuffer.indexOf('\r');
+        if(returnIndex >= 0 && (endIndex < 0 || returnIndex < endIndex)){
+            endIndex = returnIndex;
+        }
+        if(endIndex < 0){
+            return;
+        }
+
+        //Line waits in rx buffer until the planner takes it
+        if(!processLine(m_rxBuffer.left(endIndex))){
+            return;
+        }
+        m_rxBuffer.remove(0, endIndex + 1);
+    }
+}
+
+bool GrblEmulator::processLine(const QByteArray &line){
+    //Board drops spaces and comments, and reads letters in upper case
+    QByteArray block;
+    bool isInComment = false;
+    for(int i = 0 ; i < line.size() ; i++){
+        char c = line.at(i);
+        if(isInComment){
+            isInComment = (c != ')');
+        }
+        else if(c == '('){
+            isInComment = true;
+        }
+        else if(c == ';'){
+            break;
+        }
+        else if(c != ' ' && c != '\t'){
+            block.append((c >= 'a' && c <= 'z') ? char(c - 'a' + 'A') : c);
+        }
+    }
+
+    //Separator of a "\r\n" pair, or nothing left
+    if(block.isEmpty()){
+        if(!line.isEmpty()){
+            sendLine(RESPONSE_OK);
+        }
+        return true;
+    }
+
+    if(block.startsWith('$')){
+        return processSystemCommand(block);
+    }
+
+    if(m_state == state_alarm){
+        sendError(ERROR_ALARM_LOCK);
+        return true;
+    }
+    if(m_planner.size() >= m_plannerBlockCount){
+        return false;
+    }
+    return processGcode(block, false);
+}
+
+bool GrblEmulator::processSystemCommand(const QByteArray &line){
+    //Jog motions queue like gcode
+    if(line.startsWith(INST_JOG_PREFIX)){
+        if(m_planner.size() >= m_plannerBlockCount){
+            return false;
+        }
+        if(m_state != state_idle || (!m_planner.isEmpty() && !m_planner.head().isJog) || m_isHoldRequested){
+            sendError(ERROR_NOT_IDLE);
+            return true;
+        }
+        return processGcode(line.mid(int(sizeof(INST_JOG_PREFIX)) - 1), true);
+    }
+
+    //Other commands never run while the machine moves
+    if(line == "$G"){
+        QByteArray modes("[GC:");
+        modes.append(m_isRapid ? "G0" : "G1");
+        modes.append(" G54 G17 ");
+        modes.append(m_isInches ? "G20" : "G21");
+        modes.append(m_isRelative ? " G91" : " G90");
+        modes.append(" G94 M5 M9 T0 F");
+        modes.append(QByteArray::number(m_feedRate, 'f', 0));
+        modes.append(" S");
+        modes.append(QByteArray::number(m_spindleSpeed, 'f', 0));
+        modes.append(']');
+        sendLine(modes);
+        sendLine(RESPONSE_OK);
+        return true;
+    }
+    if(!isIdle()){
+        sendError(ERROR_NOT_IDLE);
+        return true;
+    }
+
+    if(line == "$"){
+        sendLine("[HLP:$$ $# $G $I $N $x=val $Nx=line $J=line $SLP $C $X $H ~ ! ? ctrl-x]");
+    }
+    else if(line == INST_GET_PARAMS){
+        sendParameters();
+    }
+    else if(line == INST_GET_BUILD_INFO){
+        sendLine("[VER:1.1f.20170801:]");
+        sendLine(QByteArray(FEEDBACK_OPTIONS "V,") + QByteArray::number(m_plannerBlockCount) + ','
+                 + QByteArray::number(m_rxBufferSize) + ']');
+    }
+    else if(line == INST_KILL_ALARM){
+        if(m_state == state_alarm){
+            m_state = state_idle;
+            sendLine("[MSG:Caution: Unlocked]");
+        }
+    }
+    else if(line == INST_HOMING){
+        if(m_settings.value(SETTING_HOMING) == 0.0){
+            sendError(ERROR_SETTING_DISABLED);
+            return true;
+        }
+        //Switches are found at once : homing ends where the machine origin is
+        m_machinePosition = QVector3D();
+        m_plannedPosition = QVector3D();
+        m_state = state_idle;
+    }
+    else if(line == INST_TOGGLE_CHECK){
+        if(m_state == state_check){
+            sendLine("[MSG:Disabled]");
+            softReset();
+            return true;
+        }
+        if(m_state == state_alarm){
+            sendError(ERROR_ALARM_LOCK);
+            return true;
+        }
+        m_state = state_check;
+        sendLine("[MSG:Enabled]");
+    }
+    else{
+        //$<setting>=<value>
+        int equalIndex = line.indexOf('=');
+        bool isKeyValid = false, isValueValid = false;
+        int key = (equalIndex > 1) ? line.mid(1, equalIndex - 1).toInt(&isKeyValid) : -1;
+        double value = (equalIndex > 1) ? line.mid(equalIndex + 1).toDouble(&isValueValid) : 0.0;
+        if(!isKeyValid || !m_settings.contains(key)){
+            sendError(ERROR_INVALID_STATEMENT);
+            return true;
+        }
+        if(!isValueValid){
+            sendError(ERROR_BAD_NUMBER);
+            return true;
+        }
+        m_settings.insert(key, value);
+    }
+
+    sendLine(RESPONSE_OK);
+    return true;
+}
+
+bool GrblEmulator::processGcode(const QByteArray &line, bool isJog){
+    //Jog motions leave the modal state alone
+    bool isRelative = m_isRelative;
+    bool isInches = m_isInches;
+    bool isRapid = isJog ? false : m_isRapid;
+    double feedRate = isJog ? 0.0 : m_feedRate;
+    double spindleSpeed = m_spindleSpeed;
+    bool isNonModalUsingAxes = false;
+    bool isSettingOffset = false;
+    bool hasAxisWord[3] = {false, false, false};
+    double axisWord[3] = {0.0, 0.0, 0.0};
+
+    const char *data = line.constData();
+    int index = 0;
+    while(index < line.size()){
+        char letter = data[index++];
+        if(letter < 'A' || letter > 'Z'){
+            sendError(ERROR_EXPECTED_COMMAND);
+            return true;
+        }
+
+        int numberStart = index;
+        while(index < line.size() && ((data[index] >= '0' && data[index] <= '9') || data[index] == '.'
+                                      || data[index] == '-' || data[index] == '+')){
+            index++;
+        }
+        bool isNumberValid;
+        double value = line.mid(numberStart, index - numberStart).toDouble(&isNumberValid);
+        if(!isNumberValid){
+            sendError(ERROR_BAD_NUMBER);
+            return true;
+        }
+
+        switch(letter){
+        case 'G':{
+            int code = qRound(value * 10);
+            if(isJog && code != 10 && code != 200 && code != 210 && code != 530 && code != 900 && code != 910){
+                sendError(ERROR_INVALID_JOG);
+                return true;
+            }
+
+            if(code == 0 || code == 10 || code == 20 || code == 30){
+                //Arcs are run as their chord
+                isRapid = (code == 0);
+            }
+            else if(code == 200 || code == 210){
+                isInches = (code == 200);
+            }
+            else if(code == 900 || code == 910){
+                isRelative = (code == 910);
+            }
+            else if(code == 920){
+                isSettingOffset = true;
+            }
+            else if(code == 100 || code == 280 || code == 300){
+                //Coordinate systems and stored positions are not emulated, their axis words are not a motion
+                isNonModalUsingAxes = true;
+            }
+            else if(code != 40 && code != 170 && code != 180 && code != 190 && code != 400 && code != 490
+                    && code != 530 && (code < 540 || code > 590 || code % 10 != 0) && code != 800 && code != 901
+                    && code != 911 && code != 930 && code != 940){
+                sendError(ERROR_UNSUPPORTED_COMMAND);
+                return true;
+            }
+            break;
+        }
+        case 'X': case 'Y': case 'Z':
+            hasAxisWord[letter - 'X'] = true;
+            axisWord[letter - 'X'] = value;
+            break;
+        case 'F':
+            feedRate = value;
+            break;
+        case 'S':
+            spindleSpeed = value;
+            break;
+        case 'M': case 'T':
+            if(isJog){
+                sendError(ERROR_INVALID_JOG);
+                return true;
+            }
+            break;
+        case 'N': case 'P': case 'R': case 'I': case 'J': case 'K': case 'L':
+            break;
+        default:
+            sendError(ERROR_UNSUPPORTED_COMMAND);
+            return true;
+        }
+    }
+
+    //Feed rate is given in the unit of the block
+    double unitFactor = isInches ? MM_PER_INCH : 1.0;
+    bool hasAxisWords = hasAxisWord[0] || hasAxisWord[1] || hasAxisWord[2];
+    bool hasMotion = hasAxisWords && !isNonModalUsingAxes && !isSettingOffset;
+    if(isJog && !hasMotion){
+        sendError(ERROR_INVALID_JOG);
+        return true;
+    }
+    if(hasMotion && !isRapid && feedRate <= 0.0){
+        sendError(ERROR_UNDEFINED_FEED_RATE);
+        return true;
+    }
+
+    //Words are work coordinates, planner works in machine coordinates
+    QVector3D target = m_plannedPosition;
+    for(int axis = 0 ; axis < 3 && hasMotion ; axis++){
+        if(hasAxisWord[axis]){
+            float position = float(axisWord[axis] * unitFactor);
+            target[axis] = isRelative ? target[axis] + position : position + m_workOffset[axis];
+        }
+    }
+
+    if(hasMotion && m_state != state_check && isOutsideSoftLimits(target)){
+        if(isJog){
+            sendError(ERROR_TRAVEL_EXCEEDED);
+            return true;
+        }
+        raiseAlarm(ALARM_SOFT_LIMIT);
+        sendLine(RESPONSE_OK);
+        return true;
+    }
+
+    //G92 : current position becomes the given work position
+    if(isSettingOffset){
+        for(int axis = 0 ; axis < 3 ; axis++){
+            if(hasAxisWord[axis]){
+                m_workOffset[axis] = m_plannedPosition[axis] - float(axisWord[axis] * unitFactor);
+            }
+        }
+        m_reportCount = 0;
+    }
+
+    if(!isJog){
+        m_isRelative = isRelative;
+        m_isInches = isInches;
+        m_isRapid = isRapid;
+        m_feedRate = feedRate;
+        m_spindleSpeed = spindleSpeed;
+    }
+
+    //Check mode only parses
+    if(hasMotion && m_state != state_check){
+        planMotion(target, feedRate * unitFactor, isRapid, isJog);
+    }
+    m_plannedPosition = target;
+
+    sendLine(RESPONSE_OK);
+    return true;
+}
+
+void GrblEmulator::planMotion(const QVector3D &target, double feedRate, bool isRapid, bool isJog){
+    QVector3D delta = target - m_plannedPosition;
+    double length = double(delta.length());
+    if(length <= 0.0){
+        return;
+    }
+
+    PlannedBlock block;
+    block.target = target;
+    block.unitVector = delta / float(length);
+    block.length = length;
+    block.isRapid = isRapid;
+    block.isJog = isJog;
+    block.acceleration = getAcceleration(block.unitVector);
+    block.nominalSpeed = getRapidRate(block.unitVector);
+    if(!isRapid){
+        block.nominalSpeed = qMin(block.nominalSpeed, feedRate / 60.0);
+    }
+
+    //Motion that already ended left the machine stopped
+    block.maxJunctionSpeed = m_planner.isEmpty() ? MIN_JUNCTION_SPEED : getJunctionSpeed(m_planner.last(), block);
+
+    m_planner.enqueue(block);
+}
+
+void GrblEmulator::executeMotion(double duration){
+    if(m_planner.isEmpty()){
+        m_speed = 0.0;
+        m_isHoldRequested = false;
+        m_isJogCancelRequested = false;
+
+        //Nothing to run while the host still has lines on their way
+        if(!m_linkIn.isEmpty() || !m_rxBuffer.isEmpty()){
+            m_starvedTime += duration;
+        }
+        return;
+    }
+
+    const PlannedBlock &block = m_planner.head();
+    double acceleration = block.acceleration;
+    double remainingLength = block.length - m_currentDistance;
+
+    //Fastest speed allowing to slow down to what the next blocks accept, or to a stop
+    double exitSpeed = getExitSpeedLimit();
+    double allowedSpeed = block.nominalSpeed * getSpeedFactor(block);
+    allowedSpeed = qMin(allowedSpeed, qSqrt(exitSpeed * exitSpeed + 2.0 * acceleration * remainingLength));
+    if(m_isHoldRequested || m_isJogCancelRequested){
+        allowedSpeed = 0.0;
+    }
+
+    double previousSpeed = m_speed;
+    if(m_speed < allowedSpeed){
+        m_speed = qMin(allowedSpeed, m_speed + acceleration * duration);
+    }
+    else{
+        m_speed = qMax(allowedSpeed, m_speed - acceleration * duration);
+    }
+    m_currentDistance += (previousSpeed + m_speed) / 2.0 * duration;
+
+    if(m_currentDistance >= block.length){
+        m_machinePosition = block.target;
+        m_speed = qMin(m_speed, exitSpeed);
+        m_currentDistance = 0.0;
+        m_planner.dequeue();
+    }
+    else{
+        m_machinePosition = block.target - block.unitVector * float(block.length - m_currentDistance);
+    }
+
+    //Cancelled jog ends once stopped, with whatever jog motions are left
+    if(m_isJogCancelRequested && m_speed <= 0.0){
+        m_planner.clear();
+        m_currentDistance = 0.0;
+        m_plannedPosition = m_machinePosition;
+        m_isJogCancelRequested = false;
+    }
+}
+
+void GrblEmulator::softReset(){
+    //Position is lost if the machine was moving
+    if(m_speed > 0.0){
+        m_state = state_alarm;
+    }
+    else if(m_state == state_check){
+        m_state = state_idle;
+    }
+
+    m_rxBuffer.clear();
+    m_planner.clear();
+    m_speed = 0.0;
+    m_currentDistance = 0.0;
+    m_plannedPosition = m_machinePosition;
+    m_isHoldRequested = false;
+    m_isJogCancelRequested = false;
+
+    m_isRelative = false;
+    m_isInches = false;
+    m_isRapid = true;
+    m_feedRate = 0.0;
+    m_spindleSpeed = 0.0;
+    m_feedOverride = 100;
+    m_rapidOverride = 100;
+    m_spindleOverride = 100;
+    m_reportCount = 0;
+
+    sendLine(QByteArray());
+    sendLine(STARTUP_LINE);
+    if(m_state == state_alarm){
+        sendLine("[MSG:'$H'|'$X' to unlock]");
+    }
+}
+
+void GrblEmulator::raiseAlarm(int alarmId){
+    //Machine stops at once, and nothing runs until unlocked
+    m_planner.clear();
+    m_speed = 0.0;
+    m_currentDistance = 0.0;
+    m_plannedPosition = m_machinePosition;
+    m_state = state_alarm;
+    sendLine(QByteArray(RESPONSE_ALARM) + QByteArray::number(alarmId));
+}
+
+void GrblEmulator::sendLine(const QByteArray &line){
+    //Idle link : first byte starts crossing it now
+    if(m_linkOut.isEmpty()){
+        m_linkOutTime = m_virtualTime;
+    }
+    m_linkOut.append(line);
+    m_linkOut.append(LINE_SEPARATOR_STRING);
+}
+
+void GrblEmulator::sendError(int errorId){
+    sendLine(QByteArray(RESPONSE_ERROR) + QByteArray::number(errorId));
+}
+
+void GrblEmulator::sendStatusReport(){
+    int mask = int(m_settings.value(SETTING_STATUS_MASK));
+    double unitFactor = (m_settings.value(SETTING_REPORT_INCHES) != 0.0) ? 1.0 / MM_PER_INCH : 1.0;
+
+    QByteArray report(RESPONSE_STATUS_START);
+    report.append(getStateString());
+
+    QVector3D position = (mask & 1) ? m_machinePosition : m_machinePosition - m_workOffset;
+    report.append((mask & 1) ? "|" STATUS_MACHINE_POS : "|" STATUS_WORK_POS);
+    appendVector(&report, position * float(unitFactor));
+
+    if(mask & 2){
+        report.append("|" STATUS_BUFFER_STATE);
+        report.append(QByteArray::number(m_plannerBlockCount - m_planner.size()));
+        report.append(',');
+        report.append(QByteArray::number(m_rxBufferSize - m_rxBuffer.size()));
+    }
+
+    report.append("|" STATUS_FEED_SPEED);
+    report.append(QByteArray::number(m_speed * 60.0 * unitFactor, 'f', 0));
+    report.append(',');
+    report.append(QByteArray::number(m_spindleSpeed * m_spindleOverride / 100.0, 'f', 0));
+
+    //Slowly changing fields are only sent every few reports
+    if(m_reportCount % REPORT_SLOW_FIELDS_PERIOD == 0){
+        report.append("|" STATUS_WORK_OFFSET);
+        appendVector(&report, m_workOffset * float(unitFactor));
+        report.append("|" STATUS_OVERRIDES);
+        report.append(QByteArray::number(m_feedOverride));
+        report.append(',');
+        report.append(QByteArray::number(m_rapidOverride));
+        report.append(',');
+        report.append(QByteArray::number(m_spindleOverride));
+    }
+    m_reportCount++;
+
+    report.append(RESPONSE_STATUS_END);
+    sendLine(report);
+}
+
+void GrblEmulator::sendParameters(){
+    QMap<int,double>::const_iterator it;
+    for(it = m_settings.constBegin() ; it != m_settings.constEnd() ; ++it){
+        //Integer settings are printed as such
+        bool isInteger = it.key() < 100 && it.key() != SETTING_JUNCTION_DEVIATION && it.key() != 12
+                && it.key() != 24 && it.key() != 25 && it.key() != 27;
+        QByteArray line("$");
+        line.append(QByteArray::number(it.key()));
+        line.append('=');
+        line.append(QByteArray::number(it.value(), 'f', isInteger ? 0 : 3));
+        sendLine(line);
+    }
+}
+
+void GrblEmulator::appendVector(QByteArray *report, const QVector3D &vector){
+    report->append(QByteArray::number(double(vector.x()), 'f', 3));
+    report->append(',');
+    report->append(QByteArray::number(double(vector.y()), 'f', 3));
+    report->append(',');
+    report->append(QByteArray::number(double(vector.z()), 'f', 3));
+}
+
+QByteArray GrblEmulator::getStateString() const{
+    if(m_state == state_alarm){
+        return STATE_ALARM_STRING;
+    }
+    if(m_state == state_check){
+        return STATE_CHECK_STRING;
+    }
+    if(m_isHoldRequested){
+        return (m_speed > 0.0) ? STATE_HOLD_STRING ":1" : STATE_HOLD_STRING ":0";
+    }
+    if(!m_planner.isEmpty()){
+        return m_planner.head().isJog ? STATE_JOG_STRING : STATE_RUN_STRING;
+    }
+    return STATE_IDLE_STRING;
+}
+
+double GrblEmulator::getJunctionSpeed(const PlannedBlock &previous, const PlannedBlock &next) const{
+    //Junction deviation : speed at which the path corner stays within the deviation, using the acceleration
+    double cosTheta = -double(QVector3D::dotProduct(previous.unitVector, next.unitVector));
+    double junctionSpeed;
+    if(cosTheta > JUNCTION_COS_LIMIT){
+        junctionSpeed = MIN_JUNCTION_SPEED;       //Going back
+    }
+    else if(cosTheta < -JUNCTION_COS_LIMIT){
+        junctionSpeed = next.nominalSpeed;         //Straight on
+    }
+    else{
+        double sinHalfTheta = qSqrt(0.5 * (1.0 - cosTheta));
+        junctionSpeed = qSqrt(next.acceleration * m_settings.value(SETTING_JUNCTION_DEVIATION)
+                              * sinHalfTheta / (1.0 - sinHalfTheta));
+    }
+    return qMin(junctionSpeed, qMin(previous.nominalSpeed, next.nominalSpeed));
+}
+
+double GrblEmulator::getExitSpeedLimit() const{
+    //From the last planned block, which must end stopped, back to the one running
+    double entrySpeed = 0.0;
+    for(int i = m_planner.size() - 1 ; i > 0 ; i--){
+        const PlannedBlock &block = m_planner.at(i);
+        entrySpeed = qMin(block.maxJunctionSpeed, qSqrt(entrySpeed * entrySpeed + 2.0 * block.acceleration * block.length));
+        entrySpeed = qMin(entrySpeed, block.nominalSpeed * getSpeedFactor(block));
+    }
+    return entrySpeed;
+}
+
+double GrblEmulator::getSpeedFactor(const PlannedBlock &block) const{
+    //Jog motions ignore overrides
+    if(block.isJog){
+        return 1.0;
+    }
+    return (block.isRapid ? m_rapidOverride : m_feedOverride) / 100.0;
+}
+
+double GrblEmulator::getRapidRate(const QVector3D &unitVector) const{
+    //Slowest axis involved limits the motion, in mm/s
+    double rate = -1.0;
+    for(int axis = 0 ; axis < 3 ; axis++){
+        double component = qAbs(double(unitVector[axis]));
+        if(component > 0.0){
+            double axisRate = m_settings.value(SETTING_MAX_RATE + axis) / 60.0 / component;
+            rate = (rate < 0.0) ? axisRate : qMin(rate, axisRate);
+        }
+    }
+    return rate;
+}
+
+double GrblEmulator::getAcceleration(const QVector3D &unitVector) const{
+    double acceleration = -1.0;
+    for(int axis = 0 ; axis < 3 ; axis++){
+        double component = qAbs(double(unitVector[axis]));
+        if(component > 0.0){
+            double axisAcceleration = m_settings.value(SETTING_ACCELERATION + axis) / component;
+            acceleration = (acceleration < 0.0) ? axisAcceleration : qMin(acceleration, axisAcceleration);
+        }
+    }
+    return acceleration;
+}
+
+bool GrblEmulator::isOutsideSoftLimits(const QVector3D &target) const{
+    //Machine space is negative from the homing switches, as the board sees it
+    if(m_settings.value(SETTING_SOFT_LIMITS) == 0.0){
+        return false;
+    }
+    for(int axis = 0 ; axis < 3 ; axis++){
+        double position = double(target[axis]);
+        if(position > 0.0 || position < -m_settings.value(SETTING_MAX_TRAVEL + axis)){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GrblEmulator::isIdle() const{
+    return m_planner.isEmpty() && m_speed <= 0.0;
+}
+
+QMap<int,double> GrblEmulator::generateDefaultSettings(){
+    //Grbl 1.1 defaults, for a small machine
+    QMap<int,double> settings;
+    settings.insert(0,10); settings.insert(1,25); settings.insert(2,0); settings.insert(3,0);
+    settings.insert(4,0); settings.insert(5,0); settings.insert(6,0);
+    settings.insert(SETTING_STATUS_MASK,1); settings.insert(SETTING_JUNCTION_DEVIATION,0.010);
+    settings.insert(12,0.002); settings.insert(SETTING_REPORT_INCHES,0);
+    settings.insert(SETTING_SOFT_LIMITS,0); settings.insert(21,0); settings.insert(SETTING_HOMING,0); settings.insert(23,0);
+    settings.insert(24,25.0); settings.insert(25,500.0); settings.insert(26,250); settings.insert(27,1.0);
+    settings.insert(30,1000); settings.insert(31,0); settings.insert(32,0);
+    for(int axis = 0 ; axis < 3 ; axis++){
+        settings.insert(100 + axis,250.0);                          //Steps per mm
+        settings.insert(SETTING_MAX_RATE + axis,500.0);             //mm/min
+        settings.insert(SETTING_ACCELERATION + axis,10.0);          //mm/s²
+        settings.insert(SETTING_MAX_TRAVEL + axis,200.0);           //mm
+    }
+    return settings;
+}
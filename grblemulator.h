@@ -0,0 +1,143 @@
+#ifndef GRBLEMULATOR_H
+#define GRBLEMULATOR_H
+
+#include <QIODevice>
+#include <QTimer>
+#include <QQueue>
+#include <QMap>
+#include <QVector3D>
+#include <QElapsedTimer>
+
+#define EMULATOR_PORT_NAME          "Emulator"      //Port name opening the emulator instead of a serial port
+#define EMULATOR_SETTINGS_GROUP     "Emulator"
+#define EMULATOR_RX_BUFFER_SIZE     128             //Usable bytes, as Grbl 1.1 reports in [OPT:] and as Bf: while idle
+#define EMULATOR_PLANNER_BLOCKS     15
+
+//Grbl 1.1 board simulated in process, seen through the same QIODevice interface as a serial port
+//Bytes cross a link throttled to the baud rate, lines wait in a bounded rx buffer until the planner has room,
+//and planned motions run with acceleration and junction speeds, so that flow control and planner starvation
+//behave as with a real board. Time is virtual : it runs faster than real time when time scale is above 1
+class GrblEmulator : public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit GrblEmulator(QObject *parent = nullptr);
+
+    void setBaudRate(qint32 baudRate) {m_baudRate = baudRate;}
+    //1 is real time, 10 runs links and motions ten times faster
+    void setTimeScale(double timeScale) {m_timeScale = timeScale;}
+    void setRxBufferSize(int rxBufferSize) {m_rxBufferSize = rxBufferSize;}
+    void setPlannerBlockCount(int plannerBlockCount) {m_plannerBlockCount = plannerBlockCount;}
+
+    bool open(OpenMode mode) Q_DECL_OVERRIDE;
+    void close() Q_DECL_OVERRIDE;
+    bool isSequential() const Q_DECL_OVERRIDE {return true;}
+    qint64 bytesAvailable() const Q_DECL_OVERRIDE;
+    qint64 bytesToWrite() const Q_DECL_OVERRIDE {return m_linkIn.size();}
+
+    //Bytes dropped because they did not fit in rx buffer : the host broke flow control
+    int getRxOverflowCount() const {return m_rxOverflowCount;}
+    //Virtual time the planner spent empty while lines were being streamed, in seconds
+    double getStarvedTime() const {return m_starvedTime;}
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+    qint64 writeData(const char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+
+private slots:
+    void step();
+
+private:
+    //Running, held and jogging are told by the planner
+    enum States{state_idle, state_alarm, state_check};
+
+    //Straight motion waiting in the planner, speeds in mm/s
+    struct PlannedBlock{
+        QVector3D target;           //Machine position at the end of the block
+        QVector3D unitVector;
+        double length;
+        double nominalSpeed;
+        double acceleration;
+        double maxJunctionSpeed;    //Entering this block from the previous one
+        bool isRapid;
+        bool isJog;
+    };
+
+    void transferLinkIn(int byteCount);
+    void transferLinkOut(int byteCount);
+    void processRealtimeByte(char byte);
+    void processRxBuffer();
+    bool processLine(const QByteArray &line);
+    bool processSystemCommand(const QByteArray &line);
+    bool processGcode(const QByteArray &line, bool isJog);
+    void planMotion(const QVector3D &target, double feedRate, bool isRapid, bool isJog);
+    void executeMotion(double duration);
+    void softReset();
+    void raiseAlarm(int alarmId);
+
+    void sendLine(const QByteArray &line);
+    void sendError(int errorId);
+    void sendStatusReport();
+    void sendParameters();
+    QByteArray getStateString() const;
+    static void appendVector(QByteArray *report, const QVector3D &vector);
+
+    double getJunctionSpeed(const PlannedBlock &previous, const PlannedBlock &next) const;
+    double getExitSpeedLimit() const;
+    double getSpeedFactor(const PlannedBlock &block) const;
+    double getRapidRate(const QVector3D &unitVector) const;
+    double getAcceleration(const QVector3D &unitVector) const;
+    bool isOutsideSoftLimits(const QVector3D &target) const;
+    bool isIdle() const;
+
+    static QMap<int,double> generateDefaultSettings();
+
+    //Board configuration
+    qint32 m_baudRate;
+    double m_timeScale;
+    int m_rxBufferSize;
+    int m_plannerBlockCount;
+    QMap<int,double> m_settings;
+
+    //Virtual time, in seconds
+    QTimer* m_stepTimer;
+    QElapsedTimer m_realClock;
+    qint64 m_lastStepTime;
+    double m_virtualTime;
+    double m_linkInTime;        //Time the byte being received is complete
+    double m_linkOutTime;
+
+    //Serial link, both ways, and board rx buffer
+    QByteArray m_linkIn;        //Written by the host, not received by the board yet
+    QByteArray m_linkOut;       //Sent by the board, not received by the host yet
+    QByteArray m_readBuffer;    //Received by the host, not read yet
+    QByteArray m_rxBuffer;
+    int m_rxOverflowCount;
+    qint64 m_receivedSize;      //Received by the board since last bytesWritten
+
+    //Parser state
+    bool m_isRelative;
+    bool m_isInches;
+    bool m_isRapid;
+    double m_feedRate;          //mm/min
+    double m_spindleSpeed;
+
+    //Planner and motion
+    QQueue<PlannedBlock> m_planner;
+    QVector3D m_plannedPosition;    //End of the last planned block
+    QVector3D m_machinePosition;
+    QVector3D m_workOffset;         //G92, the only offset emulated
+    double m_speed;
+    double m_currentDistance;       //Travelled in the first planned block
+    bool m_isHoldRequested;
+    bool m_isJogCancelRequested;
+    double m_starvedTime;
+
+    States m_state;
+    int m_feedOverride;
+    int m_rapidOverride;
+    int m_spindleOverride;
+    int m_reportCount;
+};
+
+#endif // GRBLEMULATOR_H
@@ -0,0 +1,84 @@
+#include "grblfeedgovernor.h"
+#include "grbldefinitions.h"
+
+GrblFeedGovernor::GrblFeedGovernor():
+    m_isEnabled(false),
+    m_operatorOverride(100),
+    m_reduction(0),
+    m_starvedReportCount(0),
+    m_healthyReportCount(0)
+{
+
+}
+
+void GrblFeedGovernor::setEnabled(bool isEnabled){
+    //Reduction already applied is given back progressively by update
+    m_isEnabled = isEnabled;
+    m_starvedReportCount = 0;
+    m_healthyReportCount = 0;
+}
+
+void GrblFeedGovernor::onOperatorFeedOverride(int change){
+    //Board override is the operator's minus the reduction, the change applies to it
+    if(change == 0){
+        m_operatorOverride = 100;
+    }
+    else{
+        m_operatorOverride = qBound(OVR_MIN_PERCENT, m_operatorOverride - m_reduction + change, OVR_MAX_PERCENT);
+    }
+    m_reduction = 0;
+    m_starvedReportCount = 0;
+    m_healthyReportCount = 0;
+}
+
+void GrblFeedGovernor::clear(){
+    //Board reset its overrides
+    m_operatorOverride = 100;
+    m_reduction = 0;
+    m_starvedReportCount = 0;
+    m_healthyReportCount = 0;
+}
+
+int GrblFeedGovernor::update(const GrblStatus &status, int plannerBlockCount, bool isStreamWaiting){
+    if(!status.containsMotionsPlanned() || !status.containsOverrides()){
+        return 0;
+    }
+
+    //Planner only starves while running with lines still waiting on our side
+    bool isFeeding = m_isEnabled && status.getState() == GrblStatus::state_run && isStreamWaiting;
+    int motionsPlanned = status.getMotionsPlanned();
+    bool isStarving = isFeeding && motionsPlanned <= plannerBlockCount / FEED_GOVERNOR_LOW_FILL_DIVIDER;
+    bool isHealthy = !isFeeding || motionsPlanned >= plannerBlockCount / FEED_GOVERNOR_HIGH_FILL_DIVIDER;
+
+    if(isStarving){
+        m_healthyReportCount = 0;
+        if(++m_starvedReportCount >= FEED_GOVERNOR_REACTION_REPORTS){
+            m_starvedReportCount = 0;
+            if(m_reduction < FEED_GOVERNOR_MAX_REDUCTION && status.getFeedOverride() > OVR_MIN_PERCENT){
+                m_reduction++;
+                return -1;
+            }
+        }
+    }
+    else if(isHealthy){
+        m_starvedReportCount = 0;
+        if(++m_healthyReportCount >= FEED_GOVERNOR_REACTION_REPORTS){
+            m_healthyReportCount = 0;
+            //Never above what the operator asked for, whatever the board did meanwhile
+            if(m_reduction > 0 && status.getFeedOverride() >= m_operatorOverride){
+                m_reduction = 0;
+            }
+            else if(m_reduction > 0){
+                m_reduction--;
+                return 1;
+            }
+        }
+    }
+    else{
+        //In between : keep feed as is
+        m_starvedReportCount = 0;
+        m_healthyReportCount = 0;
+    }
+
+    return 0;
+}
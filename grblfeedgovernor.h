@@ -0,0 +1,41 @@
+#ifndef GRBLFEEDGOVERNOR_H
+#define GRBLFEEDGOVERNOR_H
+
+#include "grblstatus.h"
+
+#define FEED_GOVERNOR_MAX_REDUCTION     20      //Percents of feed override the governor may take away
+#define FEED_GOVERNOR_REACTION_REPORTS  3       //Consecutive reports needed before changing feed override
+#define FEED_GOVERNOR_LOW_FILL_DIVIDER  4       //Planner below a quarter full is about to starve
+#define FEED_GOVERNOR_HIGH_FILL_DIVIDER 2       //Planner above half full has margin again
+
+//Watches planner fill while streaming : when the link cannot keep up with tiny segments, the planner drains
+//and the machine stops and goes. Lowering feed slightly gives the link time to refill it, for a steady motion
+//Decides 1% feed override steps, the caller sends them
+class GrblFeedGovernor
+{
+public:
+    GrblFeedGovernor();
+
+    void setEnabled(bool isEnabled);
+    bool isEnabled() const {return m_isEnabled;}
+
+    //Percents currently taken away from the operator's feed override
+    int getReduction() const {return m_reduction;}
+
+    //Operator changed feed override, in percents, 0 restores programmed feed
+    //The reduction in effect becomes part of the operator's choice : nothing is given back above it
+    void onOperatorFeedOverride(int change);
+    void clear();
+
+    //Returns the feed override change to apply, in percents : -1, 0 or +1
+    int update(const GrblStatus &status, int plannerBlockCount, bool isStreamWaiting);
+
+private:
+    bool m_isEnabled;
+    int m_operatorOverride;         //Feed override the operator asked for, in percents
+    int m_reduction;
+    int m_starvedReportCount;
+    int m_healthyReportCount;
+};
+
+#endif // GRBLFEEDGOVERNOR_H
@@ -2,15 +2,17 @@
 #include "grbldefinitions.h"
 
 #include <QStringList>
+#include <cstring>
 
 const char* GrblInstruction::s_blockingInstructionsList[] = {INSTRUCTIONS_BLOCKING};
 
-uint32_t GrblInstruction::s_uidCounter = 0u;
+QAtomicInteger<quint32> GrblInstruction::s_uidCounter(0u);
 
 GrblInstruction::GrblInstruction(QString instruction, int lineNumber):
-    m_uid(s_uidCounter++),
+    m_uid(s_uidCounter.fetchAndAddRelaxed(1)),
     m_instructionBytes(instruction.toLatin1()),
-    m_lineNumber(lineNumber)
+    m_lineNumber(lineNumber),
+    m_isTerminatorMissing(false)
 {
     //Remove any Grbl realtime command
     m_instructionBytes.replace(QByteArrayLiteral(CMD_PAUSE_STRING),QByteArray());
@@ -24,19 +26,77 @@ GrblInstruction::GrblInstruction(QString instruction, int lineNumber):
         m_instructionBytes.append(END_OF_INSTRUCTION);
     }
 
-    m_isBlocking = isInherentlyBlocking();
+    m_isBlocking = isBlockingInstruction(m_instructionBytes.constData(), m_instructionBytes.size());
 }
 
-bool GrblInstruction::isInherentlyBlocking(){
+GrblInstruction GrblInstruction::fromRawData(const char *data, int size, int lineNumber){
+    //Realtime commands must be removed, which requires a copy
+    if(containsRealtimeCommand(data, size)){
+        return GrblInstruction(QString::fromLatin1(data, size), lineNumber);
+    }
+
+    return fromRawData(data, size, lineNumber, isBlockingInstruction(data, size));
+}
+
+GrblInstruction GrblInstruction::fromRawData(const char *data, int size, int lineNumber, bool isBlocking){
+    GrblInstruction instruction;
+    instruction.m_instructionBytes = QByteArray::fromRawData(data, size);
+    instruction.m_lineNumber = lineNumber;
+    instruction.m_isTerminatorMissing = (size > 0);
+    instruction.m_isBlocking = isBlocking;
+    return instruction;
+}
+
+bool GrblInstruction::containsRealtimeCommand(const char *data, int size){
+    static const char realtimeCommands[] = CMD_PAUSE_STRING CMD_RESUME_STRING CMD_STATUS_REQ_STRING CMD_SOFT_RESET_STRING CMD_SAFETY_DOOR;
+    for(const char *command = realtimeCommands ; *command != '\0' ; command++){
+        if(memchr(data, *command, size) != nullptr){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GrblInstruction::isBlockingInstruction(const char *data, int size){
+    //Jog motions start like settings, but are streamed as any motion
+    if(size >= int(sizeof(INST_JOG_PREFIX)) - 1 && memcmp(data, INST_JOG_PREFIX, sizeof(INST_JOG_PREFIX) - 1) == 0){
+        return false;
+    }
+
     int blockingInstructionCount = sizeof(s_blockingInstructionsList)/sizeof(s_blockingInstructionsList[0]);
     for(int i = 0 ; i < blockingInstructionCount ; i++){
-        if(m_instructionBytes.startsWith(s_blockingInstructionsList[i])){
+        int blockingInstructionLength = int(strlen(s_blockingInstructionsList[i]));
+        if(size >= blockingInstructionLength && memcmp(data, s_blockingInstructionsList[i], blockingInstructionLength) == 0){
             return true;
         }
     }
     return false;
 }
 
+QByteArray GrblInstruction::getBytes() const{
+    if(m_isTerminatorMissing){
+        return m_instructionBytes + END_OF_INSTRUCTION;
+    }
+    return m_instructionBytes;
+}
+
+void GrblInstruction::appendBytesTo(QByteArray *bytes) const{
+    bytes->append(m_instructionBytes);
+    if(m_isTerminatorMissing){
+        bytes->append(END_OF_INSTRUCTION);
+    }
+}
+
+void GrblInstruction::detach(){
+    if(m_isTerminatorMissing){
+        m_instructionBytes = getBytes();
+        m_isTerminatorMissing = false;
+    }
+    else{
+        m_instructionBytes.detach();
+    }
+}
+
 void GrblInstruction::forceBlocking(){
     m_isBlocking = true;
 }
@@ -44,19 +104,26 @@ void GrblInstruction::forceBlocking(){
 QString GrblInstruction::getStringWithLineNumber() const{
     if(m_lineNumber > 0){
         QString returnString("Line %1 : %2");
-        return returnString.arg(m_lineNumber).arg(QString::fromLatin1(m_instructionBytes));
+        return returnString.arg(m_lineNumber).arg(getString());
     }
     else{
-        return QString::fromLatin1(m_instructionBytes);
+        return getString();
     }
 }
 
+bool GrblInstruction::isJog() const{
+    return m_instructionBytes.startsWith(INST_JOG_PREFIX);
+}
+
 bool GrblInstruction::isParameterFetch() const{
+    if(m_isTerminatorMissing){
+        return m_instructionBytes == INST_GET_PARAMS;
+    }
     return (m_instructionBytes == INST_GET_PARAMS"\n" || m_instructionBytes == INST_GET_PARAMS"\r");
 }
 
 void GrblInstruction::regenerate(){
-    m_uid = s_uidCounter++;
+    m_uid = s_uidCounter.fetchAndAddRelaxed(1);
 }
 
 bool operator!=(const GrblInstruction &i1, const GrblInstruction &i2){
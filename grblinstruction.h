@@ -2,25 +2,42 @@
 #define GRBLINSTRUCTION_H
 
 #include <QString>
+#include <QAtomicInteger>
 
 class GrblInstruction
 {
 public:
     GrblInstruction(QString instruction = QString(), int lineNumber =-1);
 
+    //Build an instruction pointing to bytes owned by someone else, without any copy
+    //Bytes must not contain the END_OF_INSTRUCTION character, it is appended when bytes are requested
+    static GrblInstruction fromRawData(const char *data, int size, int lineNumber = -1);
+    //Same, when properties of the bytes were already computed by the caller
+    static GrblInstruction fromRawData(const char *data, int size, int lineNumber, bool isBlocking);
+
+    //Properties of raw instruction bytes
+    static bool isBlockingInstruction(const char *data, int size);
+    static bool containsRealtimeCommand(const char *data, int size);
+
     void forceBlocking();
 
+    //Make the instruction own its bytes, so it can outlive the data it was built from
+    void detach();
+
 
-    QByteArray getBytes() const {return m_instructionBytes;}
+    QByteArray getBytes() const;
+    //Same, without building a new byte array
+    void appendBytesTo(QByteArray *bytes) const;
     int getLineNumber() const {return m_lineNumber;}
     bool isBlocking() const {return m_isBlocking;}
 
-    int getLength() const {return m_instructionBytes.length();}
-    QString getString() const {return QString::fromLatin1(m_instructionBytes);}
+    int getLength() const {return m_instructionBytes.length() + (m_isTerminatorMissing ? 1 : 0);}
+    QString getString() const {return QString::fromLatin1(getBytes());}
 
     QString getStringWithLineNumber() const;
 
     bool isParameterFetch(void) const;
+    bool isJog(void) const;
 
     //Changes the instruction identifier, so it now become a different instruction with the same properties
     void regenerate();
@@ -34,11 +51,11 @@ private:
     QByteArray m_instructionBytes;
     int m_lineNumber;
     bool m_isBlocking;
+    bool m_isTerminatorMissing;
 
-    bool isInherentlyBlocking();
     static const char *s_blockingInstructionsList[]; //List of EEPROM related instructions, requiring use of simpler "blocking" protocol
 
-    static uint32_t s_uidCounter;
+    static QAtomicInteger<quint32> s_uidCounter;     //Instructions can be built from any thread
 };
 
 #endif // GRBLINSTRUCTION_H
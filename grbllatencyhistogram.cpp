@@ -0,0 +1,75 @@
+#include "grbllatencyhistogram.h"
+
+#include <cstring>
+
+GrblLatencyHistogram::GrblLatencyHistogram()
+{
+    clear();
+}
+
+void GrblLatencyHistogram::clear(){
+    memset(m_buckets, 0, sizeof(m_buckets));
+    m_count = 0;
+    m_total = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+void GrblLatencyHistogram::record(qint64 value){
+    value = qMax(value, qint64(0));
+    m_buckets[getBucket(value)]++;
+    m_min = (m_count == 0) ? value : qMin(m_min, value);
+    m_max = qMax(m_max, value);
+    m_total += value;
+    m_count++;
+}
+
+qint64 GrblLatencyHistogram::getValueAtPercentile(double percentile) const{
+    if(m_count == 0){
+        return 0;
+    }
+
+    //Rank of the value reached, from 1 to count
+    qint64 rank = qMax(qint64(1), qint64(percentile / 100.0 * m_count + 0.5));
+    qint64 seen = 0;
+    for(int bucket = 0 ; bucket < HISTOGRAM_BUCKETS ; bucket++){
+        seen += m_buckets[bucket];
+        if(seen >= rank){
+            return qMin(getBucketHighValue(bucket), m_max);
+        }
+    }
+    return m_max;
+}
+
+int GrblLatencyHistogram::getBucket(qint64 value){
+    //Small values have a bucket each
+    if(value < HISTOGRAM_SUB_BUCKETS){
+        return int(value);
+    }
+
+    //Position of the highest bit set, then the bits following it
+    int magnitude = HISTOGRAM_SUB_BUCKET_BITS;
+    while((value >> (magnitude + 1)) != 0){
+        if(++magnitude > HISTOGRAM_MAX_MAGNITUDE){
+            return HISTOGRAM_BUCKETS - 1;
+        }
+    }
+    int shift = magnitude - HISTOGRAM_SUB_BUCKET_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + int(value >> shift) - HISTOGRAM_SUB_BUCKETS;
+}
+
+qint64 GrblLatencyHistogram::getBucketLowValue(int bucket){
+    if(bucket < HISTOGRAM_SUB_BUCKETS){
+        return bucket;
+    }
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    return qint64(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
+qint64 GrblLatencyHistogram::getBucketHighValue(int bucket){
+    if(bucket < HISTOGRAM_SUB_BUCKETS){
+        return bucket;
+    }
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    return getBucketLowValue(bucket) + (qint64(1) << shift) - 1;
+}
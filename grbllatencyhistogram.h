@@ -0,0 +1,43 @@
+#ifndef GRBLLATENCYHISTOGRAM_H
+#define GRBLLATENCYHISTOGRAM_H
+
+#include <QtGlobal>
+
+#define HISTOGRAM_SUB_BUCKET_BITS   4       //16 buckets per power of two : values known within 6%
+#define HISTOGRAM_SUB_BUCKETS       (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_MAX_MAGNITUDE     35      //Values up to 2^36 microseconds, about 19 hours
+#define HISTOGRAM_BUCKETS           ((HISTOGRAM_MAX_MAGNITUDE - HISTOGRAM_SUB_BUCKET_BITS + 2) * HISTOGRAM_SUB_BUCKETS)
+
+//Latencies in microseconds, counted in buckets of constant relative width, as HDR histograms do
+//Fixed size and no allocation : recording is O(1) and a copy is a plain snapshot
+class GrblLatencyHistogram
+{
+public:
+    GrblLatencyHistogram();
+
+    void clear();
+    void record(qint64 value);
+
+    qint64 getCount() const {return m_count;}
+    qint64 getMin() const {return (m_count != 0) ? m_min : 0;}
+    qint64 getMax() const {return m_max;}
+    qint64 getMean() const {return (m_count != 0) ? m_total / m_count : 0;}
+    //Highest value of the bucket reaching the percentile, 0 to 100
+    qint64 getValueAtPercentile(double percentile) const;
+
+    //Buckets, for export
+    qint64 getBucketHits(int bucket) const {return m_buckets[bucket];}
+    static qint64 getBucketLowValue(int bucket);
+    static qint64 getBucketHighValue(int bucket);
+
+private:
+    static int getBucket(qint64 value);
+
+    qint64 m_buckets[HISTOGRAM_BUCKETS];
+    qint64 m_count;
+    qint64 m_total;
+    qint64 m_min;
+    qint64 m_max;
+};
+
+#endif // GRBLLATENCYHISTOGRAM_H
@@ -0,0 +1,25 @@
+#ifndef GRBLPRIORITYMETRICS_H
+#define GRBLPRIORITYMETRICS_H
+
+#include <QtGlobal>
+
+//What instructions are sent for, higher classes being served first, and how well each class is served
+//Times are in microseconds
+struct GrblPriorityMetrics{
+    enum Class{class_realtime, class_operator, class_stream, class_background, class_count};
+
+    qint64 admittedCount = 0;       //Handed to the board
+    qint64 rejectedCount = 0;       //Refused : queue full, link closed or board reset
+    qint64 discardedCount = 0;      //Dropped from queue by sender flush
+    qint64 respondedCount = 0;
+
+    qint64 totalQueueWait = 0;      //From request to admission in board char buffer
+    qint64 maxQueueWait = 0;
+    qint64 totalResponseTime = 0;   //From admission to board answer
+    qint64 maxResponseTime = 0;
+
+    qint64 getAverageQueueWait() const {return (admittedCount != 0) ? totalQueueWait / admittedCount : 0;}
+    qint64 getAverageResponseTime() const {return (respondedCount != 0) ? totalResponseTime / respondedCount : 0;}
+};
+
+#endif // GRBLPRIORITYMETRICS_H
@@ -0,0 +1,163 @@
+#include "grblresponsereader.h"
+#include "grbldefinitions.h"
+
+#include <cstring>
+
+#define RING_MASK   (RX_RING_CAPACITY - 1)
+
+GrblResponseReader::GrblResponseReader()
+{
+    clear();
+}
+
+void GrblResponseReader::clear(){
+    m_readIndex = 0;
+    m_writeIndex = 0;
+    m_scannedSize = 0;
+}
+
+qint64 GrblResponseReader::readFrom(QIODevice *device){
+    qint64 totalRead = 0;
+
+    //Free room may be split in two by the end of the ring
+    forever{
+        int freeSize = RX_RING_CAPACITY - getUsedSize();
+        int writePosition = int(m_writeIndex & RING_MASK);
+        int contiguousSize = qMin(freeSize, RX_RING_CAPACITY - writePosition);
+        if(contiguousSize <= 0){
+            break;
+        }
+
+        qint64 readSize = device->read(m_ring + writePosition, contiguousSize);
+        if(readSize <= 0){
+            break;
+        }
+
+        m_writeIndex += quint32(readSize);
+        totalRead += readSize;
+        if(readSize < contiguousSize){
+            break;
+        }
+    }
+
+    return totalRead;
+}
+
+bool GrblResponseReader::takeResponse(GrblResponse *response){
+    int usedSize = getUsedSize();
+
+    //Look for the end of line, only in bytes not scanned yet
+    int lineLength = -1;
+    while(m_scannedSize < usedSize){
+        int scanPosition = int((m_readIndex + quint32(m_scannedSize)) & RING_MASK);
+        int contiguousSize = qMin(usedSize - m_scannedSize, RX_RING_CAPACITY - scanPosition);
+
+        const char *separator = static_cast<const char*>(memchr(m_ring + scanPosition, END_OF_INSTRUCTION, contiguousSize));
+        if(separator != nullptr){
+            lineLength = m_scannedSize + int(separator - (m_ring + scanPosition));
+            break;
+        }
+        m_scannedSize += contiguousSize;
+    }
+
+    int consumedSize;
+    if(lineLength >= 0){
+        consumedSize = lineLength + 1;
+    }
+    else if(usedSize == RX_RING_CAPACITY){
+        //Ring full of a single line : hand it over as it is, so that reception goes on
+        lineLength = usedSize;
+        consumedSize = usedSize;
+    }
+    else{
+        return false;
+    }
+
+    const char *line = extractLine(m_readIndex, lineLength);
+
+    //Board ends lines with "\r\n"
+    if(lineLength > 0 && line[lineLength - 1] == '\r'){
+        lineLength--;
+    }
+
+    m_readIndex += quint32(consumedSize);
+    m_scannedSize = 0;
+
+    response->data = line;
+    response->length = lineLength;
+    response->type = classify(line, lineLength);
+    return true;
+}
+
+const char *GrblResponseReader::extractLine(quint32 start, int length){
+    int startPosition = int(start & RING_MASK);
+    if(startPosition + length <= RX_RING_CAPACITY){
+        return m_ring + startPosition;
+    }
+
+    int firstPartSize = RX_RING_CAPACITY - startPosition;
+    memcpy(m_line, m_ring + startPosition, size_t(firstPartSize));
+    memcpy(m_line + firstPartSize, m_ring, size_t(length - firstPartSize));
+    return m_line;
+}
+
+GrblResponse::Type GrblResponseReader::classify(const char *data, int length){
+    static const int okLength = sizeof(RESPONSE_OK) - 1;
+    static const int errorLength = sizeof(RESPONSE_ERROR) - 1;
+    static const int alarmLength = sizeof(RESPONSE_ALARM) - 1;
+    static const int versionLength = sizeof(VERSION_STRING) - 1;
+
+    if(length <= 0){
+        return GrblResponse::response_empty;
+    }
+
+    //First byte is enough to tell most responses apart
+    switch(data[0]){
+    case 'o':
+        if(length == okLength && memcmp(data, RESPONSE_OK, okLength) == 0){
+            return GrblResponse::response_ok;
+        }
+        break;
+    case 'e':
+        if(length >= errorLength && memcmp(data, RESPONSE_ERROR, errorLength) == 0){
+            return GrblResponse::response_error;
+        }
+        break;
+    case 'A':
+        if(length >= alarmLength && memcmp(data, RESPONSE_ALARM, alarmLength) == 0){
+            return GrblResponse::response_alarm;
+        }
+        break;
+    case '<':
+        if(data[length - 1] == '>'){
+            return GrblResponse::response_status;
+        }
+        break;
+    case '[':
+        if(data[length - 1] == ']'){
+            return GrblResponse::response_feedback;
+        }
+        break;
+    case 'G':
+        if(length >= versionLength && memcmp(data, VERSION_STRING, versionLength) == 0){
+            return GrblResponse::response_startup;
+        }
+        break;
+    case '$':
+        //"$n=value", checked further by the configuration parser
+        if(length >= 4 && data[1] >= '0' && data[1] <= '9' && memchr(data, '=', length) != nullptr){
+            return GrblResponse::response_parameter;
+        }
+        break;
+    default:
+        break;
+    }
+
+    //Only blank characters make an empty line
+    for(int i = 0 ; i < length ; i++){
+        if(data[i] != ' ' && data[i] != '\t' && data[i] != '\r'){
+            return GrblResponse::response_text;
+        }
+    }
+    return GrblResponse::response_empty;
+}
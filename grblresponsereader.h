@@ -0,0 +1,50 @@
+#ifndef GRBLRESPONSEREADER_H
+#define GRBLRESPONSEREADER_H
+
+#include <QString>
+#include <QIODevice>
+
+#define RX_RING_CAPACITY    4096    //Power of two, longest response the board can send fits many times
+
+//Line received from the board, classified from its first bytes
+//Bytes belong to the reader : they are valid until the reader is filled again
+struct GrblResponse{
+    enum Type{response_empty, response_ok, response_error, response_alarm, response_status, response_feedback,
+              response_parameter, response_startup, response_text};
+
+    Type type;
+    const char *data;       //Without line separator
+    int length;
+
+    //Text is only built for consumers needing it
+    QString toString() const {return QString::fromLatin1(data, length);}
+};
+
+//Receive path of the serial link : fixed capacity ring of bytes, split in responses without any allocation
+class GrblResponseReader
+{
+public:
+    GrblResponseReader();
+
+    void clear();
+
+    //Read whatever the device has, up to the free room in the ring. Returns the count of bytes read
+    qint64 readFrom(QIODevice *device);
+
+    //False if no complete line is buffered
+    bool takeResponse(GrblResponse *response);
+
+    static GrblResponse::Type classify(const char *data, int length);
+
+private:
+    int getUsedSize() const {return int(m_writeIndex - m_readIndex);}
+    const char *extractLine(quint32 start, int length);
+
+    char m_ring[RX_RING_CAPACITY];
+    char m_line[RX_RING_CAPACITY];      //Lines wrapping around the end of the ring are made contiguous here
+    quint32 m_readIndex;                //Free running counters, wrapped when indexing the ring
+    quint32 m_writeIndex;
+    int m_scannedSize;                  //Bytes from read index known not to hold a line separator
+};
+
+#endif // GRBLRESPONSEREADER_H
@@ -0,0 +1,1011 @@
+#include "grblserialworker.h"
+#include "grbldefinitions.h"
+
+#include <QSettings>
+#include <QStringList>
+
+#define DEFAULT_STATUS_REQUEST_INTERVAL 250     //While idle
+#define MOTION_STATUS_REQUEST_INTERVAL  40      //While moving, about 25 reports per second
+#define STATUS_REQUEST_TIMEOUT_MS       1000    //Report never came, request again
+#define STATUS_LATENCY_SMOOTHING        8       //Weight of the previous average against a new measure
+#define STARTUP_INSTRUCTIONS_DELAY_MS   100
+#define EVENT_RETRY_INTERVAL_MS         10      //GUI thread is late taking events, try again later
+#define OUTPUT_BUFFER_RESERVE           4096    //Bytes of instructions gathered for a single write
+#define BOARD_PROFILES_GROUP            "BoardProfiles"
+#define STREAM_RX_RESERVE_DIVIDER       8       //Part of board rx buffer lower classes leave to operator instructions
+#define JOG_MIN_INCREMENT_MS            40      //Shortest motion of a jog increment, longer if the link is slow
+#define JOG_KEEP_ALIVE_TIMEOUT_MS       500     //Jog cancelled when the GUI stops keeping it alive, frozen or gone
+#define EMULATOR_DEFAULT_TIME_SCALE     1.0
+#define DEPTH_SAMPLE_INTERVAL_US        100000  //Queue depths are sampled with status reports, at most this often
+#define RT_CMD_STATUS_BURST_INTERVAL_MS 10      //Until a real time command shows its effect
+#define RT_CMD_TIMEOUT_US               3000000 //Effect never seen, resume may wait for the spindle after a door
+
+
+const QMap<int,QString> GrblSerialWorker::errorTranslationMap = GrblSerialWorker::generateErrorTranslationMap();
+
+GrblSerialWorker::GrblSerialWorker(QObject *parent) :
+    QObject(parent),
+    m_isCommandWakeupPending(0),
+    m_isEventWakeupPending(0),
+    m_queuedInstructionCount(0),
+    m_pendingWriteSize(0),
+    m_boardCharBuffer(BOARD_RX_BUFFER_SIZE),
+    m_plannerBlockCount(BOARD_PLANNER_BLOCKS),
+    m_status(false),
+    m_idleStatusInterval(DEFAULT_STATUS_REQUEST_INTERVAL),
+    m_statusRequestInterval(DEFAULT_STATUS_REQUEST_INTERVAL),
+    m_isStatusRequestPending(false),
+    m_lastStatusLatency(0),
+    m_averageStatusLatency(0),
+    m_emulatorStarvedTime(0),
+    m_emulatorRxOverflowCount(0),
+    m_isVersion11OrLater(false),
+    m_isReportMaskNegotiated(false),
+    m_feedGovernorReduction(0),
+    m_isJogging(false),
+    m_jogFeedRate(0),
+    m_isJogIncrementPending(false),
+    m_depthHistoryHead(0),
+    m_lastDepthSampleTime(0),
+    m_realtimeTimeoutCounts()
+{
+    //Children follow the worker in its thread
+    m_serialPort = new QSerialPort(this);
+    connect(m_serialPort, &QSerialPort::readyRead, this, &GrblSerialWorker::onSerialDataAvailable);
+    connect(m_serialPort, &QSerialPort::bytesWritten, this, &GrblSerialWorker::onSerialBytesWritten);
+    m_emulator = new GrblEmulator(this);
+    connect(m_emulator, &GrblEmulator::readyRead, this, &GrblSerialWorker::onSerialDataAvailable);
+    connect(m_emulator, &GrblEmulator::bytesWritten, this, &GrblSerialWorker::onSerialBytesWritten);
+    m_link = m_serialPort;
+
+    //Reserved capacity is kept when the buffer is emptied
+    m_outputBuffer.reserve(OUTPUT_BUFFER_RESERVE);
+    m_depthHistory.reserve(DEPTH_HISTORY_CAPACITY);
+
+    m_clock.start();
+
+    m_statusTimer = new QTimer(this);
+    m_statusTimer->setInterval(DEFAULT_STATUS_REQUEST_INTERVAL);
+    connect(m_statusTimer,&QTimer::timeout,this,&GrblSerialWorker::requestStatus);
+
+    m_eventRetryTimer = new QTimer(this);
+    m_eventRetryTimer->setSingleShot(true);
+    m_eventRetryTimer->setInterval(EVENT_RETRY_INTERVAL_MS);
+    connect(m_eventRetryTimer,&QTimer::timeout,this,&GrblSerialWorker::flushEventOverflow);
+
+    m_jogKeepAliveTimer = new QTimer(this);
+    m_jogKeepAliveTimer->setSingleShot(true);
+    m_jogKeepAliveTimer->setInterval(JOG_KEEP_ALIVE_TIMEOUT_MS);
+    connect(m_jogKeepAliveTimer,&QTimer::timeout,this,&GrblSerialWorker::onJogKeepAliveLapsed);
+
+    //Emitted from the GUI thread, always handled in the worker thread
+    connect(this,&GrblSerialWorker::commandsAvailable,this,&GrblSerialWorker::processCommands,Qt::QueuedConnection);
+
+    //Build instruction to send at startup list
+    m_startupInstructionList.append(GrblInstruction(QStringLiteral(INST_GET_PARAMS)));
+    m_startupInstructionList.append(GrblInstruction(QStringLiteral(INST_GET_BUILD_INFO)));     //Reports buffer sizes
+}
+
+bool GrblSerialWorker::postCommand(const GrblBoardCommand &command){
+    if(!m_commands.push(command)){
+        return false;
+    }
+
+    //Wake the worker only once for a burst of commands
+    if(m_isCommandWakeupPending.testAndSetOrdered(0,1)){
+        emit commandsAvailable();
+    }
+    return true;
+}
+
+bool GrblSerialWorker::postRealtimeCommand(const GrblBoardCommand &command){
+    if(!m_realtimeCommands.push(command)){
+        return false;
+    }
+
+    if(m_isCommandWakeupPending.testAndSetOrdered(0,1)){
+        emit commandsAvailable();
+    }
+    return true;
+}
+
+void GrblSerialWorker::processCommands(){
+    //Commands posted from now on need a new wake up
+    m_isCommandWakeupPending.storeRelease(0);
+
+    //Realtime commands overtake whatever is waiting in the command queue
+    GrblBoardCommand command;
+    while(m_realtimeCommands.pop(&command)){
+        processCommand(command);
+    }
+    while(m_commands.pop(&command)){
+        processCommand(command);
+    }
+
+    sendQueuedInstructions();
+}
+
+void GrblSerialWorker::processCommand(GrblBoardCommand &command){
+    switch(command.type){
+    case GrblBoardCommand::command_toggle_serial:
+        toggleSerial();
+        break;
+    case GrblBoardCommand::command_serial_settings:
+        m_serialPort->setPortName(command.portName);
+        m_serialPort->setBaudRate(command.value);
+        m_emulator->setBaudRate(command.value);
+        break;
+    case GrblBoardCommand::command_status_interval:
+        m_idleStatusInterval = command.value;
+        if(!m_status.isStateMoving()){
+            setStatusRequestInterval(m_idleStatusInterval);
+        }
+        break;
+    case GrblBoardCommand::command_realtime:
+        //Grbl 1.1 takes '@' as an ordinary character
+        if(command.bytes == CMD_SAFETY_DOOR && m_isVersion11OrLater){
+            command.bytes = QByteArrayLiteral(CMD_SAFETY_DOOR_1_1);
+        }
+        writeRealtimeCommand(command.bytes);
+        trackRealtimeCommand(command.bytes,command.requestTime);
+        break;
+    case GrblBoardCommand::command_send:
+        queueOperatorInstruction(command.instruction);
+        break;
+    case GrblBoardCommand::command_queue:
+        m_queuedInstructions.enqueue({command.instruction, getTime()});
+        break;
+    case GrblBoardCommand::command_flush:
+        discardQueuedInstructions();
+        break;
+    case GrblBoardCommand::command_feed_override:
+        m_feedGovernor.onOperatorFeedOverride(command.value);
+        m_feedGovernorReduction.storeRelease(0);
+        writeOverrideCommand(command.value,CMD_FEED_OVR_RESET,CMD_FEED_OVR_COARSE_PLUS,CMD_FEED_OVR_COARSE_MINUS,
+                             CMD_FEED_OVR_FINE_PLUS,CMD_FEED_OVR_FINE_MINUS);
+        break;
+    case GrblBoardCommand::command_spindle_override:
+        writeOverrideCommand(command.value,CMD_SPINDLE_OVR_RESET,CMD_SPINDLE_OVR_COARSE_PLUS,CMD_SPINDLE_OVR_COARSE_MINUS,
+                             CMD_SPINDLE_OVR_FINE_PLUS,CMD_SPINDLE_OVR_FINE_MINUS);
+        break;
+    case GrblBoardCommand::command_feed_governor:
+        m_feedGovernor.setEnabled(command.value != 0);
+        break;
+    case GrblBoardCommand::command_jog_start:
+        startJog(command.vector,command.value);
+        break;
+    case GrblBoardCommand::command_jog_keep_alive:
+        keepJogAlive();
+        break;
+    case GrblBoardCommand::command_jog_stop:
+        stopJog();
+        break;
+    case GrblBoardCommand::command_clear_diagnostics:
+        clearDiagnostics();
+        break;
+    }
+}
+
+void GrblSerialWorker::toggleSerial(){
+    if(m_link->isOpen()){
+        m_link->close();
+        m_statusTimer->stop();
+        m_isStatusRequestPending = false;
+        m_status = GrblStatus(false);
+        m_boardCharBuffer.clear();
+        m_responseReader.clear();
+        m_outputBuffer.truncate(0);
+        m_pendingWriteSize.storeRelease(0);
+        m_backgroundQueue.clear();
+        m_isJogging = false;
+        m_isJogIncrementPending = false;
+        m_jogKeepAliveTimer->stop();
+        m_pendingRealtimeCommands.clear();
+        rejectOperatorInstructions(tr("Serial link closed"));
+        discardQueuedInstructions();
+    }
+    else{
+        //Port name chooses the link, both are driven the same way
+        if(m_serialPort->portName() == QLatin1String(EMULATOR_PORT_NAME)){
+            configureEmulator();
+            m_link = m_emulator;
+        }
+        else{
+            m_link = m_serialPort;
+        }
+
+        if(m_link->open(QIODevice::ReadWrite)){
+            m_status = GrblStatus(true);
+            loadBoardProfile();     //Sizes known from previous sessions on this port, until the board tells them again
+            writeRealtimeCommand(QByteArrayLiteral(CMD_SOFT_RESET_STRING));     //Immediately performs a soft reset so the board is in a known state
+        }
+    }
+
+    GrblBoardEvent event;
+    event.type = GrblBoardEvent::event_status;
+    event.status = m_status;
+    postEvent(event);
+}
+
+void GrblSerialWorker::configureEmulator(){
+    //Emulated board is described in settings, so that any board can be benchmarked
+    QSettings settings("settings.ini",QSettings::IniFormat);
+    settings.beginGroup(EMULATOR_SETTINGS_GROUP);
+    double timeScale = settings.value("TimeScale",EMULATOR_DEFAULT_TIME_SCALE).toDouble();
+    m_emulator->setTimeScale(timeScale > 0.0 ? timeScale : EMULATOR_DEFAULT_TIME_SCALE);
+    m_emulator->setRxBufferSize(settings.value("RxBufferSize",EMULATOR_RX_BUFFER_SIZE).toInt());
+    m_emulator->setPlannerBlockCount(settings.value("PlannerBlockCount",EMULATOR_PLANNER_BLOCKS).toInt());
+    settings.endGroup();
+}
+
+void GrblSerialWorker::writeRealtimeCommand(const QByteArray &command){
+    //Realtime commands are never held back behind instructions
+    if(writeToPort(command) > 0){
+        QMutexLocker locker(&m_metricsMutex);
+        m_priorityMetrics[GrblPriorityMetrics::class_realtime].admittedCount++;
+    }
+}
+
+void GrblSerialWorker::trackRealtimeCommand(const QByteArray &command, qint64 requestTime){
+    if(!m_link->isOpen()){
+        return;
+    }
+
+    //Only commands expected to change the state are timed : a feed hold leaves an idle board idle
+    GrblStatus::states state = m_status.getState();
+    int realtimeCommand;
+    if(command == CMD_PAUSE_STRING && m_status.isStateMoving()){
+        realtimeCommand = GrblDiagnostics::realtime_feed_hold;
+    }
+    else if(command == CMD_RESUME_STRING && (state == GrblStatus::state_hold || state == GrblStatus::state_door)){
+        realtimeCommand = GrblDiagnostics::realtime_resume;
+    }
+    else if((command == CMD_SAFETY_DOOR || command == CMD_SAFETY_DOOR_1_1) && state != GrblStatus::state_door){
+        realtimeCommand = GrblDiagnostics::realtime_safety_door;
+    }
+    else if(command == CMD_SOFT_RESET_STRING){
+        realtimeCommand = GrblDiagnostics::realtime_soft_reset;
+    }
+    else{
+        return;
+    }
+    m_pendingRealtimeCommands.append({realtimeCommand, requestTime});
+
+    //Ask for the new state right away and keep asking until it shows, rather than guessing how long the board takes
+    setStatusRequestInterval(RT_CMD_STATUS_BURST_INTERVAL_MS);
+    requestStatus();
+}
+
+void GrblSerialWorker::updateRealtimeCommands(bool isStartup){
+    if(m_pendingRealtimeCommands.isEmpty()){
+        return;
+    }
+
+    qint64 now = getTime();
+    GrblStatus::states state = m_status.getState();
+    QMutexLocker locker(&m_metricsMutex);
+    int i = 0;
+    while(i < m_pendingRealtimeCommands.size()){
+        const PendingRealtimeCommand &pending = m_pendingRealtimeCommands.at(i);
+        bool isDone;
+        switch(pending.command){
+        case GrblDiagnostics::realtime_feed_hold:
+            isDone = !m_status.isStateMoving();
+            break;
+        case GrblDiagnostics::realtime_resume:
+            isDone = state != GrblStatus::state_hold && state != GrblStatus::state_door;
+            break;
+        case GrblDiagnostics::realtime_safety_door:
+            isDone = state == GrblStatus::state_door;
+            break;
+        default:
+            isDone = isStartup;     //Reset is done once the board starts again
+            break;
+        }
+
+        if(isDone){
+            m_realtimeLatencyHistograms[pending.command].record(now - pending.requestTime);
+        }
+        else if(now - pending.requestTime > RT_CMD_TIMEOUT_US){
+            m_realtimeTimeoutCounts[pending.command]++;
+        }
+        else if(!isStartup){
+            i++;
+            continue;
+        }
+        //A reset takes over commands sent before it, nothing left to wait for
+        m_pendingRealtimeCommands.removeAt(i);
+    }
+}
+
+void GrblSerialWorker::requestStatus(){
+    //Real time commands whose effect never shows are given up here, as the board may not answer any more
+    updateRealtimeCommands(false);
+
+    //Report asked for is on its way, the next one would only queue behind it
+    if(m_isStatusRequestPending && !m_statusRequestTimer.hasExpired(STATUS_REQUEST_TIMEOUT_MS)){
+        return;
+    }
+
+    if(writeToPort(QByteArrayLiteral(CMD_STATUS_REQ_STRING)) > 0){
+        m_isStatusRequestPending = true;
+        m_statusRequestTimer.start();
+    }
+}
+
+void GrblSerialWorker::onStatusReceived(){
+    if(m_isStatusRequestPending){
+        m_isStatusRequestPending = false;
+        int latency = int(m_statusRequestTimer.nsecsElapsed() / 1000);
+        int average = m_averageStatusLatency.loadAcquire();
+        average = (average == 0) ? latency : (average * (STATUS_LATENCY_SMOOTHING - 1) + latency) / STATUS_LATENCY_SMOOTHING;
+        m_lastStatusLatency.storeRelease(latency);
+        m_averageStatusLatency.storeRelease(average);
+    }
+
+    sampleQueueDepths();
+    updateRealtimeCommands(false);
+
+    if(m_link == m_emulator){
+        m_emulatorStarvedTime.storeRelease(int(m_emulator->getStarvedTime() * 1000));
+        m_emulatorRxOverflowCount.storeRelease(m_emulator->getRxOverflowCount());
+    }
+
+    //Follow motions closely, back off progressively once the board has nothing left to do
+    int interval;
+    if(m_status.isStateMoving() || (m_status.getState() == GrblStatus::state_idle && !m_boardCharBuffer.isEmpty())){
+        interval = MOTION_STATUS_REQUEST_INTERVAL;
+    }
+    else{
+        interval = qMin(m_statusTimer->interval() * 2, m_idleStatusInterval);
+    }
+    if(!m_pendingRealtimeCommands.isEmpty()){
+        interval = RT_CMD_STATUS_BURST_INTERVAL_MS;
+    }
+    setStatusRequestInterval(interval);
+}
+
+void GrblSerialWorker::setStatusRequestInterval(int interval){
+    //Changing the interval restarts the timer, which would delay the next request forever if done on each report
+    if(interval != m_statusTimer->interval()){
+        m_statusTimer->setInterval(interval);
+        m_statusRequestInterval.storeRelease(interval);
+    }
+}
+
+qint64 GrblSerialWorker::writeToPort(const QByteArray &bytes){
+    qint64 writtenSize = m_link->write(bytes);
+    if(writtenSize > 0){
+        m_pendingWriteSize.fetchAndAddOrdered(int(writtenSize));
+    }
+    return writtenSize;
+}
+
+void GrblSerialWorker::onSerialDataAvailable(){
+    //Ring may be smaller than what the port holds : read and process until port is empty
+    qint64 readSize;
+    do{
+        readSize = m_responseReader.readFrom(m_link);
+
+        GrblResponse response;
+        while(m_responseReader.takeResponse(&response)){
+            processResponse(response);
+        }
+    }while(readSize > 0 && m_link->bytesAvailable() > 0);
+
+    //Board made room in its char buffer, refill it without waiting for the GUI thread
+    sendQueuedInstructions();
+}
+
+void GrblSerialWorker::processResponse(const GrblResponse &response){
+    //Get the instruction currently executed by the board
+    GrblInstruction relatedInstruction = m_boardCharBuffer.isEmpty() ? GrblInstruction() : m_boardCharBuffer.first();
+
+    switch(response.type){
+    case GrblResponse::response_ok:
+        completeFirstInstruction();     //Instruction processed, not in char buffer any more
+
+        if(m_isJogIncrementPending && relatedInstruction == m_jogIncrement){
+            onJogIncrementAnswered(true);
+        }
+
+        //If received "ok" for a parameter fetch instruction, swap the parameter maps to make the new one available
+        if(relatedInstruction.isParameterFetch()){
+            m_parametersMapComplete.swap(m_parametersMapBeingFilled);
+            m_parametersMapBeingFilled.clear();
+
+            GrblBoardEvent event;
+            event.type = GrblBoardEvent::event_parameters;
+            event.parameters = m_parametersMapComplete;
+            postEvent(event);
+
+            negotiateReportMask();
+        }
+
+        postEvent(GrblBoardEvent::event_ok,relatedInstruction);
+        break;
+
+    case GrblResponse::response_error:{
+        completeFirstInstruction();     //Instruction processed, not in char buffer any more
+        if(m_isJogIncrementPending && relatedInstruction == m_jogIncrement){
+            onJogIncrementAnswered(false);
+        }
+        QString line = response.toString();
+        addErrorTranslation(&line);
+        postEvent(GrblBoardEvent::event_error,relatedInstruction,line);
+        break;
+    }
+
+    case GrblResponse::response_alarm:
+        postEvent(GrblBoardEvent::event_alarm,relatedInstruction,response.toString());
+        break;
+
+    case GrblResponse::response_status:{
+        bool isBoardReportingInches = m_parametersMapComplete.value(GRBL_PARAM_REPORT_INCHES).getValue().toBool();
+
+        m_status = GrblStatus(response.data,response.length,isBoardReportingInches,&m_status);
+        learnBufferSizesFromStatus();
+        m_status.deduceMotionsPlanned(m_plannerBlockCount);
+        onStatusReceived();
+        updateFeedGovernor();
+
+        GrblBoardEvent event;
+        event.type = GrblBoardEvent::event_status;
+        event.status = m_status;
+        postEvent(event);
+        break;
+    }
+
+    case GrblResponse::response_feedback:{
+        QString line = response.toString();
+        if(line.startsWith(QLatin1String(FEEDBACK_OPTIONS))){
+            learnBufferSizesFromOptions(line);
+        }
+        postEvent(GrblBoardEvent::event_feedback,relatedInstruction,line);
+        break;
+    }
+
+    case GrblResponse::response_startup:{
+        m_boardCharBuffer.clear();      //Board char buffer emptied by reset
+        m_backgroundQueue.clear();
+        m_isJogging = false;
+        m_isJogIncrementPending = false;
+        m_jogKeepAliveTimer->stop();
+        rejectOperatorInstructions(tr("Board reset"));
+        discardQueuedInstructions();
+        m_feedGovernor.clear();         //Overrides are back to 100%
+        m_feedGovernorReduction.storeRelease(0);
+        updateRealtimeCommands(true);
+
+        //Report format and fields depend on version
+        static const QRegularExpression versionExpression = QRegularExpression("(?<major>\\d+)\\.(?<minor>\\d+)");
+        QString line = response.toString();
+        QRegularExpressionMatch versionMatch = versionExpression.match(line);
+        m_isVersion11OrLater = versionMatch.hasMatch() && (versionMatch.captured("major").toInt() * 100 + versionMatch.captured("minor").toInt() >= 101);
+        m_isReportMaskNegotiated = false;
+
+        //Request status and start status timer
+        m_isStatusRequestPending = false;
+        setStatusRequestInterval(m_idleStatusInterval);
+        requestStatus();
+        m_statusTimer->start();
+
+        //Build startup instructions
+        for(int i = 0 ; i < m_startupInstructionList.size() ; i++){
+            m_startupInstructionList[i].regenerate();
+        }
+
+        GrblBoardEvent event;
+        event.type = GrblBoardEvent::event_startup;
+        event.message = line;
+        event.instructions = m_startupInstructionList;
+        event.isVersion11OrLater = m_isVersion11OrLater;
+        postEvent(event);
+
+        //Give the board some time to send us messages, then send startup instructions
+        QTimer::singleShot(STARTUP_INSTRUCTIONS_DELAY_MS,this,&GrblSerialWorker::sendStartupInstructions);
+        break;
+    }
+
+    case GrblResponse::response_parameter:{
+        QString line = response.toString();
+        if(GrblConfiguration::isAValidParameter(line)){
+            GrblConfiguration param = GrblConfiguration::fromString(line);
+            m_parametersMapBeingFilled.insert(param.getKey(),param);
+        }
+        postEvent(GrblBoardEvent::event_text,relatedInstruction,line);
+        break;
+    }
+
+    case GrblResponse::response_text:
+        postEvent(GrblBoardEvent::event_text,relatedInstruction,response.toString());
+        break;
+
+    case GrblResponse::response_empty:
+        break;
+    }
+}
+
+bool GrblSerialWorker::admitInstruction(const GrblInstruction &instruction, int priorityClass, qint64 queuedTime){
+    //If serial link not opened, or a blocking instruction is in buffer, reject instruction
+    if(!m_link->isOpen() || m_boardCharBuffer.containsBlockingInstruction()){
+        return false;
+    }
+
+    //Lower classes leave room for operator instructions, unless they would never fit
+    int reserve = 0;
+    if(priorityClass != GrblPriorityMetrics::class_operator && !m_boardCharBuffer.isEmpty()){
+        reserve = m_boardCharBuffer.getCapacity() / STREAM_RX_RESERVE_DIVIDER;
+    }
+
+    //if instruction would not fit in board rx buffer, reject it
+    if(!m_boardCharBuffer.canAppend(instruction.getLength() + reserve)){
+        return false;
+    }
+
+    qint64 now = getTime();
+    {
+        QMutexLocker locker(&m_metricsMutex);
+        GrblPriorityMetrics &metrics = m_priorityMetrics[priorityClass];
+        qint64 queueWait = now - queuedTime;
+        metrics.admittedCount++;
+        metrics.totalQueueWait += queueWait;
+        metrics.maxQueueWait = qMax(metrics.maxQueueWait, queueWait);
+        m_queueWaitHistogram.record(queueWait);
+    }
+
+    //Board has something to do : do not wait for the idle interval to see it move
+    setStatusRequestInterval(MOTION_STATUS_REQUEST_INTERVAL);
+
+    //Keep track of its place in rx buffer of the board, bytes are written with the other admitted instructions
+    instruction.appendBytesTo(&m_outputBuffer);
+    m_boardCharBuffer.append(instruction,priorityClass,now);
+    postEvent(GrblBoardEvent::event_sent,instruction);
+    return true;
+}
+
+bool GrblSerialWorker::admitFirst(QQueue<ScheduledInstruction> *queue, int priorityClass){
+    if(queue->isEmpty() || !admitInstruction(queue->head().instruction,priorityClass,queue->head().queuedTime)){
+        return false;
+    }
+    queue->dequeue();
+    return true;
+}
+
+void GrblSerialWorker::completeFirstInstruction(){
+    if(m_boardCharBuffer.isEmpty()){
+        return;
+    }
+
+    qint64 responseTime = getTime() - m_boardCharBuffer.getFirstSentTime();
+    {
+        QMutexLocker locker(&m_metricsMutex);
+        GrblPriorityMetrics &metrics = m_priorityMetrics[m_boardCharBuffer.getFirstPriorityClass()];
+        metrics.respondedCount++;
+        metrics.totalResponseTime += responseTime;
+        metrics.maxResponseTime = qMax(metrics.maxResponseTime, responseTime);
+        m_responseTimeHistogram.record(responseTime);
+    }
+
+    m_boardCharBuffer.takeFirst();
+}
+
+void GrblSerialWorker::sendQueuedInstructions(){
+    //Each queue keeps its order : its first instruction waits until it fits
+    //A class is only served once higher classes have nothing left waiting
+    while(admitFirst(&m_operatorQueue,GrblPriorityMetrics::class_operator));
+    if(m_operatorQueue.isEmpty()){
+        while(admitFirst(&m_queuedInstructions,GrblPriorityMetrics::class_stream));
+        if(m_queuedInstructions.isEmpty()){
+            while(admitFirst(&m_backgroundQueue,GrblPriorityMetrics::class_background));
+        }
+    }
+
+    flushOutput();
+}
+
+void GrblSerialWorker::queueOperatorInstruction(const GrblInstruction &instruction){
+    //Bounded : operator is told right away rather than waiting behind a stuck board
+    if(!m_link->isOpen()){
+        countRejected(GrblPriorityMetrics::class_operator);
+        postEvent(GrblBoardEvent::event_rejected,instruction,tr("Serial link closed"));
+    }
+    else if(m_operatorQueue.size() >= OPERATOR_QUEUE_CAPACITY){
+        countRejected(GrblPriorityMetrics::class_operator);
+        postEvent(GrblBoardEvent::event_rejected,instruction,tr("Too many instructions waiting for the board"));
+    }
+    else{
+        m_operatorQueue.enqueue({instruction, getTime()});
+    }
+}
+
+void GrblSerialWorker::rejectOperatorInstructions(const QString &reason){
+    while(!m_operatorQueue.isEmpty()){
+        countRejected(GrblPriorityMetrics::class_operator);
+        postEvent(GrblBoardEvent::event_rejected,m_operatorQueue.dequeue().instruction,reason);
+    }
+}
+
+void GrblSerialWorker::countRejected(int priorityClass){
+    QMutexLocker locker(&m_metricsMutex);
+    m_priorityMetrics[priorityClass].rejectedCount++;
+}
+
+GrblPriorityMetrics GrblSerialWorker::getPriorityMetrics(int priorityClass) const{
+    QMutexLocker locker(&m_metricsMutex);
+    return m_priorityMetrics[priorityClass];
+}
+
+void GrblSerialWorker::sampleQueueDepths(){
+    qint64 now = getTime();
+    if(!m_depthHistory.isEmpty() && now - m_lastDepthSampleTime < DEPTH_SAMPLE_INTERVAL_US){
+        return;
+    }
+    m_lastDepthSampleTime = now;
+
+    GrblQueueDepthSample sample;
+    sample.time = now;
+    sample.operatorQueued = m_operatorQueue.size();
+    sample.streamQueued = m_queuedInstructions.size();
+    sample.charBufferInstructions = m_boardCharBuffer.getInstructionCount();
+    sample.charBufferBytes = m_boardCharBuffer.getUsedSize();
+    sample.plannerBlocks = m_status.containsMotionsPlanned() ? m_status.getMotionsPlanned() : -1;
+
+    //Oldest sample is overwritten once history is full
+    QMutexLocker locker(&m_metricsMutex);
+    if(m_depthHistory.size() < DEPTH_HISTORY_CAPACITY){
+        m_depthHistory.append(sample);
+    }
+    else{
+        m_depthHistory[m_depthHistoryHead] = sample;
+        m_depthHistoryHead = (m_depthHistoryHead + 1) % DEPTH_HISTORY_CAPACITY;
+    }
+}
+
+void GrblSerialWorker::clearDiagnostics(){
+    QMutexLocker locker(&m_metricsMutex);
+    m_queueWaitHistogram.clear();
+    m_responseTimeHistogram.clear();
+    for(int command = 0 ; command < GrblDiagnostics::realtime_command_count ; command++){
+        m_realtimeLatencyHistograms[command].clear();
+        m_realtimeTimeoutCounts[command] = 0;
+    }
+    m_depthHistory.clear();
+    m_depthHistoryHead = 0;
+}
+
+GrblDiagnostics GrblSerialWorker::getDiagnostics() const{
+    GrblDiagnostics diagnostics;
+    QMutexLocker locker(&m_metricsMutex);
+    diagnostics.queueWait = m_queueWaitHistogram;
+    diagnostics.responseTime = m_responseTimeHistogram;
+    for(int command = 0 ; command < GrblDiagnostics::realtime_command_count ; command++){
+        diagnostics.realtimeLatency[command] = m_realtimeLatencyHistograms[command];
+        diagnostics.realtimeTimeoutCount[command] = m_realtimeTimeoutCounts[command];
+    }
+
+    //Oldest first
+    diagnostics.depthHistory.reserve(m_depthHistory.size());
+    for(int i = 0 ; i < m_depthHistory.size() ; i++){
+        diagnostics.depthHistory.append(m_depthHistory.at((m_depthHistoryHead + i) % m_depthHistory.size()));
+    }
+    return diagnostics;
+}
+
+void GrblSerialWorker::flushOutput(){
+    //All instructions admitted since last write go in a single one
+    if(!m_outputBuffer.isEmpty()){
+        qint64 writtenSize = writeToPort(m_outputBuffer);
+        if(writtenSize > 0){
+            m_outputBuffer.remove(0,int(writtenSize));
+        }
+        //Bytes the port did not take are written again once it reports progress
+    }
+
+    m_queuedInstructionCount.storeRelease(m_queuedInstructions.size());
+}
+
+void GrblSerialWorker::onSerialBytesWritten(qint64 bytes){
+    m_pendingWriteSize.fetchAndAddOrdered(-int(bytes));
+    flushOutput();
+}
+
+void GrblSerialWorker::discardQueuedInstructions(){
+    if(!m_queuedInstructions.isEmpty()){
+        QMutexLocker locker(&m_metricsMutex);
+        m_priorityMetrics[GrblPriorityMetrics::class_stream].discardedCount += m_queuedInstructions.size();
+    }
+
+    //Sender is told about each of them, so that it knows where to resume
+    while(!m_queuedInstructions.isEmpty()){
+        postEvent(GrblBoardEvent::event_discarded,m_queuedInstructions.dequeue().instruction);
+    }
+    m_queuedInstructionCount.storeRelease(0);
+}
+
+void GrblSerialWorker::sendStartupInstructions(void){
+    //Most of them are blocking : queue them so each one waits for the previous to be answered
+    qint64 now = getTime();
+    foreach(GrblInstruction instruction,m_startupInstructionList){
+        m_backgroundQueue.enqueue({instruction, now});
+    }
+    sendQueuedInstructions();
+}
+
+void GrblSerialWorker::negotiateReportMask(){
+    //Only ask for the fields used, once per connection : the setting is stored in board EEPROM
+    if(m_isReportMaskNegotiated || !m_parametersMapComplete.contains(GRBL_PARAM_STATUS_MASK)){
+        return;
+    }
+    m_isReportMaskNegotiated = true;
+
+    int wantedMask = m_isVersion11OrLater ? STATUS_MASK_GRBL_1_1 : STATUS_MASK_GRBL_0_9;
+    if(m_parametersMapComplete.value(GRBL_PARAM_STATUS_MASK).getValue().toInt() == wantedMask){
+        return;
+    }
+
+    //Parameters are fetched again so that the map shows the new mask
+    qint64 now = getTime();
+    m_backgroundQueue.enqueue({GrblInstruction(QString("$%1=%2").arg(GRBL_PARAM_STATUS_MASK).arg(wantedMask)), now});
+    m_backgroundQueue.enqueue({GrblInstruction(QStringLiteral(INST_GET_PARAMS)), now});
+}
+
+void GrblSerialWorker::writeOverrideCommand(int change, const char *reset, const char *coarsePlus, const char *coarseMinus,
+                                            const char *finePlus, const char *fineMinus){
+    //Board only knows steps : a change is sent as tens then units, all in a single write
+    QByteArray command;
+    if(change == 0){
+        command.append(reset);
+    }
+    for(int i = 0 ; i < qAbs(change) / OVR_COARSE_STEP ; i++){
+        command.append(change > 0 ? coarsePlus : coarseMinus);
+    }
+    for(int i = 0 ; i < qAbs(change) % OVR_COARSE_STEP ; i++){
+        command.append(change > 0 ? finePlus : fineMinus);
+    }
+    writeRealtimeCommand(command);
+}
+
+void GrblSerialWorker::updateFeedGovernor(){
+    //Overrides are a Grbl 1.1 feature
+    if(!m_isVersion11OrLater){
+        return;
+    }
+
+    int change = m_feedGovernor.update(m_status,m_plannerBlockCount,!m_queuedInstructions.isEmpty());
+    if(change != 0){
+        writeOverrideCommand(change,CMD_FEED_OVR_RESET,CMD_FEED_OVR_COARSE_PLUS,CMD_FEED_OVR_COARSE_MINUS,
+                             CMD_FEED_OVR_FINE_PLUS,CMD_FEED_OVR_FINE_MINUS);
+        m_feedGovernorReduction.storeRelease(m_feedGovernor.getReduction());
+    }
+}
+
+void GrblSerialWorker::startJog(const QVector3D &direction, int feedRate){
+    //Jog motions are a Grbl 1.1 feature
+    if(!m_isVersion11OrLater || direction.isNull() || feedRate <= 0){
+        return;
+    }
+
+    //Feed rate applies along the path, whatever the axes involved
+    m_jogDirection = direction.normalized();
+    m_jogFeedRate = feedRate;
+    m_isJogging = true;
+    m_jogKeepAliveTimer->start();
+    sendJogIncrement();
+}
+
+void GrblSerialWorker::keepJogAlive(){
+    if(m_isJogging){
+        m_jogKeepAliveTimer->start();
+    }
+}
+
+void GrblSerialWorker::onJogKeepAliveLapsed(){
+    //Release was lost, or GUI thread froze while the operator held the jog : the motion must not run on
+    stopJog();
+}
+
+void GrblSerialWorker::stopJog(){
+    if(!m_isJogging){
+        return;
+    }
+    m_isJogging = false;
+    m_jogKeepAliveTimer->stop();
+
+    //Increment not admitted yet is dropped, board drops the planned ones on cancel
+    if(m_isJogIncrementPending){
+        for(int i = 0 ; i < m_operatorQueue.size() ; i++){
+            if(m_operatorQueue.at(i).instruction == m_jogIncrement){
+                m_operatorQueue.removeAt(i);
+                m_isJogIncrementPending = false;
+                break;
+            }
+        }
+    }
+
+    writeRealtimeCommand(QByteArrayLiteral(CMD_JOG_CANCEL));
+}
+
+void GrblSerialWorker::sendJogIncrement(){
+    if(!m_isJogging || m_isJogIncrementPending){
+        return;
+    }
+
+    //Each increment lasts longer than a round trip to the board, so planner keeps ahead of the motion
+    int incrementTime = qMax(JOG_MIN_INCREMENT_MS, 2 * m_averageStatusLatency.loadAcquire() / 1000);
+    QVector3D increment = m_jogDirection * float(m_jogFeedRate * incrementTime / 60000.0);
+
+    QString line(QStringLiteral(INST_JOG_PREFIX "G91G21"));
+    if(increment.x() != 0.0f) line.append(QString("X%1").arg(double(increment.x()),0,'f',3));
+    if(increment.y() != 0.0f) line.append(QString("Y%1").arg(double(increment.y()),0,'f',3));
+    if(increment.z() != 0.0f) line.append(QString("Z%1").arg(double(increment.z()),0,'f',3));
+    line.append(QString("F%1").arg(m_jogFeedRate));
+
+    m_jogIncrement = GrblInstruction(line);
+    m_isJogIncrementPending = true;
+    m_operatorQueue.enqueue({m_jogIncrement, getTime()});
+}
+
+void GrblSerialWorker::onJogIncrementAnswered(bool isAccepted){
+    m_isJogIncrementPending = false;
+
+    //Refused increment, soft limits for instance : going on would only be refused too
+    if(!isAccepted){
+        m_isJogging = false;
+        m_jogKeepAliveTimer->stop();
+        return;
+    }
+    sendJogIncrement();
+}
+
+void GrblSerialWorker::loadBoardProfile(){
+    QSettings settings("settings.ini",QSettings::IniFormat);
+    settings.beginGroup(BOARD_PROFILES_GROUP);
+    settings.beginGroup(QString(m_serialPort->portName()).replace('/','_'));
+    int rxBufferSize = settings.value("RxBufferSize",BOARD_RX_BUFFER_SIZE).toInt();
+    int plannerBlockCount = settings.value("PlannerBlockCount",BOARD_PLANNER_BLOCKS).toInt();
+    settings.endGroup();
+    settings.endGroup();
+
+    m_boardCharBuffer.setCapacity(rxBufferSize);
+    m_plannerBlockCount = plannerBlockCount;
+
+    GrblBoardEvent event;
+    event.type = GrblBoardEvent::event_buffer_sizes;
+    event.rxBufferSize = rxBufferSize;
+    event.plannerBlockCount = plannerBlockCount;
+    postEvent(event);
+}
+
+void GrblSerialWorker::updateBufferSizes(int rxBufferSize, int plannerBlockCount){
+    if(rxBufferSize <= 0 || plannerBlockCount <= 0){
+        return;
+    }
+    if(rxBufferSize == m_boardCharBuffer.getCapacity() && plannerBlockCount == m_plannerBlockCount){
+        return;
+    }
+
+    m_boardCharBuffer.setCapacity(rxBufferSize);
+    m_plannerBlockCount = plannerBlockCount;
+
+    //Remember them for the next connection on this port
+    QSettings settings("settings.ini",QSettings::IniFormat);
+    settings.beginGroup(BOARD_PROFILES_GROUP);
+    settings.beginGroup(QString(m_serialPort->portName()).replace('/','_'));
+    settings.setValue("RxBufferSize",rxBufferSize);
+    settings.setValue("PlannerBlockCount",plannerBlockCount);
+    settings.endGroup();
+    settings.endGroup();
+
+    GrblBoardEvent event;
+    event.type = GrblBoardEvent::event_buffer_sizes;
+    event.rxBufferSize = rxBufferSize;
+    event.plannerBlockCount = plannerBlockCount;
+    postEvent(event);
+}
+
+void GrblSerialWorker::learnBufferSizesFromStatus(){
+    //Free room only tells the size when nothing we sent is still in the board
+    if(!m_status.containsBufferState() || !m_boardCharBuffer.isEmpty()){
+        return;
+    }
+
+    //Planner may still hold motions while running, it is empty once idle
+    int plannerBlockCount = m_plannerBlockCount;
+    if(m_status.getState() == GrblStatus::state_idle){
+        plannerBlockCount = m_status.getPlannerBlocksAvailable();
+    }
+
+    updateBufferSizes(m_status.getRxBytesAvailable(),plannerBlockCount);
+}
+
+void GrblSerialWorker::learnBufferSizesFromOptions(const QString &optionsLine){
+    //[OPT:<flags>,<planner blocks>,<rx buffer size>] , all of it usable : Grbl 1.1 ring has one byte more,
+    //and Bf: reports the same size while idle
+    QStringList fields = QString(optionsLine).remove(FEEDBACK_OPTIONS).remove(']').split(',');
+    if(fields.size() < 3){
+        return;
+    }
+
+    bool isPlannerValid, isRxValid;
+    int plannerBlockCount = fields.at(1).toInt(&isPlannerValid);
+    int rxBufferSize = fields.at(2).toInt(&isRxValid);
+    if(isPlannerValid && isRxValid){
+        updateBufferSizes(rxBufferSize,plannerBlockCount);
+    }
+}
+
+void GrblSerialWorker::postEvent(GrblBoardEvent::Type type, const GrblInstruction &instruction, const QString &message){
+    GrblBoardEvent event;
+    event.type = type;
+    event.instruction = instruction;
+    event.message = message;
+    postEvent(event);
+}
+
+void GrblSerialWorker::postEvent(GrblBoardEvent &event){
+    event.postedTime = getTime();
+
+    //Events are never lost, nor reordered : once one is waiting, following ones wait too
+    if(!m_eventOverflow.isEmpty() || !m_events.push(event)){
+        m_eventOverflow.enqueue(event);
+        if(!m_eventRetryTimer->isActive()){
+            m_eventRetryTimer->start();
+        }
+        return;
+    }
+
+    //Wake the GUI thread only once for a burst of events
+    if(m_isEventWakeupPending.testAndSetOrdered(0,1)){
+        emit eventsAvailable();
+    }
+}
+
+void GrblSerialWorker::flushEventOverflow(){
+    while(!m_eventOverflow.isEmpty() && m_events.push(m_eventOverflow.head())){
+        m_eventOverflow.dequeue();
+    }
+
+    if(!m_eventOverflow.isEmpty()){
+        m_eventRetryTimer->start();
+    }
+    if(m_isEventWakeupPending.testAndSetOrdered(0,1)){
+        emit eventsAvailable();
+    }
+}
+
+
+
+void GrblSerialWorker::addErrorTranslation(QString *errorString){
+    static const QRegularExpression errorIdRegExp = QRegularExpression(GRBL_ERR_REGEXP);
+
+    QRegularExpressionMatch match = errorIdRegExp.match(errorString);
+    if(match.hasMatch()){
+        int id = match.captured("id").toInt();
+        if(errorTranslationMap.contains(id)){
+            errorString->append(" : ");
+            errorString->append(errorTranslationMap.value(id));
+        }
+    }
+}
+
+QMap<int, QString> GrblSerialWorker::generateErrorTranslationMap(){
+    QMap<int,QString> errorTranslationMap;
+    errorTranslationMap.insert(23,GRBL_ERR_23);
+    errorTranslationMap.insert(24,GRBL_ERR_24);
+    errorTranslationMap.insert(25,GRBL_ERR_25);
+    errorTranslationMap.insert(26,GRBL_ERR_26);
+    errorTranslationMap.insert(27,GRBL_ERR_27);
+    errorTranslationMap.insert(28,GRBL_ERR_28);
+    errorTranslationMap.insert(29,GRBL_ERR_29);
+    errorTranslationMap.insert(30,GRBL_ERR_30);
+    errorTranslationMap.insert(31,GRBL_ERR_31);
+    errorTranslationMap.insert(32,GRBL_ERR_32);
+    errorTranslationMap.insert(33,GRBL_ERR_33);
+    errorTranslationMap.insert(34,GRBL_ERR_34);
+    errorTranslationMap.insert(35,GRBL_ERR_35);
+    errorTranslationMap.insert(36,GRBL_ERR_36);
+    errorTranslationMap.insert(37,GRBL_ERR_37);
+
+    return errorTranslationMap;
+}
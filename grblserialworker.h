@@ -0,0 +1,239 @@
+#ifndef GRBLSERIALWORKER_H
+#define GRBLSERIALWORKER_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QTimer>
+#include <QQueue>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVector3D>
+
+#include "grblstatus.h"
+#include "grblconfiguration.h"
+#include "grblinstruction.h"
+#include "spscqueue.h"
+#include "grblresponsereader.h"
+#include "grblcharbuffer.h"
+#include "grblprioritymetrics.h"
+#include "grblfeedgovernor.h"
+#include "grblemulator.h"
+#include "grbldiagnostics.h"
+
+#define COMMAND_QUEUE_CAPACITY  1024
+#define REALTIME_QUEUE_CAPACITY 64      //Realtime commands have their own queue, never filled by a burst of queued lines
+#define EVENT_QUEUE_CAPACITY    4096
+#define OPERATOR_QUEUE_CAPACITY 32      //Operator instructions waiting for the board, more are rejected
+#define DEPTH_HISTORY_CAPACITY  3000    //Queue depth samples kept, five minutes at the sampling interval
+
+//Request from the GUI thread to the serial thread
+struct GrblBoardCommand{
+    enum Type{command_toggle_serial, command_serial_settings, command_status_interval, command_realtime,
+              command_send, command_queue, command_flush, command_feed_override, command_spindle_override,
+              command_feed_governor, command_jog_start, command_jog_keep_alive, command_jog_stop,
+              command_clear_diagnostics};
+
+    Type type;
+    GrblInstruction instruction;
+    QByteArray bytes;           //Realtime command
+    QString portName;
+    qint32 value;               //Baud rate, idle status request interval, override change in percents, governor enabled or jog feed rate
+    QVector3D vector;           //Jog direction
+    qint64 requestTime = 0;     //Realtime command, serial worker clock in microseconds
+};
+
+//Something that happened on the serial thread, for the GUI thread
+struct GrblBoardEvent{
+    enum Type{event_status, event_startup, event_ok, event_error, event_alarm, event_feedback, event_text,
+              event_parameters, event_sent, event_discarded, event_rejected, event_buffer_sizes};
+
+    Type type;
+    GrblInstruction instruction;
+    QString message;
+    GrblStatus status;
+    QList<GrblInstruction> instructions;        //Startup instructions
+    QMap<int,GrblConfiguration> parameters;
+    int rxBufferSize = 0;                       //Buffer sizes learned from the board
+    int plannerBlockCount = 0;
+    bool isVersion11OrLater = false;            //Startup, board has overrides and jog motions
+    qint64 postedTime = 0;                      //Serial worker clock, in microseconds
+};
+
+//Owns the serial link to the board and runs the character counting protocol, in its own thread
+//Queued instructions are sent as soon as the board acknowledges previous ones, whatever the GUI thread is doing
+//The link is any QIODevice : a serial port, or the in-process emulator
+class GrblSerialWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GrblSerialWorker(QObject *parent = nullptr);
+
+    //GUI thread only : false if command queue is full
+    bool postCommand(const GrblBoardCommand &command);
+    //GUI thread only : realtime bytes, overrides and jog stop, handled before any other command
+    bool postRealtimeCommand(const GrblBoardCommand &command);
+
+    //GUI thread only : call acknowledgeEvents before taking the events signaled by eventsAvailable
+    void acknowledgeEvents() {m_isEventWakeupPending.storeRelease(0);}
+    bool takeEvent(GrblBoardEvent *event) {return m_events.pop(event);}
+
+    //Thread safe : instructions queued and not admitted in board char buffer yet
+    int getQueuedInstructionCount() const {return m_queuedInstructionCount.loadAcquire();}
+    //Thread safe : bytes handed to the serial port and not written to the link yet
+    int getPendingWriteSize() const {return m_pendingWriteSize.loadAcquire();}
+    //Thread safe : time from status request to status report, last one and smoothed, in microseconds
+    int getLastStatusLatency() const {return m_lastStatusLatency.loadAcquire();}
+    int getAverageStatusLatency() const {return m_averageStatusLatency.loadAcquire();}
+    //Thread safe : current status request interval, in milliseconds
+    int getStatusRequestInterval() const {return m_statusRequestInterval.loadAcquire();}
+    //Thread safe : how each priority class has been served so far
+    GrblPriorityMetrics getPriorityMetrics(int priorityClass) const;
+    //Thread safe : latency histograms and queue depths over time
+    GrblDiagnostics getDiagnostics() const;
+    //Thread safe : monotonic clock events and diagnostics are timed with, in microseconds
+    qint64 getTime() const {return m_clock.nsecsElapsed() / 1000;}
+    //Thread safe : percents of feed override currently taken away by the feed governor
+    int getFeedGovernorReduction() const {return m_feedGovernorReduction.loadAcquire();}
+    //Thread safe : emulated board only, milliseconds of planner starvation and bytes lost by rx buffer overflow
+    int getEmulatorStarvedTime() const {return m_emulatorStarvedTime.loadAcquire();}
+    int getEmulatorRxOverflowCount() const {return m_emulatorRxOverflowCount.loadAcquire();}
+
+signals:
+    //Emitted once until events are acknowledged
+    void eventsAvailable();
+    void commandsAvailable();
+
+private slots:
+    void processCommands();
+    void onSerialDataAvailable();
+    void onSerialBytesWritten(qint64 bytes);
+    void requestStatus();
+    void sendStartupInstructions();
+    void flushEventOverflow();
+    void onJogKeepAliveLapsed();
+
+private:
+    void processCommand(GrblBoardCommand &command);
+    void toggleSerial();
+    void configureEmulator();
+    void processResponse(const GrblResponse &response);
+    void writeRealtimeCommand(const QByteArray &command);
+    //Real time command waiting for the board to show its effect
+    struct PendingRealtimeCommand{
+        int command;                //One of GrblDiagnostics::RealtimeCommands
+        qint64 requestTime;
+    };
+
+    //Instruction waiting for room in board char buffer, with the time it was requested at
+    struct ScheduledInstruction{
+        GrblInstruction instruction;
+        qint64 queuedTime;
+    };
+
+    bool admitInstruction(const GrblInstruction &instruction, int priorityClass, qint64 queuedTime);
+    bool admitFirst(QQueue<ScheduledInstruction> *queue, int priorityClass);
+    void completeFirstInstruction();
+    void sendQueuedInstructions();
+    void queueOperatorInstruction(const GrblInstruction &instruction);
+    void rejectOperatorInstructions(const QString &reason);
+    void countRejected(int priorityClass);
+    void flushOutput();
+    qint64 writeToPort(const QByteArray &bytes);
+    void discardQueuedInstructions();
+    void loadBoardProfile();
+    void updateBufferSizes(int rxBufferSize, int plannerBlockCount);
+    void learnBufferSizesFromStatus();
+    void learnBufferSizesFromOptions(const QString &optionsLine);
+    void onStatusReceived();
+    void setStatusRequestInterval(int interval);
+    void negotiateReportMask();
+    void writeOverrideCommand(int change, const char *reset, const char *coarsePlus, const char *coarseMinus,
+                              const char *finePlus, const char *fineMinus);
+    void updateFeedGovernor();
+    void startJog(const QVector3D &direction, int feedRate);
+    void stopJog();
+    void keepJogAlive();
+    void sendJogIncrement();
+    void onJogIncrementAnswered(bool isAccepted);
+    void sampleQueueDepths();
+    void clearDiagnostics();
+    void trackRealtimeCommand(const QByteArray &command, qint64 requestTime);
+    void updateRealtimeCommands(bool isStartup);
+
+    //Event is stamped with the time it is posted at
+    void postEvent(GrblBoardEvent &event);
+    void postEvent(GrblBoardEvent::Type type, const GrblInstruction &instruction, const QString &message = QString());
+
+    static void addErrorTranslation(QString* errorString);
+
+    SpscQueue<GrblBoardCommand,COMMAND_QUEUE_CAPACITY> m_commands;
+    SpscQueue<GrblBoardCommand,REALTIME_QUEUE_CAPACITY> m_realtimeCommands;
+    SpscQueue<GrblBoardEvent,EVENT_QUEUE_CAPACITY> m_events;
+    QAtomicInt m_isCommandWakeupPending;
+    QAtomicInt m_isEventWakeupPending;
+    QQueue<GrblBoardEvent> m_eventOverflow;     //Events waiting for room in the event queue
+    QTimer* m_eventRetryTimer;
+
+    //Waiting for room in board char buffer, served by priority class
+    QQueue<ScheduledInstruction> m_operatorQueue;       //Manual commands
+    QQueue<ScheduledInstruction> m_queuedInstructions;  //Stream, flushed by the sender
+    QQueue<ScheduledInstruction> m_backgroundQueue;     //Startup and maintenance instructions
+    QAtomicInt m_queuedInstructionCount;
+    QByteArray m_outputBuffer;          //Instructions admitted in board char buffer, not handed to the port yet
+    QAtomicInt m_pendingWriteSize;
+    GrblCharBuffer m_boardCharBuffer;
+    int m_plannerBlockCount;
+    GrblResponseReader m_responseReader;
+    QSerialPort *m_serialPort;
+    GrblEmulator *m_emulator;
+    QIODevice *m_link;                  //Serial port, or emulator when its name is chosen as port
+    QTimer* m_statusTimer;
+    GrblStatus m_status;
+
+    //Status polling : fast while moving, backing off to idle interval once stopped
+    int m_idleStatusInterval;
+    QAtomicInt m_statusRequestInterval;
+    bool m_isStatusRequestPending;          //A single request in flight, so that latency is measured and link not flooded
+    QElapsedTimer m_statusRequestTimer;
+    QAtomicInt m_lastStatusLatency;
+    QAtomicInt m_averageStatusLatency;
+    QAtomicInt m_emulatorStarvedTime;
+    QAtomicInt m_emulatorRxOverflowCount;
+
+    bool m_isVersion11OrLater;
+    bool m_isReportMaskNegotiated;
+
+    GrblFeedGovernor m_feedGovernor;
+    QAtomicInt m_feedGovernorReduction;
+
+    //Continuous jog : a single increment waits in board rx buffer, so that cancel stops within one increment
+    bool m_isJogging;
+    QVector3D m_jogDirection;
+    int m_jogFeedRate;
+    bool m_isJogIncrementPending;
+    GrblInstruction m_jogIncrement;
+    QTimer* m_jogKeepAliveTimer;        //GUI keeps the jog alive while held, cancelled if it stops doing so
+
+    QElapsedTimer m_clock;
+    GrblPriorityMetrics m_priorityMetrics[GrblPriorityMetrics::class_count];
+    GrblLatencyHistogram m_queueWaitHistogram;
+    GrblLatencyHistogram m_responseTimeHistogram;
+    QVector<GrblQueueDepthSample> m_depthHistory;      //Ring, oldest sample at head once full
+    int m_depthHistoryHead;
+    qint64 m_lastDepthSampleTime;
+    QList<PendingRealtimeCommand> m_pendingRealtimeCommands;   //Status requested in a burst while not empty
+    GrblLatencyHistogram m_realtimeLatencyHistograms[GrblDiagnostics::realtime_command_count];
+    int m_realtimeTimeoutCounts[GrblDiagnostics::realtime_command_count];
+    mutable QMutex m_metricsMutex;                      //Priority metrics, histograms, timeouts and depth history
+
+    QMap<int,GrblConfiguration> m_parametersMapComplete;
+    QMap<int,GrblConfiguration> m_parametersMapBeingFilled;
+
+    QList<GrblInstruction> m_startupInstructionList;
+
+    static const QMap<int,QString> errorTranslationMap;
+    static QMap<int,QString> generateErrorTranslationMap();
+};
+
+#endif // GRBLSERIALWORKER_H
@@ -2,85 +2,72 @@
 #include "grblstatus.h"
 
 #include <QString>
-#include <QStringList>
-#include <QMap>
+#include <QByteArray>
 
+#include <cstring>
 
-const QRegularExpression GrblStatus::s_mposExpression = QRegularExpression(STATUS_MACHINE_POS"(?<xvalue>-?[\\d]+.[\\d]+),(?<yvalue>-?[\\d]+.[\\d]+),(?<zvalue>-?[\\d]+.[\\d]+)");
-const QRegularExpression GrblStatus::s_wposExpression = QRegularExpression(STATUS_WORK_POS"(?<xvalue>-?[\\d]+.[\\d]+),(?<yvalue>-?[\\d]+.[\\d]+),(?<zvalue>-?[\\d]+.[\\d]+)");
-const QRegularExpression GrblStatus::s_motionsExpression = QRegularExpression(STATUS_MOTION_NUM"(?<count>[\\d]+)");
-const QRegularExpression GrblStatus::s_charactersExpression = QRegularExpression(STATUS_CHARACTER_NUM"(?<count>[\\d]+)");
+#define LITERAL_LENGTH(literal)     (int(sizeof(literal)) - 1)
+#define IS_NAME(name, length, literal)  ((length) == LITERAL_LENGTH(literal) && memcmp((name), (literal), (length)) == 0)
 
-const QMap<QString, GrblStatus::states> GrblStatus::s_stateDecodingMap = initStateStringMap();
+#define NUMBER_MAX_DECIMALS     9
 
+static inline bool isFieldSeparator(char c){
+    return c == '|' || c == ',';
+}
 
-const QMap<QString, GrblStatus::states> GrblStatus::initStateStringMap(void){
-    QMap<QString, GrblStatus::states> map;
-    map.insert(STATE_IDLE_STRING, GrblStatus::state_idle);
-    map.insert(STATE_RUN_STRING, GrblStatus::state_run);
-    map.insert(STATE_HOLD_STRING, GrblStatus::state_hold);
-    map.insert(STATE_DOOR_STRING, GrblStatus::state_door);
-    map.insert(STATE_HOME_STRING, GrblStatus::state_home);
-    map.insert(STATE_ALARM_STRING, GrblStatus::state_alarm);
-    map.insert(STATE_CHECK_STRING, GrblStatus::state_check);
-    return map;
+static inline bool isNumberStart(char c){
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
 }
 
-GrblStatus::GrblStatus(QString statusLine, bool isUnitInches, GrblStatus *previousStatus):GrblStatus(){
+
+GrblStatus::GrblStatus(const char *statusLine, int length, bool isUnitInches, const GrblStatus *previousStatus):GrblStatus(){
 
     //Check for previous status for previous state
     if(previousStatus != nullptr){
         m_prevState = previousStatus->getState();
     }
 
-    statusLine.remove(RESPONSE_STATUS_START);
-    statusLine.remove(RESPONSE_STATUS_END);
-
     m_isUnitInches = isUnitInches;
 
-    //First ( and mandatory ) info is ALWAYS the state
-    foreach(QString stateString, s_stateDecodingMap.keys()){
-        if(statusLine.startsWith(stateString)){
-            m_currState = s_stateDecodingMap.value(stateString);
-            break;
+    parse(statusLine, statusLine + length);
+
+    //Grbl 1.1 only sends slowly changing fields every few reports
+    if(previousStatus != nullptr){
+        if(!m_hasWorkOffset && previousStatus->m_hasWorkOffset){
+            m_workOffset = previousStatus->m_workOffset;
+            m_hasWorkOffset = true;
+        }
+        if(!m_hasOverrides && previousStatus->m_hasOverrides){
+            m_feedOverride = previousStatus->m_feedOverride;
+            m_rapidOverride = previousStatus->m_rapidOverride;
+            m_spindleOverride = previousStatus->m_spindleOverride;
+            m_hasOverrides = true;
         }
     }
 
-    //Look for machine position
-    QRegularExpressionMatch mposMatch = s_mposExpression.match(statusLine);
-    if(mposMatch.hasMatch()){
-        //Now extract infos
-        m_machinePosition.setX(mposMatch.captured("xvalue").toFloat());
-        m_machinePosition.setY(mposMatch.captured("yvalue").toFloat());
-        m_machinePosition.setZ(mposMatch.captured("zvalue").toFloat());
-        m_hasMachinePosition = true;
+    //Board reports one position, the other one is derived from work offset
+    if(m_hasMachinePosition && m_hasWorkPosition){
+        if(!m_hasWorkOffset){
+            m_workOffset = m_machinePosition - m_workPosition;
+            m_hasWorkOffset = true;
+        }
     }
-
-    //Look for work position
-    QRegularExpressionMatch wposMatch = s_wposExpression.match(statusLine);
-    if(wposMatch.hasMatch()){
-        //Now extract infos
-        m_workPosition.setX(wposMatch.captured("xvalue").toFloat());
-        m_workPosition.setY(wposMatch.captured("yvalue").toFloat());
-        m_workPosition.setZ(wposMatch.captured("zvalue").toFloat());
-        m_hasWorkPosition = true;
+    else if(m_hasWorkOffset){
+        if(m_hasMachinePosition){
+            m_workPosition = m_machinePosition - m_workOffset;
+            m_hasWorkPosition = true;
+        }
+        else if(m_hasWorkPosition){
+            m_machinePosition = m_workPosition + m_workOffset;
+            m_hasMachinePosition = true;
+        }
     }
+}
 
-    //Look for planned motions count
-    QRegularExpressionMatch motionsMatch = s_motionsExpression.match(statusLine);
-    if(motionsMatch.hasMatch()){
-        //Now extract infos
-        m_motionsPlanned = motionsMatch.captured("count").toInt();
-        m_hasMotionsPlanned = true;
-    }
+GrblStatus::GrblStatus(const QString &statusLine, bool isUnitInches, const GrblStatus *previousStatus):
+    GrblStatus(statusLine.toLatin1().constData(), statusLine.length(), isUnitInches, previousStatus)
+{
 
-    //Look for characters in RX buffer count
-    QRegularExpressionMatch charactersMatch = s_charactersExpression.match(statusLine);
-    if(charactersMatch.hasMatch()){
-        //Now extract infos
-        m_charactersQueued = charactersMatch.captured("count").toInt();
-        m_hasCharactersQueued = true;
-    }
 }
 
 
@@ -93,14 +80,191 @@ GrblStatus::GrblStatus(bool isConnected):
     m_machinePosition(),
     m_hasWorkPosition(false),
     m_workPosition(),
+    m_hasWorkOffset(false),
+    m_workOffset(),
     m_hasMotionsPlanned(false),
     m_motionsPlanned(0),
     m_hasCharactersQueued(false),
-    m_charactersQueued(0)
+    m_charactersQueued(0),
+    m_hasBufferState(false),
+    m_plannerBlocksAvailable(0),
+    m_rxBytesAvailable(0),
+    m_hasFeedRate(false),
+    m_feedRate(0),
+    m_hasSpindleSpeed(false),
+    m_spindleSpeed(0),
+    m_hasLineNumber(false),
+    m_lineNumber(0),
+    m_hasOverrides(false),
+    m_feedOverride(100),
+    m_rapidOverride(100),
+    m_spindleOverride(100)
 {
 
 }
 
+void GrblStatus::parse(const char *data, const char *end){
+    //Brackets are optional
+    if(data < end && *data == RESPONSE_STATUS_START[0]){
+        data++;
+    }
+    if(data < end && *(end - 1) == RESPONSE_STATUS_END[0]){
+        end--;
+    }
+
+    //First ( and mandatory ) info is ALWAYS the state, Grbl 1.1 may add a sub state after a colon
+    const char *stateEnd = data;
+    while(stateEnd < end && !isFieldSeparator(*stateEnd) && *stateEnd != ':'){
+        stateEnd++;
+    }
+    m_currState = decodeState(data, int(stateEnd - data));
+
+    data = stateEnd;
+    while(data < end && !isFieldSeparator(*data)){
+        data++;
+    }
+
+    //Then "Name:value,value..." fields, separated by pipes (1.1) or by commas like the values (0.9)
+    while(data < end){
+        data++;     //Field separator
+
+        const char *name = data;
+        while(data < end && *data != ':' && !isFieldSeparator(*data)){
+            data++;
+        }
+        if(data >= end || *data != ':'){
+            continue;       //Not a field we know of
+        }
+        data++;
+        int nameLength = int(data - name);      //Colon included
+
+        //A comma followed by something else than a number starts the next 0.9 field
+        float values[STATUS_MAX_FIELD_VALUES];
+        int valueCount = 0;
+        while(data < end && isNumberStart(*data) && valueCount < STATUS_MAX_FIELD_VALUES){
+            data = parseNumber(data, end, &values[valueCount++]);
+            if(data + 1 < end && *data == ',' && isNumberStart(*(data + 1))){
+                data++;
+            }
+            else{
+                break;
+            }
+        }
+
+        parseField(name, nameLength, values, valueCount);
+
+        //Skip what was not parsed : pin states, accessories, extra axes
+        while(data < end && !isFieldSeparator(*data)){
+            data++;
+        }
+    }
+}
+
+void GrblStatus::parseField(const char *name, int nameLength, const float *values, int valueCount){
+    if(IS_NAME(name, nameLength, STATUS_MACHINE_POS) && valueCount >= 3){
+        m_machinePosition = QVector3D(values[0], values[1], values[2]);
+        m_hasMachinePosition = true;
+    }
+    else if(IS_NAME(name, nameLength, STATUS_WORK_POS) && valueCount >= 3){
+        m_workPosition = QVector3D(values[0], values[1], values[2]);
+        m_hasWorkPosition = true;
+    }
+    else if(IS_NAME(name, nameLength, STATUS_WORK_OFFSET) && valueCount >= 3){
+        m_workOffset = QVector3D(values[0], values[1], values[2]);
+        m_hasWorkOffset = true;
+    }
+    else if(IS_NAME(name, nameLength, STATUS_BUFFER_STATE) && valueCount >= 2){
+        m_plannerBlocksAvailable = int(values[0]);
+        m_rxBytesAvailable = int(values[1]);
+        m_hasBufferState = true;
+    }
+    else if(IS_NAME(name, nameLength, STATUS_FEED_SPEED) && valueCount >= 2){
+        m_feedRate = values[0];
+        m_spindleSpeed = values[1];
+        m_hasFeedRate = true;
+        m_hasSpindleSpeed = true;
+    }
+    else if(IS_NAME(name, nameLength, STATUS_FEED) && valueCount >= 1){
+        m_feedRate = values[0];
+        m_hasFeedRate = true;
+    }
+    else if(IS_NAME(name, nameLength, STATUS_LINE_NUMBER) && valueCount >= 1){
+        m_lineNumber = int(values[0]);
+        m_hasLineNumber = true;
+    }
+    else if(IS_NAME(name, nameLength, STATUS_OVERRIDES) && valueCount >= 3){
+        m_feedOverride = int(values[0]);
+        m_rapidOverride = int(values[1]);
+        m_spindleOverride = int(values[2]);
+        m_hasOverrides = true;
+    }
+    else if(IS_NAME(name, nameLength, STATUS_MOTION_NUM) && valueCount >= 1){
+        m_motionsPlanned = int(values[0]);
+        m_hasMotionsPlanned = true;
+    }
+    else if(IS_NAME(name, nameLength, STATUS_CHARACTER_NUM) && valueCount >= 1){
+        m_charactersQueued = int(values[0]);
+        m_hasCharactersQueued = true;
+    }
+}
+
+void GrblStatus::deduceMotionsPlanned(int plannerBlockCount){
+    if(!m_hasMotionsPlanned && m_hasBufferState){
+        m_motionsPlanned = qMax(0, plannerBlockCount - m_plannerBlocksAvailable);
+        m_hasMotionsPlanned = true;
+    }
+}
+
+GrblStatus::states GrblStatus::decodeState(const char *name, int length){
+    if(IS_NAME(name, length, STATE_IDLE_STRING))    return state_idle;
+    if(IS_NAME(name, length, STATE_RUN_STRING))     return state_run;
+    if(IS_NAME(name, length, STATE_JOG_STRING))     return state_jog;
+    if(IS_NAME(name, length, STATE_HOLD_STRING))    return state_hold;
+    if(IS_NAME(name, length, STATE_DOOR_STRING))    return state_door;
+    if(IS_NAME(name, length, STATE_HOME_STRING))    return state_home;
+    if(IS_NAME(name, length, STATE_ALARM_STRING))   return state_alarm;
+    if(IS_NAME(name, length, STATE_CHECK_STRING))   return state_check;
+    if(IS_NAME(name, length, STATE_SLEEP_STRING))   return state_sleep;
+    return state_unknown;
+}
+
+const char *GrblStatus::parseNumber(const char *data, const char *end, float *value){
+    //Plain decimal notation only, that is all Grbl prints
+    bool isNegative = false;
+    if(*data == '-' || *data == '+'){
+        isNegative = (*data == '-');
+        data++;
+    }
+
+    static const double powersOfTen[NUMBER_MAX_DECIMALS + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+    double mantissa = 0;
+    int decimalCount = 0;
+    bool isFraction = false;
+    for(; data < end ; data++){
+        char c = *data;
+        if(c >= '0' && c <= '9'){
+            //Decimals beyond float precision are dropped
+            if(!isFraction){
+                mantissa = mantissa * 10 + (c - '0');
+            }
+            else if(decimalCount < NUMBER_MAX_DECIMALS){
+                mantissa = mantissa * 10 + (c - '0');
+                decimalCount++;
+            }
+        }
+        else if(c == '.' && !isFraction){
+            isFraction = true;
+        }
+        else{
+            break;
+        }
+    }
+
+    double result = mantissa / powersOfTen[decimalCount];
+    *value = float(isNegative ? -result : result);
+    return data;
+}
+
 
 
 QString GrblStatus::getStateString() const {
@@ -117,10 +281,14 @@ QString GrblStatus::getStateString() const {
         return QString("Homing");
     case state_idle:
         return QString("Ready");
+    case state_jog:
+        return QString("Jogging");
     case state_offline:
         return QString("Offline");
     case state_run:
         return QString("Running");
+    case state_sleep:
+        return QString("Sleep");
     default:
         return QString("Unknown");
     }
@@ -2,17 +2,21 @@
 #define GRBLSTATUS_H
 
 #include <QVector3D>
-#include <QRegularExpression>
+#include <QString>
 #include"grbldefinitions.h"
 
+#define STATUS_MAX_FIELD_VALUES     6       //Axes reported by multi-axis boards, only the first three are kept
+
 class GrblStatus
 {
 public:
 
-    enum states{state_idle, state_run, state_hold, state_door, state_home, state_alarm, state_check, state_unknown, state_offline};
+    enum states{state_idle, state_run, state_hold, state_door, state_home, state_alarm, state_check, state_jog, state_sleep, state_unknown, state_offline};
 
     explicit GrblStatus(bool isConnected = true);
-    explicit GrblStatus(QString statusLine, bool isUnitInches, GrblStatus* previousStatus = nullptr);
+    //Both Grbl 0.9 (comma separated) and Grbl 1.1 (pipe separated) reports, with or without the angle brackets
+    explicit GrblStatus(const char *statusLine, int length, bool isUnitInches, const GrblStatus* previousStatus = nullptr);
+    explicit GrblStatus(const QString &statusLine, bool isUnitInches, const GrblStatus* previousStatus = nullptr);
 
     states getState() const {return m_currState;}
 
@@ -35,16 +39,51 @@ public:
     QVector3D getWorkPositionInGrblUnits() const {return m_workPosition;}
     QVector3D getWorkPositionInMm() const {return (m_isUnitInches) ? m_workPosition * MM_PER_INCH : m_workPosition;}
 
+    //Grbl 1.1 sends it only every few reports : kept from previous status until the board sends it again
+    bool containsWorkOffset() const {return m_hasWorkOffset;}
+    QVector3D getWorkOffsetInGrblUnits() const {return m_workOffset;}
+
     bool containsMotionsPlanned() const {return m_hasMotionsPlanned;}
     int getMotionsPlanned() const {return m_motionsPlanned;}
 
     bool containsCharactersQueued() const {return m_hasCharactersQueued;}
     int getCharactersQueued() const {return m_charactersQueued;}
 
+    //Grbl 1.1 reports free room rather than used room
+    bool containsBufferState() const {return m_hasBufferState;}
+    int getPlannerBlocksAvailable() const {return m_plannerBlocksAvailable;}
+    int getRxBytesAvailable() const {return m_rxBytesAvailable;}
+
+    bool containsFeedRate() const {return m_hasFeedRate;}
+    float getFeedRate() const {return m_feedRate;}
+    bool containsSpindleSpeed() const {return m_hasSpindleSpeed;}
+    float getSpindleSpeed() const {return m_spindleSpeed;}
+
+    bool containsLineNumber() const {return m_hasLineNumber;}
+    int getLineNumber() const {return m_lineNumber;}
+
+    //Percentages, kept from previous status as work offset
+    bool containsOverrides() const {return m_hasOverrides;}
+    int getFeedOverride() const {return m_feedOverride;}
+    int getRapidOverride() const {return m_rapidOverride;}
+    int getSpindleOverride() const {return m_spindleOverride;}
+
+    //Board is moving, or about to : status should be followed closely
+    bool isStateMoving() const {return m_currState == state_run || m_currState == state_jog || m_currState == state_home;}
+
+    //Grbl 1.1 reports free planner blocks only : planned motions are deduced from planner size
+    void deduceMotionsPlanned(int plannerBlockCount);
+
     QString getStateString() const;
 
 
 private:
+    void parse(const char *data, const char *end);
+    void parseField(const char *name, int nameLength, const float *values, int valueCount);
+
+    static states decodeState(const char *name, int length);
+    static const char *parseNumber(const char *data, const char *end, float *value);
+
     states m_currState;
 
     bool m_hasPrevState;
@@ -58,20 +97,31 @@ private:
     bool m_hasWorkPosition;
     QVector3D m_workPosition;
 
+    bool m_hasWorkOffset;
+    QVector3D m_workOffset;
+
     bool m_hasMotionsPlanned;
     int m_motionsPlanned;
 
     bool m_hasCharactersQueued;
     int m_charactersQueued;
 
-    //Convert from string
-    static const  QMap<QString, states> s_stateDecodingMap;
-    static const QMap<QString, states> initStateStringMap(void);
+    bool m_hasBufferState;
+    int m_plannerBlocksAvailable;
+    int m_rxBytesAvailable;
+
+    bool m_hasFeedRate;
+    float m_feedRate;
+    bool m_hasSpindleSpeed;
+    float m_spindleSpeed;
+
+    bool m_hasLineNumber;
+    int m_lineNumber;
 
-    static const QRegularExpression s_mposExpression;
-    static const QRegularExpression s_wposExpression;
-    static const QRegularExpression s_motionsExpression;
-    static const QRegularExpression s_charactersExpression;
+    bool m_hasOverrides;
+    int m_feedOverride;
+    int m_rapidOverride;
+    int m_spindleOverride;
 };
 
 #endif // GRBLSTATUS_H
@@ -0,0 +1,380 @@
+#include "grbltelemetry.h"
+#include "grbldefinitions.h"
+
+#include <QDateTime>
+#include <QtEndian>
+
+#define TELEMETRY_FLUSH_INTERVAL_MS     1000
+#define TELEMETRY_FLUSH_SIZE            65536
+#define TELEMETRY_POSITION_SCALE        10000.0
+#define TELEMETRY_FEED_SCALE            10.0
+
+//Frame flags : state in the low bits, then units and the fields the status contains
+#define FLAG_STATE_MASK         0x0F
+#define FLAG_INCHES             0x10
+#define FLAG_MACHINE_POS        0x20
+#define FLAG_WORK_POS           0x40
+#define FLAG_BUFFER_STATE       0x80
+#define FLAG_MOTIONS            0x100
+#define FLAG_CHARACTERS         0x200
+#define FLAG_FEED               0x400
+
+//Record mask : fields written after it, because they changed
+#define FIELD_FLAGS             0x01
+#define FIELD_MACHINE_POS       0x02
+#define FIELD_WORK_POS          0x04
+#define FIELD_BUFFER_STATE      0x08
+#define FIELD_MOTIONS           0x10
+#define FIELD_CHARACTERS        0x20
+#define FIELD_FEED              0x40
+
+static void appendVarint(QByteArray *bytes, quint64 value){
+    //Seven bits per byte, high bit set while more follow
+    while(value >= 0x80){
+        bytes->append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    bytes->append(char(value));
+}
+
+static void appendSignedVarint(QByteArray *bytes, qint64 value){
+    //Zigzag : small negative deltas stay small
+    appendVarint(bytes, (quint64(value) << 1) ^ quint64(value >> 63));
+}
+
+static void appendPositionDeltas(QByteArray *bytes, const qint64 *position, const qint64 *previousPosition){
+    for(int axis = 0 ; axis < 3 ; axis++){
+        appendSignedVarint(bytes, position[axis] - previousPosition[axis]);
+    }
+}
+
+static bool isPositionEqual(const qint64 *position, const qint64 *otherPosition){
+    return position[0] == otherPosition[0] && position[1] == otherPosition[1] && position[2] == otherPosition[2];
+}
+
+static void appendPosition(QByteArray *line, const char *name, const qint64 *position){
+    line->append('|').append(name);
+    for(int axis = 0 ; axis < 3 ; axis++){
+        if(axis != 0){
+            line->append(',');
+        }
+        line->append(QByteArray::number(position[axis] / TELEMETRY_POSITION_SCALE, 'f', 4));
+    }
+}
+
+void GrblTelemetryFrame::update(const GrblStatus &status){
+    quint32 newFlags = quint32(status.getState()) & FLAG_STATE_MASK;
+    if(status.isUnitInches()){
+        newFlags |= FLAG_INCHES;
+    }
+
+    if(status.containsMachinePosition()){
+        QVector3D position = status.getMachinePositionInGrblUnits();
+        for(int axis = 0 ; axis < 3 ; axis++){
+            machinePosition[axis] = qRound64(position[axis] * TELEMETRY_POSITION_SCALE);
+        }
+        newFlags |= FLAG_MACHINE_POS;
+    }
+    if(status.containsWorkPosition()){
+        QVector3D position = status.getWorkPositionInGrblUnits();
+        for(int axis = 0 ; axis < 3 ; axis++){
+            workPosition[axis] = qRound64(position[axis] * TELEMETRY_POSITION_SCALE);
+        }
+        newFlags |= FLAG_WORK_POS;
+    }
+    if(status.containsBufferState()){
+        plannerBlocksAvailable = status.getPlannerBlocksAvailable();
+        rxBytesAvailable = status.getRxBytesAvailable();
+        newFlags |= FLAG_BUFFER_STATE;
+    }
+    if(status.containsMotionsPlanned()){
+        motionsPlanned = status.getMotionsPlanned();
+        newFlags |= FLAG_MOTIONS;
+    }
+    if(status.containsCharactersQueued()){
+        charactersQueued = status.getCharactersQueued();
+        newFlags |= FLAG_CHARACTERS;
+    }
+    if(status.containsFeedRate()){
+        feedRate = qRound64(status.getFeedRate() * TELEMETRY_FEED_SCALE);
+        newFlags |= FLAG_FEED;
+    }
+
+    flags = newFlags;
+}
+
+GrblStatus GrblTelemetryFrame::toStatus(const GrblStatus *previousStatus) const{
+    static const char *const stateNames[] = {STATE_IDLE_STRING, STATE_RUN_STRING, STATE_HOLD_STRING, STATE_DOOR_STRING, STATE_HOME_STRING,
+                                             STATE_ALARM_STRING, STATE_CHECK_STRING, STATE_JOG_STRING, STATE_SLEEP_STRING};
+
+    int state = int(flags & FLAG_STATE_MASK);
+    if(state == GrblStatus::state_offline){
+        return GrblStatus(false);
+    }
+
+    //Unknown state is any name the parser does not know
+    QByteArray line(state < int(sizeof(stateNames) / sizeof(stateNames[0])) ? stateNames[state] : "Unknown");
+    if(flags & FLAG_MACHINE_POS){
+        appendPosition(&line, STATUS_MACHINE_POS, machinePosition);
+    }
+    if(flags & FLAG_WORK_POS){
+        appendPosition(&line, STATUS_WORK_POS, workPosition);
+    }
+    if(flags & FLAG_BUFFER_STATE){
+        line.append('|').append(STATUS_BUFFER_STATE).append(QByteArray::number(plannerBlocksAvailable))
+            .append(',').append(QByteArray::number(rxBytesAvailable));
+    }
+    if(flags & FLAG_MOTIONS){
+        line.append('|').append(STATUS_MOTION_NUM).append(QByteArray::number(motionsPlanned));
+    }
+    if(flags & FLAG_CHARACTERS){
+        line.append('|').append(STATUS_CHARACTER_NUM).append(QByteArray::number(charactersQueued));
+    }
+    if(flags & FLAG_FEED){
+        line.append('|').append(STATUS_FEED).append(QByteArray::number(feedRate / TELEMETRY_FEED_SCALE, 'f', 1));
+    }
+
+    return GrblStatus(line.constData(), line.size(), (flags & FLAG_INCHES) != 0, previousStatus);
+}
+
+
+GrblTelemetryRecorder::GrblTelemetryRecorder() :
+    m_startTime(0),
+    m_lastTime(0),
+    m_lastFlushTime(0)
+{
+
+}
+
+GrblTelemetryRecorder::~GrblTelemetryRecorder(){
+    close();
+}
+
+bool GrblTelemetryRecorder::open(const QString &path, qint64 time){
+    close();
+
+    m_file.setFileName(path);
+    if(!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)){
+        return false;
+    }
+
+    QByteArray header(TELEMETRY_FILE_MAGIC);
+    header.append(char(TELEMETRY_FILE_VERSION));
+    uchar startTime[sizeof(qint64)];
+    qToLittleEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), startTime);
+    header.append(reinterpret_cast<const char *>(startTime), int(sizeof(startTime)));
+    if(m_file.write(header) != header.size()){
+        m_file.close();
+        return false;
+    }
+
+    m_previous = GrblTelemetryFrame();
+    m_startTime = time;
+    m_lastTime = 0;
+    m_lastFlushTime = 0;
+    return true;
+}
+
+void GrblTelemetryRecorder::close(){
+    if(m_file.isOpen()){
+        flush();
+        m_file.close();
+    }
+}
+
+void GrblTelemetryRecorder::record(const GrblStatus &status, qint64 time){
+    if(!m_file.isOpen()){
+        return;
+    }
+
+    GrblTelemetryFrame frame = m_previous;
+    frame.update(status);
+
+    //Clock never goes back, records never do either
+    qint64 recordTime = qMax(m_lastTime, (time - m_startTime) / 1000);
+    appendVarint(&m_buffer, quint64(recordTime - m_lastTime));
+    m_lastTime = recordTime;
+
+    int maskIndex = m_buffer.size();
+    m_buffer.append(char(0));
+    quint8 mask = 0;
+
+    if(frame.flags != m_previous.flags){
+        mask |= FIELD_FLAGS;
+        appendVarint(&m_buffer, frame.flags);
+    }
+    if((frame.flags & FLAG_MACHINE_POS) && !isPositionEqual(frame.machinePosition, m_previous.machinePosition)){
+        mask |= FIELD_MACHINE_POS;
+        appendPositionDeltas(&m_buffer, frame.machinePosition, m_previous.machinePosition);
+    }
+    if((frame.flags & FLAG_WORK_POS) && !isPositionEqual(frame.workPosition, m_previous.workPosition)){
+        mask |= FIELD_WORK_POS;
+        appendPositionDeltas(&m_buffer, frame.workPosition, m_previous.workPosition);
+    }
+    if((frame.flags & FLAG_BUFFER_STATE) && (frame.plannerBlocksAvailable != m_previous.plannerBlocksAvailable ||
+                                             frame.rxBytesAvailable != m_previous.rxBytesAvailable)){
+        mask |= FIELD_BUFFER_STATE;
+        appendVarint(&m_buffer, quint64(frame.plannerBlocksAvailable));
+        appendVarint(&m_buffer, quint64(frame.rxBytesAvailable));
+    }
+    if((frame.flags & FLAG_MOTIONS) && frame.motionsPlanned != m_previous.motionsPlanned){
+        mask |= FIELD_MOTIONS;
+        appendVarint(&m_buffer, quint64(frame.motionsPlanned));
+    }
+    if((frame.flags & FLAG_CHARACTERS) && frame.charactersQueued != m_previous.charactersQueued){
+        mask |= FIELD_CHARACTERS;
+        appendVarint(&m_buffer, quint64(frame.charactersQueued));
+    }
+    if((frame.flags & FLAG_FEED) && frame.feedRate != m_previous.feedRate){
+        mask |= FIELD_FEED;
+        appendSignedVarint(&m_buffer, frame.feedRate - m_previous.feedRate);
+    }
+
+    m_buffer[maskIndex] = char(mask);
+    m_previous = frame;
+
+    if(recordTime - m_lastFlushTime >= TELEMETRY_FLUSH_INTERVAL_MS || m_buffer.size() >= TELEMETRY_FLUSH_SIZE){
+        m_lastFlushTime = recordTime;
+        flush();
+    }
+}
+
+void GrblTelemetryRecorder::flush(){
+    if(!m_buffer.isEmpty()){
+        m_file.write(m_buffer);
+        m_file.flush();
+        m_buffer.truncate(0);
+    }
+}
+
+
+GrblTelemetryReader::GrblTelemetryReader() :
+    m_status(false),
+    m_startTime(0),
+    m_time(0)
+{
+
+}
+
+bool GrblTelemetryReader::open(const QString &path){
+    close();
+
+    m_file.setFileName(path);
+    if(!m_file.open(QIODevice::ReadOnly)){
+        return false;
+    }
+
+    //Magic, version and start time
+    const int headerSize = int(sizeof(TELEMETRY_FILE_MAGIC)) - 1 + 1 + int(sizeof(qint64));
+    QByteArray header = m_file.read(headerSize);
+    if(header.size() != headerSize || !header.startsWith(TELEMETRY_FILE_MAGIC) || header.at(headerSize - int(sizeof(qint64)) - 1) != TELEMETRY_FILE_VERSION){
+        m_file.close();
+        return false;
+    }
+    m_startTime = qFromLittleEndian<qint64>(reinterpret_cast<const uchar *>(header.constData() + headerSize - int(sizeof(qint64))));
+
+    m_frame = GrblTelemetryFrame();
+    m_status = GrblStatus(false);
+    m_time = 0;
+    return true;
+}
+
+void GrblTelemetryReader::close(){
+    m_file.close();
+}
+
+bool GrblTelemetryReader::readRecord(GrblStatus *status, qint64 *time){
+    quint64 timeDelta;
+    char mask;
+    if(!readVarint(&timeDelta) || !m_file.getChar(&mask)){
+        return false;
+    }
+
+    //Fields are applied to a copy : a record cut short leaves the frame as it was
+    GrblTelemetryFrame frame = m_frame;
+    quint64 value;
+    qint64 delta;
+    if(mask & FIELD_FLAGS){
+        if(!readVarint(&value)){
+            return false;
+        }
+        frame.flags = quint32(value);
+    }
+    if(mask & FIELD_MACHINE_POS){
+        for(int axis = 0 ; axis < 3 ; axis++){
+            if(!readSignedVarint(&delta)){
+                return false;
+            }
+            frame.machinePosition[axis] += delta;
+        }
+    }
+    if(mask & FIELD_WORK_POS){
+        for(int axis = 0 ; axis < 3 ; axis++){
+            if(!readSignedVarint(&delta)){
+                return false;
+            }
+            frame.workPosition[axis] += delta;
+        }
+    }
+    if(mask & FIELD_BUFFER_STATE){
+        if(!readVarint(&value)){
+            return false;
+        }
+        frame.plannerBlocksAvailable = qint64(value);
+        if(!readVarint(&value)){
+            return false;
+        }
+        frame.rxBytesAvailable = qint64(value);
+    }
+    if(mask & FIELD_MOTIONS){
+        if(!readVarint(&value)){
+            return false;
+        }
+        frame.motionsPlanned = qint64(value);
+    }
+    if(mask & FIELD_CHARACTERS){
+        if(!readVarint(&value)){
+            return false;
+        }
+        frame.charactersQueued = qint64(value);
+    }
+    if(mask & FIELD_FEED){
+        if(!readSignedVarint(&delta)){
+            return false;
+        }
+        frame.feedRate += delta;
+    }
+
+    m_frame = frame;
+    m_time += qint64(timeDelta);
+    m_status = m_frame.toStatus(&m_status);
+
+    *status = m_status;
+    *time = m_time;
+    return true;
+}
+
+bool GrblTelemetryReader::readVarint(quint64 *value){
+    quint64 result = 0;
+    for(int shift = 0 ; shift < 64 ; shift += 7){
+        char byte;
+        if(!m_file.getChar(&byte)){
+            return false;
+        }
+        result |= quint64(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0){
+            *value = result;
+            return true;
+        }
+    }
+    return false;       //Longer than any value written
+}
+
+bool GrblTelemetryReader::readSignedVarint(qint64 *value){
+    quint64 encoded;
+    if(!readVarint(&encoded)){
+        return false;
+    }
+    *value = qint64(encoded >> 1) ^ -qint64(encoded & 1);
+    return true;
+}
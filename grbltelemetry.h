@@ -0,0 +1,91 @@
+#ifndef GRBLTELEMETRY_H
+#define GRBLTELEMETRY_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+
+#include "grblstatus.h"
+
+#define TELEMETRY_FILE_MAGIC        "GCTL"
+#define TELEMETRY_FILE_VERSION      1
+#define TELEMETRY_FILE_EXTENSION    "gctl"
+
+//Status fields kept in a recording, in the integer form they are encoded with
+//Positions are in ten thousandths of Grbl units, the finest Grbl prints, feed rate in tenths
+struct GrblTelemetryFrame{
+    quint32 flags = ~0u;            //State, units and fields present, see grbltelemetry.cpp
+    qint64 machinePosition[3] = {};
+    qint64 workPosition[3] = {};
+    qint64 plannerBlocksAvailable = 0;
+    qint64 rxBytesAvailable = 0;
+    qint64 motionsPlanned = 0;
+    qint64 charactersQueued = 0;
+    qint64 feedRate = 0;
+
+    //Fields present in status are taken, absent ones keep their last value
+    void update(const GrblStatus &status);
+    //Built through the status parser, as a report from the board would be
+    GrblStatus toStatus(const GrblStatus *previousStatus) const;
+};
+
+//Appends status reports to a file, each record holding only what changed since the previous one,
+//as varints and zigzag encoded deltas : a few bytes per report while moving, two while idle
+//File is "GCTL", version byte, start time in milliseconds since epoch, then records :
+//time delta in milliseconds, mask of fields that follow, then the fields
+class GrblTelemetryRecorder
+{
+public:
+    GrblTelemetryRecorder();
+    ~GrblTelemetryRecorder();
+
+    //Existing file is replaced, records are timed from time, on the clock given to record
+    bool open(const QString &path, qint64 time);
+    void close();
+    bool isOpen() const {return m_file.isOpen();}
+
+    //Time in microseconds, on any monotonic clock
+    void record(const GrblStatus &status, qint64 time);
+
+    //Bytes recorded so far, header included
+    qint64 getSize() const {return m_file.size() + m_buffer.size();}
+
+private:
+    void flush();
+
+    QFile m_file;
+    QByteArray m_buffer;            //Records not written yet, flushed about once a second so that a crash loses little
+    GrblTelemetryFrame m_previous;
+    qint64 m_startTime;             //Microseconds, time the recording was opened at
+    qint64 m_lastTime;              //Milliseconds since start, as recorded
+    qint64 m_lastFlushTime;
+};
+
+//Reads records back in order, a record cut short by a crash ends the recording
+class GrblTelemetryReader
+{
+public:
+    GrblTelemetryReader();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const {return m_file.isOpen();}
+
+    //Milliseconds since epoch the recording started at
+    qint64 getStartTime() const {return m_startTime;}
+
+    //False at the end of the recording, time in milliseconds since it started
+    bool readRecord(GrblStatus *status, qint64 *time);
+
+private:
+    bool readVarint(quint64 *value);
+    bool readSignedVarint(qint64 *value);
+
+    QFile m_file;
+    GrblTelemetryFrame m_frame;
+    GrblStatus m_status;
+    qint64 m_startTime;
+    qint64 m_time;
+};
+
+#endif // GRBLTELEMETRY_H
@@ -43,6 +43,14 @@ void HistoryModel::onInstructionAcceptedInBoardCharBuffer(GrblInstruction instru
 
 
 
+void HistoryModel::onInstructionRejected(GrblInstruction instruction, QString reason){
+    //Never reached the board : shown as failed, with the reason
+    HistoryItem* rejectedItem = new HistoryItem(instruction,m_rootItem);
+    rejectedItem->setError();
+    addNewChild(rejectedItem,m_rootItem);
+    addNewChild(new HistoryItem(reason,rejectedItem),rejectedItem);
+}
+
 void HistoryModel::onOkReceived(GrblInstruction instruction){
     HistoryItem* matchingItem = m_rootItem->searchItemMatchingInstruction(instruction);
 
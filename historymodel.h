@@ -36,6 +36,7 @@ public slots:
     void onBoardStartup(QString version, QList<GrblInstruction> instructionAtStartupList);
 
     void onInstructionAcceptedInBoardCharBuffer(GrblInstruction instruction);
+    void onInstructionRejected(GrblInstruction instruction, QString reason);
 
     void onOkReceived(GrblInstruction instruction);
     void onErrorReceived( GrblInstruction instruction, QString errorMessage);
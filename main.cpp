@@ -2,6 +2,7 @@
 #include <QApplication>
 
 #include <QSurfaceFormat>
+#include <QCommandLineParser>
 
 int main(int argc, char *argv[])
 {
@@ -14,9 +15,34 @@ int main(int argc, char *argv[])
   //  QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
 
     QApplication a(argc, argv);
+
+    //A CAM still writing its output can be streamed through a pipe, e.g. "cam | G-Commander --follow -"
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption followOption(QStringList() << "f" << "follow",
+                                    QCoreApplication::translate("main", "Stream <file> while it is being written, \"-\" for standard input."),
+                                    QCoreApplication::translate("main", "file"));
+    QCommandLineOption replayOption(QStringList() << "r" << "replay",
+                                    QCoreApplication::translate("main", "Replay status recording <file>, with no board connected."),
+                                    QCoreApplication::translate("main", "file"));
+    QCommandLineOption replaySpeedOption(QStringList() << "replay-speed",
+                                         QCoreApplication::translate("main", "Replay <factor> times faster than recorded, 1 to 100."),
+                                         QCoreApplication::translate("main", "factor"), QStringLiteral("1"));
+    parser.addOption(followOption);
+    parser.addOption(replayOption);
+    parser.addOption(replaySpeedOption);
+    parser.process(a);
+
     MainWindow w;
     w.show();
 
+    if(parser.isSet(followOption)){
+        w.followFile(parser.value(followOption));
+    }
+    if(parser.isSet(replayOption)){
+        w.replayTelemetry(parser.value(replayOption),parser.value(replaySpeedOption).toInt());
+    }
+
 
     return a.exec();
 }
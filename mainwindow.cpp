@@ -4,6 +4,9 @@
 
 #include <QMessageBox>
 #include <QGuiApplication>
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QSignalBlocker>
 
 
 
@@ -22,8 +25,6 @@ MainWindow::MainWindow(QWidget *parent) :
 
     streamer = new GCodeStreamer(this);
 
-    parser = new GCodeParser(this);
-
 
    createWidgets();
 
@@ -47,6 +48,7 @@ void MainWindow::setupDefaultDockLayout(){
     splitDockWidget(gcodeFileDock,controlDock,Qt::Vertical);
     splitDockWidget(controlDock,monitorDock,Qt::Vertical);
     tabifyDockWidget(monitorDock,movementsDock);
+    tabifyDockWidget(monitorDock,diagnosticsDock);
     splitDockWidget(positionDock,visualizerDock,Qt::Vertical);
 
 }
@@ -57,20 +59,18 @@ void MainWindow::connectEverything(){
     connect(grbl,&GrblBoard::ok,                streamer,&GCodeStreamer::onInstructionParsedByGrbl);
     connect(grbl,&GrblBoard::statusUpdated,     streamer,&GCodeStreamer::onGrblStatusUpdated);
     connect(grbl,&GrblBoard::instructionSent,   streamer,&GCodeStreamer::onInstructionSentToGrbl);
+    connect(grbl,&GrblBoard::instructionDiscarded,streamer,&GCodeStreamer::onInstructionDiscardedByGrbl);
     connect(grbl,&GrblBoard::boardStartup,      streamer,&GCodeStreamer::stop);
 
-    connect(streamer,&GCodeStreamer::instructionToSend,   grbl,&GrblBoard::sendInstruction);
+    connect(streamer,&GCodeStreamer::instructionToSend,   grbl,&GrblBoard::queueInstruction);
+    connect(streamer,&GCodeStreamer::queueFlushRequested, grbl,&GrblBoard::flushInstructionQueue);
 
     connect(grbl,&GrblBoard::error,         this,&MainWindow::onGrblError);
+    connect(grbl,&GrblBoard::realtimeCommandRejected,this,&MainWindow::onRealtimeCommandRejected);
     connect(grbl,&GrblBoard::statusUpdated, this,&MainWindow::onGrblStatusUpdated);
 
     connect(streamer,&GCodeStreamer::workCompleted,this,&MainWindow::onStreamerCompleted);
-    connect(streamer,&GCodeStreamer::lineCountUpdated,this,&MainWindow::onStreamerParsingCompleted);
-
-    //Parser
-    connect(streamer,&GCodeStreamer::instructionLoaded,parser,&GCodeParser::parseInstruction);
-    connect(streamer,&GCodeStreamer::cleared,parser,&GCodeParser::reset);
-
+    connect(streamer,&GCodeStreamer::streamError,this,&MainWindow::onStreamerError);
 
 }
 
@@ -111,6 +111,10 @@ void MainWindow::createWidgets(){
     connect(controlWidget,&ControlWidget::cmdPause,grbl,&GrblBoard::rtCmdPauseCycle);
     connect(controlWidget,&ControlWidget::cmdResume,grbl,&GrblBoard::rtCmdResumeCycle);
     connect(controlWidget,&ControlWidget::sendInstruction,grbl,&GrblBoard::sendInstruction);
+    connect(controlWidget,&ControlWidget::cmdFeedOverride,grbl,&GrblBoard::rtCmdFeedOverride);
+    connect(controlWidget,&ControlWidget::cmdSpindleOverride,grbl,&GrblBoard::rtCmdSpindleOverride);
+    connect(controlWidget,&ControlWidget::cmdRapidOverride,grbl,&GrblBoard::rtCmdRapidOverride);
+    connect(controlWidget,&ControlWidget::feedGovernorToggled,grbl,&GrblBoard::setFeedGovernorEnabled);
     connect(grbl,&GrblBoard::statusUpdated,controlWidget,&ControlWidget::onGrblStatusUpdated);
 
     controlWidget->onGrblStatusUpdated(grbl->getLastStatus());
@@ -124,15 +128,19 @@ void MainWindow::createWidgets(){
     addWidgetAndDockToUi(gcodeFileDock,gcodeFileWidget);
 
     connect(gcodeFileWidget,&GCodeFileWidget::openFile, streamer,&GCodeStreamer::loadFile);
+    connect(gcodeFileWidget,&GCodeFileWidget::followFile, streamer,&GCodeStreamer::followFile);
     connect(gcodeFileWidget,&GCodeFileWidget::go,       streamer,&GCodeStreamer::go);
     connect(gcodeFileWidget,&GCodeFileWidget::stop,     streamer,&GCodeStreamer::stop);
     connect(gcodeFileWidget,&GCodeFileWidget::rewind,   streamer,&GCodeStreamer::rewind);
     connect(gcodeFileWidget,&GCodeFileWidget::step,     streamer,&GCodeStreamer::step);
     connect(gcodeFileWidget,&GCodeFileWidget::goToLine, streamer,&GCodeStreamer::goToLine);
+    connect(gcodeFileWidget,&GCodeFileWidget::fileWatchToggled, streamer,&GCodeStreamer::setFileWatched);
     connect(streamer,&GCodeStreamer::fileLoaded,                gcodeFileWidget,&GCodeFileWidget::onFileLoaded);
     connect(streamer,&GCodeStreamer::lineCountUpdated,          gcodeFileWidget,&GCodeFileWidget::onStreamerLineCountChanged);
     connect(streamer,&GCodeStreamer::currentLineUpdated, gcodeFileWidget,&GCodeFileWidget::onStreamerLineParsedChanged);
     connect(streamer,&GCodeStreamer::stateChanged,              gcodeFileWidget,&GCodeFileWidget::onStreamerStateChanged);
+    connect(streamer,&GCodeStreamer::loadingProgress,           gcodeFileWidget,&GCodeFileWidget::onStreamerLoadingProgress);
+    connect(streamer,&GCodeStreamer::estimatedDurationUpdated,  gcodeFileWidget,&GCodeFileWidget::onEstimatedDurationUpdated);
 
     gcodeFileWidget->onStreamerStateChanged(streamer->getState());
 
@@ -143,6 +151,10 @@ void MainWindow::createWidgets(){
     showMenu->addAction(movementsDock->toggleViewAction());
 
     connect(movementsWidget, &MovementsWidget::instructionToGrbl, grbl, &GrblBoard::sendInstruction);
+    connect(movementsWidget, &MovementsWidget::jogStart, grbl, &GrblBoard::jogStart);
+    connect(movementsWidget, &MovementsWidget::jogKeepAlive, grbl, &GrblBoard::jogKeepAlive);
+    connect(movementsWidget, &MovementsWidget::jogStop, grbl, &GrblBoard::jogStop);
+    connect(grbl,&GrblBoard::versionDetected,movementsWidget,&MovementsWidget::setJogSupported);
     connect(grbl,&GrblBoard::statusUpdated,movementsWidget,&MovementsWidget::onGrblStatusUpdated);
     movementsWidget->onGrblStatusUpdated(grbl->getLastStatus());
 
@@ -152,6 +164,7 @@ void MainWindow::createWidgets(){
     addWidgetAndDockToUi(monitorDock,monitorWidget);
     showMenu->addAction(monitorDock->toggleViewAction());
     connect(grbl,&GrblBoard::instructionSent,monitorWidget,&MonitorWidget::onInstructionSentToGrbl);
+    connect(grbl,&GrblBoard::instructionRejected,monitorWidget,&MonitorWidget::onInstructionRejected);
     connect(grbl,&GrblBoard::ok,monitorWidget,&MonitorWidget::onOkReceived);
     connect(grbl,&GrblBoard::error,monitorWidget,&MonitorWidget::onErrorReceived);
     connect(grbl,&GrblBoard::feedback,monitorWidget,&MonitorWidget::onFeedbackReceived);
@@ -181,10 +194,36 @@ void MainWindow::createWidgets(){
     connect(gcodeFileWidget,&GCodeFileWidget::rewind,visualizerWidget,&VisualizerWidget::rewindModel);
     connect(grbl,&GrblBoard::statusUpdated,visualizerWidget,&VisualizerWidget::onGrblStatusUpdated);
 
-    connect(parser,&GCodeParser::parsedPrimitive,visualizerWidget,&VisualizerWidget::appendPrimitive);
+    connect(streamer,&GCodeStreamer::primitivesLoaded,visualizerWidget,&VisualizerWidget::appendPrimitives);
+    connect(streamer,&GCodeStreamer::boundsUpdated,visualizerWidget,&VisualizerWidget::setModelBounds);
+    connect(streamer,&GCodeStreamer::primitivesTruncated,visualizerWidget,&VisualizerWidget::truncateModel);
 
     addWidgetAndDockToUi(visualizerDock,visualizerWidget);
 
+    diagnosticsDock = new QDockWidget("Diagnostics", this);
+    diagnosticsDock->setObjectName("DiagnosticsDock");
+    diagnosticsWidget = new DiagnosticsWidget(diagnosticsDock);
+    addWidgetAndDockToUi(diagnosticsDock,diagnosticsWidget);
+    showMenu->addAction(diagnosticsDock->toggleViewAction());
+    connect(diagnosticsWidget,&DiagnosticsWidget::refreshRequested,this,&MainWindow::onDiagnosticsRefreshRequested);
+    connect(diagnosticsWidget,&DiagnosticsWidget::clearRequested,grbl,&GrblBoard::clearDiagnostics);
+    connect(diagnosticsWidget,&DiagnosticsWidget::clearRequested,this,&MainWindow::onDiagnosticsRefreshRequested);
+
+    QMenu *telemetryMenu = menuBar()->addMenu(tr("&Telemetry"));
+    recordTelemetryAction = telemetryMenu->addAction(tr("Record status..."));
+    recordTelemetryAction->setCheckable(true);
+    connect(recordTelemetryAction,&QAction::toggled,this,&MainWindow::onRecordTelemetryToggled);
+    replayTelemetryAction = telemetryMenu->addAction(tr("Replay recording..."));
+    connect(replayTelemetryAction,&QAction::triggered,this,&MainWindow::onReplayTelemetryTriggered);
+    stopReplayAction = telemetryMenu->addAction(tr("Stop replay"));
+    stopReplayAction->setEnabled(false);
+    connect(stopReplayAction,&QAction::triggered,grbl,&GrblBoard::stopTelemetryReplay);
+    connect(grbl,&GrblBoard::telemetryReplayFinished,this,&MainWindow::onTelemetryReplayFinished);
+
+}
+
+void MainWindow::onDiagnosticsRefreshRequested(){
+    diagnosticsWidget->onDiagnosticsUpdated(grbl->getDiagnostics());
 }
 
 
@@ -199,6 +238,55 @@ void MainWindow::showGrblSettingsDialog(){
     dialog.exec();
 }
 
+void MainWindow::followFile(const QString &path){
+    streamer->followFile(path);
+}
+
+bool MainWindow::replayTelemetry(const QString &path, int speed){
+    if(!grbl->startTelemetryReplay(path,speed)){
+        QMessageBox::warning(this,tr("Replay recording"),tr("Could not replay %1 : close the serial link first, or check the file").arg(path));
+        return false;
+    }
+
+    replayTelemetryAction->setEnabled(false);
+    stopReplayAction->setEnabled(true);
+    return true;
+}
+
+void MainWindow::onRecordTelemetryToggled(bool isChecked){
+    if(!isChecked){
+        grbl->stopTelemetryRecording();
+        return;
+    }
+
+    QString path = QFileDialog::getSaveFileName(this,tr("Record status"),QString(),tr("Status recordings (*.%1)").arg(TELEMETRY_FILE_EXTENSION));
+    if(path.isEmpty() || !grbl->startTelemetryRecording(path)){
+        if(!path.isEmpty()){
+            QMessageBox::warning(this,tr("Record status"),tr("Could not write %1").arg(path));
+        }
+        QSignalBlocker blocker(recordTelemetryAction);
+        recordTelemetryAction->setChecked(false);
+    }
+}
+
+void MainWindow::onReplayTelemetryTriggered(){
+    QString path = QFileDialog::getOpenFileName(this,tr("Replay recording"),QString(),tr("Status recordings (*.%1)").arg(TELEMETRY_FILE_EXTENSION));
+    if(path.isEmpty()){
+        return;
+    }
+
+    bool isAccepted;
+    int speed = QInputDialog::getInt(this,tr("Replay recording"),tr("Times faster than recorded :"),1,1,100,1,&isAccepted);
+    if(isAccepted){
+        replayTelemetry(path,speed);
+    }
+}
+
+void MainWindow::onTelemetryReplayFinished(){
+    replayTelemetryAction->setEnabled(true);
+    stopReplayAction->setEnabled(false);
+}
+
 
 
 
@@ -230,6 +318,14 @@ void MainWindow::onStreamerCompleted(){
     msgBox.exec();
 }
 
+void MainWindow::onRealtimeCommandRejected(const QString &reason){
+    QMessageBox::warning(this,tr("Real time command"),reason);
+}
+
+void MainWindow::onStreamerError(const QString &message){
+    QMessageBox::warning(this,tr("G-code file"),message);
+}
+
 void MainWindow::onGrblStatusUpdated(GrblStatus* const status){
     GrblStatus::states currGrblState = status->getState();
     GrblStatus::states prevGrblState = status->getPreviousState();
@@ -247,11 +343,6 @@ void MainWindow::onGrblStatusUpdated(GrblStatus* const status){
     }
 }
 
-void MainWindow::onStreamerParsingCompleted(){
-    gcodeFileWidget->onEstimatedDurationUpdated(parser->getMachineTime());
-}
-
-
 void MainWindow::onGrblError(GrblInstruction instruction, QString errorString){
     QString errorSummary = createErrorSummary(instruction,errorString);
 
@@ -9,7 +9,6 @@
 
 #include "grblboard.h"
 #include "gcodestreamer.h"
-#include "gcodeparser.h"
 #include "grblerrorrecorder.h"
 
 #include "widgets/controlwidget.h"
@@ -19,6 +18,7 @@
 #include "widgets/monitorwidget.h"
 #include "widgets/movementswidget.h"
 #include "widgets/visualizerwidget.h"
+#include "widgets/diagnosticswidget.h"
 
 
 
@@ -32,12 +32,23 @@ public:
 public slots:
     void showGrblSettingsDialog();
 
+    //Stream a file, a named pipe or standard input ("-") while it is being written
+    void followFile(const QString &path);
+
+    //Recorded statuses drive every widget as the board would, speed times faster
+    bool replayTelemetry(const QString &path, int speed);
+
 
 private slots:
     void onGrblError(GrblInstruction instruction, QString errorString);
+    void onRealtimeCommandRejected(const QString &reason);
     void onStreamerCompleted(void);
+    void onStreamerError(const QString &message);
     void onGrblStatusUpdated(GrblStatus* const status);
-    void onStreamerParsingCompleted();
+    void onDiagnosticsRefreshRequested(void);
+    void onRecordTelemetryToggled(bool isChecked);
+    void onReplayTelemetryTriggered(void);
+    void onTelemetryReplayFinished(void);
 
 
 
@@ -59,7 +70,6 @@ private:
 
     GrblBoard *grbl;
     GCodeStreamer* streamer;
-    GCodeParser* parser;
 
     QDockWidget* hardwareDock;
     HardwareWidget* hardwareWidget;
@@ -82,6 +92,9 @@ private:
     QDockWidget* visualizerDock;
     VisualizerWidget* visualizerWidget;
 
+    QDockWidget* diagnosticsDock;
+    DiagnosticsWidget* diagnosticsWidget;
+
     //set Actions
     QAction *boardMenu;
     QAction *projectMenu;
@@ -90,6 +103,10 @@ private:
     QAction *monitorMenu;
     QAction *visualizerMenu;
 
+    QAction *recordTelemetryAction;
+    QAction *replayTelemetryAction;
+    QAction *stopReplayAction;
+
     QSettings *settings;
 
     QString createErrorSummary(GrblInstruction instruction, QString errorString);
@@ -0,0 +1,65 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QAtomicInt>
+
+//Fixed capacity lock-free queue between exactly one producer thread and one consumer thread
+//Capacity must be a power of two, one slot is kept free to tell a full queue from an empty one
+template <typename T, int Capacity>
+class SpscQueue
+{
+    Q_STATIC_ASSERT_X((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue():
+        m_items(new T[Capacity]),
+        m_head(0),
+        m_tail(0)
+    {
+
+    }
+
+    ~SpscQueue(){
+        delete[] m_items;
+    }
+
+    //Producer side : false if queue is full, item is not queued then
+    bool push(const T &item){
+        int tail = m_tail.load();
+        int next = (tail + 1) & (Capacity - 1);
+        if(next == m_head.loadAcquire()){
+            return false;
+        }
+
+        m_items[tail] = item;
+        m_tail.storeRelease(next);
+        return true;
+    }
+
+    //Consumer side : false if queue is empty
+    bool pop(T *item){
+        int head = m_head.load();
+        if(head == m_tail.loadAcquire()){
+            return false;
+        }
+
+        *item = m_items[head];
+        m_items[head] = T();    //Shared data is released by the consumer, not when the slot is reused
+        m_head.storeRelease((head + 1) & (Capacity - 1));
+        return true;
+    }
+
+    //Only a hint when called from the producer side
+    bool isEmpty() const {return m_head.loadAcquire() == m_tail.loadAcquire();}
+
+private:
+    Q_DISABLE_COPY(SpscQueue)
+
+    T *m_items;
+
+    //Each index is written by a single thread, keep them on separate cache lines
+    alignas(64) QAtomicInt m_head;
+    alignas(64) QAtomicInt m_tail;
+};
+
+#endif // SPSCQUEUE_H
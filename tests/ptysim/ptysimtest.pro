@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Streams a job to grblptysim through the real serial
+# port path, build tools/grblptysim first
+#
+#-------------------------------------------------
+
+QT       += core gui serialport concurrent testlib
+QT       -= widgets
+
+CONFIG += C++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = ptysimtest
+TEMPLATE = app
+
+#Simulator found through GRBLPTYSIM, then next to its sources
+DEFINES += GRBLPTYSIM_BUILD_PATH=\\\"$$OUT_PWD/../../tools/grblptysim/grblptysim\\\"
+
+#Same sources as G-Commander, so that the two lists can not drift apart
+include(../../gcommandercore.pri)
+
+SOURCES += tst_ptysim.cpp
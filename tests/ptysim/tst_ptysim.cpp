@@ -0,0 +1,136 @@
+#include "grblboard.h"
+#include "gcodestreamer.h"
+
+#include <QtTest>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QStandardPaths>
+
+#define SIM_START_TIMEOUT_MS    5000
+#define STARTUP_TIMEOUT_MS      5000
+#define LOAD_TIMEOUT_MS         10000
+#define STREAM_TIMEOUT_MS       120000
+#define SAMPLE_LINE_COUNT       2000
+#define SIM_TIME_SCALE          "20"
+
+//G-Commander and grblptysim talk through a pseudo-terminal, with a link that fragments and delays bytes :
+//a whole job must be streamed without any rx overflow on the board side
+class PtySimTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void streamSampleJob();
+
+private:
+    QString findSimulator() const;
+    QString writeSampleJob() const;
+
+    QTemporaryDir m_dir;
+    QProcess m_simulator;
+    QString m_linkPath;
+};
+
+QString PtySimTest::findSimulator() const{
+    QString path = QString::fromLocal8Bit(qgetenv("GRBLPTYSIM"));
+    if(!path.isEmpty()){
+        return path;
+    }
+    if(QFileInfo(QStringLiteral(GRBLPTYSIM_BUILD_PATH)).isExecutable()){
+        return QStringLiteral(GRBLPTYSIM_BUILD_PATH);
+    }
+    return QStandardPaths::findExecutable(QStringLiteral("grblptysim"));
+}
+
+QString PtySimTest::writeSampleJob() const{
+    QString path = m_dir.filePath(QStringLiteral("sample.nc"));
+    QFile file(path);
+    if(!file.open(QIODevice::WriteOnly)){
+        return QString();
+    }
+
+    //Short zigzag moves of varied lengths, with comments and blank lines the streamer skips
+    QTextStream out(&file);
+    out << "(sample job)\nG21 G90\nG0 X0 Y0 Z1\nG1 Z0 F600\n";
+    for(int i = 0 ; i < SAMPLE_LINE_COUNT ; i++){
+        out << QString("G1 X%1 Y%2 F%3").arg((i % 20) * 0.25,0,'f',3).arg(i * 0.01,0,'f',2).arg(1200 + (i % 7) * 100);
+        out << ((i % 50 == 0) ? " ; pass\n\n" : "\n");
+    }
+    out << "G0 Z1\nM2\n";
+    return path;
+}
+
+void PtySimTest::initTestCase(){
+    QVERIFY(m_dir.isValid());
+    QStandardPaths::setTestModeEnabled(true);
+    QDir::setCurrent(m_dir.path());        //Board profiles are saved in settings.ini
+
+    QString simulatorPath = findSimulator();
+    if(simulatorPath.isEmpty()){
+        QSKIP("grblptysim not found, build tools/grblptysim or set GRBLPTYSIM");
+    }
+
+    m_linkPath = m_dir.filePath(QStringLiteral("ttyGRBL"));
+    m_simulator.setProcessChannelMode(QProcess::MergedChannels);
+    m_simulator.start(simulatorPath, QStringList() << "--link" << m_linkPath << "--time-scale" << SIM_TIME_SCALE
+                      << "--latency" << "2" << "--jitter" << "3" << "--fragment" << "16");
+    QVERIFY(m_simulator.waitForStarted(SIM_START_TIMEOUT_MS));
+    QTRY_VERIFY_WITH_TIMEOUT(QFileInfo::exists(m_linkPath), SIM_START_TIMEOUT_MS);
+}
+
+void PtySimTest::cleanupTestCase(){
+    if(m_simulator.state() != QProcess::NotRunning){
+        m_simulator.terminate();
+        if(!m_simulator.waitForFinished(SIM_START_TIMEOUT_MS)){
+            m_simulator.kill();
+            m_simulator.waitForFinished();
+        }
+    }
+}
+
+void PtySimTest::streamSampleJob(){
+    GrblBoard board;
+    GCodeStreamer streamer;
+    connect(&board,&GrblBoard::ok,                  &streamer,&GCodeStreamer::onInstructionParsedByGrbl);
+    connect(&board,&GrblBoard::statusUpdated,       &streamer,&GCodeStreamer::onGrblStatusUpdated);
+    connect(&board,&GrblBoard::instructionSent,     &streamer,&GCodeStreamer::onInstructionSentToGrbl);
+    connect(&board,&GrblBoard::instructionDiscarded,&streamer,&GCodeStreamer::onInstructionDiscardedByGrbl);
+    connect(&streamer,&GCodeStreamer::instructionToSend,   &board,&GrblBoard::queueInstruction);
+    connect(&streamer,&GCodeStreamer::queueFlushRequested, &board,&GrblBoard::flushInstructionQueue);
+
+    QSignalSpy startupSpy(&board,&GrblBoard::boardStartup);
+    QSignalSpy errorSpy(&board,&GrblBoard::error);
+    QSignalSpy alarmSpy(&board,&GrblBoard::alarm);
+    QSignalSpy loadedSpy(&streamer,&GCodeStreamer::fileLoaded);
+    QSignalSpy streamErrorSpy(&streamer,&GCodeStreamer::streamError);
+    QSignalSpy completedSpy(&streamer,&GCodeStreamer::workCompleted);
+
+    //Same path as choosing the port in the hardware widget
+    board.setSerialSettings(m_linkPath,115200);
+    board.toggleSerial();
+    QVERIFY(startupSpy.wait(STARTUP_TIMEOUT_MS));
+
+    QString jobPath = writeSampleJob();
+    QVERIFY(!jobPath.isEmpty());
+    streamer.loadFile(jobPath);
+    QVERIFY(loadedSpy.count() > 0 || loadedSpy.wait(LOAD_TIMEOUT_MS));
+
+    streamer.go();
+    QVERIFY(completedSpy.wait(STREAM_TIMEOUT_MS));
+    board.toggleSerial();
+
+    QCOMPARE(errorSpy.count(), 0);
+    QCOMPARE(alarmSpy.count(), 0);
+    QCOMPARE(streamErrorSpy.count(), 0);
+
+    //Simulator prints a line for every overflow of its rx buffer
+    QTest::qWait(100);
+    QByteArray simulatorOutput = m_simulator.readAll();
+    QVERIFY2(!simulatorOutput.contains("overflow"), simulatorOutput.constData());
+    QCOMPARE(m_simulator.state(), QProcess::Running);
+}
+
+QTEST_GUILESS_MAIN(PtySimTest)
+#include "tst_ptysim.moc"
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# Admission in board char buffer : GrblCharBuffer ring
+# against the list walk it replaced, in sends per second
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG += C++11 console
+CONFIG -= app_bundle
+
+TARGET = charbufferbench
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../grblcharbuffer.cpp \
+    ../../grblinstruction.cpp
+
+HEADERS  += ../../grblcharbuffer.h \
+    ../../grblinstruction.h
@@ -0,0 +1,120 @@
+#include "grblcharbuffer.h"
+#include "grbldefinitions.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QVector>
+#include <QList>
+
+#define LINE_KINDS  64      //Stream lines of varied lengths, taken in turn
+
+//Char buffer as it was before GrblCharBuffer : every admission walks and copies the instructions in flight
+class ListCharBuffer
+{
+public:
+    explicit ListCharBuffer(int capacity) : m_capacity(capacity) {}
+
+    bool isBlockingInstructionInBuffer(){
+        foreach(GrblInstruction inst, m_instructions){
+            if(inst.isBlocking()){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int getAvailableSpaceInCharBuffer(){
+        int freeSize = m_capacity;
+        foreach(GrblInstruction inst, m_instructions){
+            freeSize -= inst.getLength();
+        }
+        return freeSize;
+    }
+
+    bool isEmpty() const {return m_instructions.isEmpty();}
+    void append(const GrblInstruction &instruction) {m_instructions.append(instruction);}
+    void removeFirst() {m_instructions.removeFirst();}
+
+private:
+    int m_capacity;
+    QList<GrblInstruction> m_instructions;
+};
+
+static QVector<GrblInstruction> buildLines(){
+    QVector<GrblInstruction> lines;
+    for(int i = 0 ; i < LINE_KINDS ; i++){
+        lines.append(GrblInstruction(QString("G1X%1Y%2F%3").arg(i * 1.234,0,'f',3).arg(-i * 0.5 - 1000.0,0,'f',(i % 4) + 1).arg(600 + i * 10),i + 1));
+    }
+    return lines;
+}
+
+//Board answers the oldest instruction, host admits as many lines as fit, as the serial worker does on each ok
+static double benchmarkRing(const QVector<GrblInstruction> &lines, int capacity, qint64 sendCount){
+    GrblCharBuffer buffer(capacity);
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 sent = 0;
+    int next = 0;
+    while(sent < sendCount){
+        while(!buffer.containsBlockingInstruction() && buffer.canAppend(lines.at(next).getLength())){
+            buffer.append(lines.at(next));
+            next = (next + 1) % LINE_KINDS;
+            sent++;
+        }
+        buffer.takeFirst();
+    }
+
+    return sent * 1e9 / qMax<qint64>(timer.nsecsElapsed(), 1);
+}
+
+static double benchmarkList(const QVector<GrblInstruction> &lines, int capacity, qint64 sendCount){
+    ListCharBuffer buffer(capacity);
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 sent = 0;
+    int next = 0;
+    while(sent < sendCount){
+        while(!buffer.isBlockingInstructionInBuffer() && lines.at(next).getLength() <= buffer.getAvailableSpaceInCharBuffer()){
+            buffer.append(lines.at(next));
+            next = (next + 1) % LINE_KINDS;
+            sent++;
+        }
+        buffer.removeFirst();
+    }
+
+    return sent * 1e9 / qMax<qint64>(timer.nsecsElapsed(), 1);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QCoreApplication::translate("main", "Board char buffer admission, ring against list walk."));
+    parser.addHelpOption();
+    QCommandLineOption countOption(QStringList() << "n" << "sends",
+                                   QCoreApplication::translate("main", "Instructions sent by each run."),
+                                   QCoreApplication::translate("main", "count"), QStringLiteral("2000000"));
+    parser.addOption(countOption);
+    parser.process(a);
+
+    qint64 sendCount = qMax(parser.value(countOption).toLongLong(), 1ll);
+    QVector<GrblInstruction> lines = buildLines();
+
+    //Stock Grbl buffer, then the larger ones of 32 bits boards
+    QTextStream out(stdout);
+    out << "rx buffer\tring sends/s\tlist sends/s\tspeedup" << endl;
+    static const int capacities[] = {BOARD_RX_BUFFER_SIZE, 256, 1024};
+    for(int capacity : capacities){
+        double ringRate = benchmarkRing(lines, capacity, sendCount);
+        double listRate = benchmarkList(lines, capacity, sendCount);
+        out << capacity << '\t' << qRound64(ringRate) << '\t' << qRound64(listRate) << '\t'
+            << QString::number(ringRate / listRate, 'f', 1) << 'x' << endl;
+    }
+
+    return 0;
+}
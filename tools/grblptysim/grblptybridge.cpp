@@ -0,0 +1,150 @@
+#include "grblptybridge.h"
+
+#include <QFile>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define DELIVERY_INTERVAL_MS    1
+#define MASTER_READ_SIZE        4096
+
+GrblPtyBridge::GrblPtyBridge(GrblEmulator *emulator, const GrblPtyLinkSettings &linkSettings, QObject *parent) :
+    QObject(parent),
+    m_emulator(emulator),
+    m_linkSettings(linkSettings),
+    m_masterFd(-1),
+    m_slaveFd(-1),
+    m_masterNotifier(nullptr),
+    m_reportedOverflowCount(0)
+{
+    m_deliveryTimer = new QTimer(this);
+    m_deliveryTimer->setTimerType(Qt::PreciseTimer);
+    m_deliveryTimer->setInterval(DELIVERY_INTERVAL_MS);
+    connect(m_deliveryTimer,&QTimer::timeout,this,&GrblPtyBridge::deliverChunks);
+
+    connect(m_emulator,&GrblEmulator::readyRead,this,&GrblPtyBridge::onEmulatorReadyRead);
+}
+
+GrblPtyBridge::~GrblPtyBridge()
+{
+    if(!m_linkPath.isEmpty()){
+        QFile::remove(m_linkPath);
+    }
+    if(m_slaveFd >= 0){
+        ::close(m_slaveFd);
+    }
+    if(m_masterFd >= 0){
+        ::close(m_masterFd);
+    }
+}
+
+bool GrblPtyBridge::open(const QString &linkPath){
+    m_masterFd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(m_masterFd < 0 || grantpt(m_masterFd) != 0 || unlockpt(m_masterFd) != 0){
+        return false;
+    }
+
+    const char *slaveName = ptsname(m_masterFd);
+    if(slaveName == nullptr){
+        return false;
+    }
+    m_slaveName = QString::fromLocal8Bit(slaveName);
+
+    //Bytes go through untouched, as on a serial line
+    m_slaveFd = ::open(slaveName, O_RDWR | O_NOCTTY);
+    if(m_slaveFd < 0){
+        return false;
+    }
+    struct termios attributes;
+    if(tcgetattr(m_slaveFd, &attributes) == 0){
+        cfmakeraw(&attributes);
+        tcsetattr(m_slaveFd, TCSANOW, &attributes);
+    }
+
+    //Stable name, for scripts and settings
+    if(!linkPath.isEmpty()){
+        QFile::remove(linkPath);
+        if(QFile::link(m_slaveName, linkPath)){
+            m_linkPath = linkPath;
+        }
+    }
+
+    m_masterNotifier = new QSocketNotifier(m_masterFd, QSocketNotifier::Read, this);
+    connect(m_masterNotifier,&QSocketNotifier::activated,this,&GrblPtyBridge::onMasterReadable);
+
+    m_clock.start();
+    m_deliveryTimer->start();
+    return m_emulator->open(QIODevice::ReadWrite);
+}
+
+void GrblPtyBridge::onMasterReadable(){
+    char buffer[MASTER_READ_SIZE];
+    ssize_t readSize;
+    while((readSize = ::read(m_masterFd, buffer, sizeof(buffer))) > 0){
+        scheduleChunks(&m_toBoard, QByteArray(buffer, int(readSize)));
+    }
+}
+
+void GrblPtyBridge::onEmulatorReadyRead(){
+    scheduleChunks(&m_toHost, m_emulator->readAll());
+}
+
+void GrblPtyBridge::scheduleChunks(QQueue<Chunk> *queue, const QByteArray &bytes){
+    //Chunks never overtake each other, whatever the jitter
+    int index = 0;
+    while(index < bytes.size()){
+        int size = bytes.size() - index;
+        if(m_linkSettings.maxChunkSize > 0){
+            size = qMin(size, 1 + qrand() % m_linkSettings.maxChunkSize);
+        }
+
+        qint64 dueTime = m_clock.elapsed() + m_linkSettings.latency;
+        if(m_linkSettings.jitter > 0){
+            dueTime += qrand() % (m_linkSettings.jitter + 1);
+        }
+        if(!queue->isEmpty()){
+            dueTime = qMax(dueTime, queue->last().dueTime);
+        }
+
+        queue->enqueue({bytes.mid(index, size), dueTime});
+        index += size;
+    }
+}
+
+void GrblPtyBridge::deliverChunks(){
+    qint64 now = m_clock.elapsed();
+
+    while(!m_toBoard.isEmpty() && m_toBoard.head().dueTime <= now){
+        m_emulator->write(m_toBoard.dequeue().bytes);
+    }
+
+    //Each chunk is a write of its own, so that the host sees it arrive alone
+    while(!m_toHost.isEmpty() && m_toHost.head().dueTime <= now){
+        m_masterOutput.append(m_toHost.dequeue().bytes);
+        writeToMaster();
+    }
+    writeToMaster();
+
+    //Flow control of the host went wrong : bytes were dropped as a real board would
+    if(m_emulator->getRxOverflowCount() > m_reportedOverflowCount){
+        m_reportedOverflowCount = m_emulator->getRxOverflowCount();
+        emit rxOverflowed(m_reportedOverflowCount);
+    }
+}
+
+void GrblPtyBridge::writeToMaster(){
+    //Pseudo-terminal may take part of the bytes only : the rest waits for the next delivery
+    while(!m_masterOutput.isEmpty()){
+        ssize_t writtenSize = ::write(m_masterFd, m_masterOutput.constData(), size_t(m_masterOutput.size()));
+        if(writtenSize <= 0){
+            if(writtenSize < 0 && errno != EAGAIN && errno != EINTR){
+                m_masterOutput.clear();     //Nobody on the other side
+            }
+            break;
+        }
+        m_masterOutput.remove(0, int(writtenSize));
+    }
+}
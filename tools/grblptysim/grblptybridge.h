@@ -0,0 +1,67 @@
+#ifndef GRBLPTYBRIDGE_H
+#define GRBLPTYBRIDGE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <QSocketNotifier>
+
+#include "grblemulator.h"
+
+//How the pseudo-terminal link misbehaves, both ways
+struct GrblPtyLinkSettings{
+    int latency = 0;            //Milliseconds added to every chunk
+    int jitter = 0;             //Up to this many more milliseconds, at random
+    int maxChunkSize = 0;       //Bytes are split in chunks of random size up to this, 0 keeps them whole
+};
+
+//Serves the emulated board on the master side of a pseudo-terminal : a program opening the slave side
+//with QSerialPort talks to it as to a real board, through a link with latency, jitter and fragmentation
+class GrblPtyBridge : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GrblPtyBridge(GrblEmulator *emulator, const GrblPtyLinkSettings &linkSettings, QObject *parent = nullptr);
+    ~GrblPtyBridge();
+
+    //False if no pseudo-terminal could be made, slave name tells where to connect then
+    bool open(const QString &linkPath = QString());
+    QString getSlaveName() const {return m_slaveName;}
+
+signals:
+    //Host sent more than the board rx buffer holds, count is since the bridge was opened
+    void rxOverflowed(int lostByteCount);
+
+private slots:
+    void onMasterReadable();
+    void onEmulatorReadyRead();
+    void deliverChunks();
+
+private:
+    //Bytes on their way, released at their due time
+    struct Chunk{
+        QByteArray bytes;
+        qint64 dueTime;
+    };
+
+    void scheduleChunks(QQueue<Chunk> *queue, const QByteArray &bytes);
+    void writeToMaster();
+
+    GrblEmulator *m_emulator;
+    GrblPtyLinkSettings m_linkSettings;
+    int m_masterFd;
+    int m_slaveFd;              //Kept open, so that the link survives the host closing its side
+    QString m_slaveName;
+    QString m_linkPath;
+    QSocketNotifier *m_masterNotifier;
+    QTimer *m_deliveryTimer;
+    QElapsedTimer m_clock;
+
+    QQueue<Chunk> m_toBoard;
+    QQueue<Chunk> m_toHost;
+    QByteArray m_masterOutput;  //Due to the host, not taken by the pseudo-terminal yet
+    int m_reportedOverflowCount;
+};
+
+#endif // GRBLPTYBRIDGE_H
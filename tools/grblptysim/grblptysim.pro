@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Grbl board stand-in on a pseudo-terminal, so that G-Commander
+# can be tested through its real serial port path
+#
+#-------------------------------------------------
+
+QT       += core gui
+QT       -= widgets
+
+CONFIG += C++11 console
+CONFIG -= app_bundle
+
+TARGET = grblptysim
+TEMPLATE = app
+
+#The board model is the one of G-Commander emulator
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    grblptybridge.cpp \
+    ../../grblemulator.cpp
+
+HEADERS  += grblptybridge.h \
+    ../../grblemulator.h
@@ -0,0 +1,74 @@
+#include "grblptybridge.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    //Connect G-Commander to the printed port name, or to the link given, e.g. "grblptysim --link /tmp/ttyGRBL"
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QCoreApplication::translate("main", "Emulated Grbl board on a pseudo-terminal."));
+    parser.addHelpOption();
+    QCommandLineOption linkOption(QStringList() << "l" << "link",
+                                  QCoreApplication::translate("main", "Symbolic link to the pseudo-terminal."),
+                                  QCoreApplication::translate("main", "path"));
+    QCommandLineOption baudOption(QStringList() << "b" << "baud",
+                                  QCoreApplication::translate("main", "Baud rate the link is throttled to."),
+                                  QCoreApplication::translate("main", "rate"), QStringLiteral("115200"));
+    QCommandLineOption latencyOption(QStringList() << "latency",
+                                     QCoreApplication::translate("main", "Milliseconds added each way."),
+                                     QCoreApplication::translate("main", "ms"), QStringLiteral("0"));
+    QCommandLineOption jitterOption(QStringList() << "jitter",
+                                    QCoreApplication::translate("main", "Up to this many more milliseconds, at random."),
+                                    QCoreApplication::translate("main", "ms"), QStringLiteral("0"));
+    QCommandLineOption fragmentOption(QStringList() << "fragment",
+                                      QCoreApplication::translate("main", "Split bytes in chunks of up to this size."),
+                                      QCoreApplication::translate("main", "bytes"), QStringLiteral("0"));
+    QCommandLineOption timeScaleOption(QStringList() << "time-scale",
+                                       QCoreApplication::translate("main", "Run the board this many times faster than real time."),
+                                       QCoreApplication::translate("main", "factor"), QStringLiteral("1"));
+    QCommandLineOption rxBufferOption(QStringList() << "rx-buffer",
+                                      QCoreApplication::translate("main", "Size of the board rx buffer."),
+                                      QCoreApplication::translate("main", "bytes"), QString::number(EMULATOR_RX_BUFFER_SIZE));
+    QCommandLineOption plannerOption(QStringList() << "planner-blocks",
+                                     QCoreApplication::translate("main", "Motions the board planner holds."),
+                                     QCoreApplication::translate("main", "count"), QString::number(EMULATOR_PLANNER_BLOCKS));
+    parser.addOption(linkOption);
+    parser.addOption(baudOption);
+    parser.addOption(latencyOption);
+    parser.addOption(jitterOption);
+    parser.addOption(fragmentOption);
+    parser.addOption(timeScaleOption);
+    parser.addOption(rxBufferOption);
+    parser.addOption(plannerOption);
+    parser.process(a);
+
+    GrblEmulator emulator;
+    emulator.setBaudRate(qMax(parser.value(baudOption).toInt(), 300));
+    emulator.setTimeScale(qMax(parser.value(timeScaleOption).toDouble(), 0.01));
+    emulator.setRxBufferSize(parser.value(rxBufferOption).toInt());
+    emulator.setPlannerBlockCount(parser.value(plannerOption).toInt());
+
+    GrblPtyLinkSettings linkSettings;
+    linkSettings.latency = parser.value(latencyOption).toInt();
+    linkSettings.jitter = parser.value(jitterOption).toInt();
+    linkSettings.maxChunkSize = parser.value(fragmentOption).toInt();
+
+    QTextStream out(stdout);
+    GrblPtyBridge bridge(&emulator, linkSettings);
+    if(!bridge.open(parser.value(linkOption))){
+        QTextStream(stderr) << QCoreApplication::translate("main", "Could not open a pseudo-terminal") << endl;
+        return 1;
+    }
+    out << QCoreApplication::translate("main", "Grbl board on %1").arg(bridge.getSlaveName()) << endl;
+
+    //Scripts watch for this line, G-Commander must never overflow the board
+    QObject::connect(&bridge, &GrblPtyBridge::rxOverflowed, [&out](int lostByteCount){
+        out << QCoreApplication::translate("main", "Rx buffer overflow, %1 bytes lost").arg(lostByteCount) << endl;
+    });
+
+    return a.exec();
+}
@@ -21,6 +21,28 @@ ControlWidget::ControlWidget(QWidget *parent) :
     m_buttonCommandsMapper->setMapping(this->ui->cmdKillAlarmButton,QStringLiteral(INST_KILL_ALARM));
 
     connect(m_buttonCommandsMapper,SIGNAL(mapped(QString)),this,SLOT(craftInstruction(QString)));
+
+    //Overrides, buttons are mapped to the change in percents
+    m_feedOverrideMapper = new QSignalMapper(this);
+    connect(this->ui->feedOverrideMinusButton,SIGNAL(clicked(bool)),m_feedOverrideMapper,SLOT(map()));
+    m_feedOverrideMapper->setMapping(this->ui->feedOverrideMinusButton,-OVR_COARSE_STEP);
+    connect(this->ui->feedOverridePlusButton,SIGNAL(clicked(bool)),m_feedOverrideMapper,SLOT(map()));
+    m_feedOverrideMapper->setMapping(this->ui->feedOverridePlusButton,OVR_COARSE_STEP);
+    connect(this->ui->feedOverrideResetButton,SIGNAL(clicked(bool)),m_feedOverrideMapper,SLOT(map()));
+    m_feedOverrideMapper->setMapping(this->ui->feedOverrideResetButton,0);
+    connect(m_feedOverrideMapper,SIGNAL(mapped(int)),this,SIGNAL(cmdFeedOverride(int)));
+
+    m_spindleOverrideMapper = new QSignalMapper(this);
+    connect(this->ui->spindleOverrideMinusButton,SIGNAL(clicked(bool)),m_spindleOverrideMapper,SLOT(map()));
+    m_spindleOverrideMapper->setMapping(this->ui->spindleOverrideMinusButton,-OVR_COARSE_STEP);
+    connect(this->ui->spindleOverridePlusButton,SIGNAL(clicked(bool)),m_spindleOverrideMapper,SLOT(map()));
+    m_spindleOverrideMapper->setMapping(this->ui->spindleOverridePlusButton,OVR_COARSE_STEP);
+    connect(this->ui->spindleOverrideResetButton,SIGNAL(clicked(bool)),m_spindleOverrideMapper,SLOT(map()));
+    m_spindleOverrideMapper->setMapping(this->ui->spindleOverrideResetButton,0);
+    connect(m_spindleOverrideMapper,SIGNAL(mapped(int)),this,SIGNAL(cmdSpindleOverride(int)));
+
+    connect(ui->rapidOverrideComboBox,static_cast<void (QComboBox::*)(int)>(&QComboBox::activated),this,&ControlWidget::onRapidOverrideSelected);
+    connect(ui->feedGovernorCheckBox,&QCheckBox::toggled,this,&ControlWidget::feedGovernorToggled);
 }
 
 ControlWidget::~ControlWidget()
@@ -36,6 +58,22 @@ void ControlWidget::onGrblStatusUpdated(const GrblStatus *status){
     ui->cmdCheckButton->setEnabled(status->isStateNominal());
     ui->cmdHoldButton->setEnabled(status->isStateNominal() && !status->isStateCheck());
 
+    //Overrides are only reported, and accepted, by Grbl 1.1
+    bool isOverrideAvailable = status->isStateNominal() && status->containsOverrides();
+    ui->feedOverrideMinusButton->setEnabled(isOverrideAvailable);
+    ui->feedOverridePlusButton->setEnabled(isOverrideAvailable);
+    ui->feedOverrideResetButton->setEnabled(isOverrideAvailable);
+    ui->spindleOverrideMinusButton->setEnabled(isOverrideAvailable);
+    ui->spindleOverridePlusButton->setEnabled(isOverrideAvailable);
+    ui->spindleOverrideResetButton->setEnabled(isOverrideAvailable);
+    ui->rapidOverrideComboBox->setEnabled(isOverrideAvailable);
+    ui->feedGovernorCheckBox->setEnabled(isOverrideAvailable);
+    if(status->containsOverrides()){
+        ui->feedOverrideLabel->setText(QString("Feed %1%").arg(status->getFeedOverride()));
+        ui->spindleOverrideLabel->setText(QString("Spindle %1%").arg(status->getSpindleOverride()));
+        ui->rapidOverrideComboBox->setCurrentIndex(status->getRapidOverride() >= 100 ? 0 : (status->getRapidOverride() >= 50 ? 1 : 2));
+    }
+
     //Handle multi-role buttons
     ui->cmdCheckButton->setChecked(status->getState() == GrblStatus::state_check);
 
@@ -55,6 +93,11 @@ void ControlWidget::onGrblStatusUpdated(const GrblStatus *status){
 
 }
 
+void ControlWidget::onRapidOverrideSelected(int index){
+    static const int rapidPercents[] = {100, 50, 25};
+    emit cmdRapidOverride(rapidPercents[index]);
+}
+
 void ControlWidget::craftInstruction(QString intructionString){
     GrblInstruction instruction(intructionString);
     emit sendInstruction(instruction);
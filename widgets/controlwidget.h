@@ -23,15 +23,24 @@ signals:
     void cmdResume();
     void sendInstruction(GrblInstruction instruction);
 
+    //Override changes in percents, 0 restores programmed value
+    void cmdFeedOverride(int change);
+    void cmdSpindleOverride(int change);
+    void cmdRapidOverride(int percent);
+    void feedGovernorToggled(bool isEnabled);
+
 public slots:
     void onGrblStatusUpdated(const GrblStatus *status);
 
 private slots:
     void craftInstruction(QString intructionString);
+    void onRapidOverrideSelected(int index);
 
 private:
     Ui::ControlWidget *ui;
     QSignalMapper* m_buttonCommandsMapper;
+    QSignalMapper* m_feedOverrideMapper;
+    QSignalMapper* m_spindleOverrideMapper;
 };
 
 #endif // CONTROLWIDGET_H
@@ -0,0 +1,109 @@
+#include "diagnosticswidget.h"
+#include "ui_diagnosticswidget.h"
+
+#include <QFileDialog>
+#include <QFile>
+#include <QMessageBox>
+
+#define DIAGNOSTICS_REFRESH_INTERVAL_MS 500
+
+DiagnosticsWidget::DiagnosticsWidget(QWidget *parent) :
+    QWidget(parent),
+    ui(new Ui::DiagnosticsWidget)
+{
+    ui->setupUi(this);
+    ui->latencyTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(DIAGNOSTICS_REFRESH_INTERVAL_MS);
+    connect(m_refreshTimer,&QTimer::timeout,this,&DiagnosticsWidget::onRefreshTimeout);
+    m_refreshTimer->start();
+
+    connect(ui->exportCsvButton,&QPushButton::clicked,this,&DiagnosticsWidget::exportCsv);
+    connect(ui->exportJsonButton,&QPushButton::clicked,this,&DiagnosticsWidget::exportJson);
+    connect(ui->clearButton,&QPushButton::clicked,this,&DiagnosticsWidget::clearRequested);
+}
+
+DiagnosticsWidget::~DiagnosticsWidget()
+{
+    delete ui;
+}
+
+void DiagnosticsWidget::onRefreshTimeout(){
+    //Snapshots copy histograms : not worth it while nobody looks
+    if(isVisible()){
+        emit refreshRequested();
+    }
+}
+
+void DiagnosticsWidget::onDiagnosticsUpdated(const GrblDiagnostics &diagnostics){
+    m_diagnostics = diagnostics;
+
+    setHistogramRow(0,diagnostics.queueWait);
+    setHistogramRow(1,diagnostics.responseTime);
+    setHistogramRow(2,diagnostics.eventDelay);
+
+    //Real time commands follow, in their order
+    for(int command = 0 ; command < GrblDiagnostics::realtime_command_count ; command++){
+        setHistogramRow(3 + command,diagnostics.realtimeLatency[command]);
+    }
+    ui->timeoutLabel->setText(tr("No effect seen : %1 feed hold, %2 resume, %3 safety door, %4 reset")
+                              .arg(diagnostics.realtimeTimeoutCount[GrblDiagnostics::realtime_feed_hold])
+                              .arg(diagnostics.realtimeTimeoutCount[GrblDiagnostics::realtime_resume])
+                              .arg(diagnostics.realtimeTimeoutCount[GrblDiagnostics::realtime_safety_door])
+                              .arg(diagnostics.realtimeTimeoutCount[GrblDiagnostics::realtime_soft_reset]));
+
+    if(diagnostics.depthHistory.isEmpty()){
+        ui->depthLabel->setText(QStringLiteral("-"));
+        return;
+    }
+
+    const GrblQueueDepthSample &sample = diagnostics.depthHistory.last();
+    QString planner = (sample.plannerBlocks >= 0) ? QString::number(sample.plannerBlocks) : QStringLiteral("?");
+    ui->depthLabel->setText(tr("Waiting : %1 operator, %2 stream - Board : %3 instructions, %4 bytes, %5 motions planned")
+                            .arg(sample.operatorQueued).arg(sample.streamQueued)
+                            .arg(sample.charBufferInstructions).arg(sample.charBufferBytes).arg(planner));
+}
+
+void DiagnosticsWidget::setHistogramRow(int row, const GrblLatencyHistogram &histogram){
+    static const double percentiles[] = {50.0, 90.0, 99.0};
+
+    QStringList cells;
+    cells << QString::number(histogram.getCount());
+    for(double percentile : percentiles){
+        cells << QString::number(histogram.getValueAtPercentile(percentile) / 1000.0,'f',1);
+    }
+    cells << QString::number(histogram.getMax() / 1000.0,'f',1);
+
+    for(int column = 0 ; column < cells.size() ; column++){
+        QTableWidgetItem *item = ui->latencyTable->item(row,column);
+        if(item == nullptr){
+            item = new QTableWidgetItem();
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            ui->latencyTable->setItem(row,column,item);
+        }
+        item->setText(cells.at(column));
+    }
+}
+
+void DiagnosticsWidget::exportCsv(){
+    emit refreshRequested();
+    writeExport(tr("CSV files (*.csv)"),m_diagnostics.toCsv().toUtf8());
+}
+
+void DiagnosticsWidget::exportJson(){
+    emit refreshRequested();
+    writeExport(tr("JSON files (*.json)"),m_diagnostics.toJson());
+}
+
+void DiagnosticsWidget::writeExport(const QString &filter, const QByteArray &content){
+    QString filepath = QFileDialog::getSaveFileName(this,tr("Export diagnostics"),QString(),filter);
+    if(filepath.isEmpty()){
+        return;
+    }
+
+    QFile file(filepath);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(content) != content.size()){
+        QMessageBox::warning(this,tr("Export diagnostics"),tr("Could not write %1").arg(filepath));
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef DIAGNOSTICSWIDGET_H
+#define DIAGNOSTICSWIDGET_H
+
+#include <QWidget>
+#include <QTimer>
+
+#include "grbldiagnostics.h"
+
+namespace Ui {
+class DiagnosticsWidget;
+}
+
+//Live latency percentiles and queue depths, refreshed only while shown
+class DiagnosticsWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit DiagnosticsWidget(QWidget *parent = 0);
+    ~DiagnosticsWidget();
+
+signals:
+    //Answer with onDiagnosticsUpdated
+    void refreshRequested();
+    void clearRequested();
+
+public slots:
+    void onDiagnosticsUpdated(const GrblDiagnostics &diagnostics);
+
+private slots:
+    void onRefreshTimeout(void);
+    void exportCsv(void);
+    void exportJson(void);
+
+private:
+    void setHistogramRow(int row, const GrblLatencyHistogram &histogram);
+    void writeExport(const QString &filter, const QByteArray &content);
+
+    Ui::DiagnosticsWidget *ui;
+    QTimer* m_refreshTimer;
+    GrblDiagnostics m_diagnostics;      //Last snapshot, the one exported
+};
+
+#endif // DIAGNOSTICSWIDGET_H
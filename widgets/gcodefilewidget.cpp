@@ -3,6 +3,8 @@
 
 #include <QFileDialog>
 
+#include "gcodedecompressor.h"
+
 GCodeFileWidget::GCodeFileWidget(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::GCodeFileWidget)
@@ -12,22 +14,38 @@ GCodeFileWidget::GCodeFileWidget(QWidget *parent) :
     ui->currentLineSpinBox->setKeyboardTracking(false);
 
     connect(ui->openButton,&QPushButton::clicked,this,&GCodeFileWidget::onOpenButtonClicked);
+    connect(ui->followButton,&QPushButton::clicked,this,&GCodeFileWidget::onFollowButtonClicked);
     connect(ui->currentLineSpinBox,&QSpinBox::editingFinished,this,&GCodeFileWidget::onCurrentLineSpinBoxEditingFinished);
 
     connect(ui->goButton,&QPushButton::clicked,this,&GCodeFileWidget::go);
     connect(ui->stopButton,&QPushButton::clicked,this,&GCodeFileWidget::stop);
     connect(ui->rewindButton,&QPushButton::clicked,this,&GCodeFileWidget::rewind);
     connect(ui->stepButton,&QPushButton::clicked,this,&GCodeFileWidget::step);
+    connect(ui->watchCheckBox,&QCheckBox::toggled,this,&GCodeFileWidget::fileWatchToggled);
 }
 
 void GCodeFileWidget::onOpenButtonClicked(){
-    QString filter = QStringLiteral("G-Code files *.gc *.ngc");
+    //Compressed files are accepted for each format this build can read
+    QStringList patterns;
+    patterns << QStringLiteral("*.gc") << QStringLiteral("*.ngc") << QStringLiteral("*.gcode");
+    foreach(const QString &suffix, GCodeDecompressor::getSupportedSuffixes()){
+        patterns << QStringLiteral("*.gc.%1").arg(suffix) << QStringLiteral("*.ngc.%1").arg(suffix) << QStringLiteral("*.gcode.%1").arg(suffix);
+    }
+    QString filter = QStringLiteral("G-Code files (%1)").arg(patterns.join(QLatin1Char(' ')));
     QString filepath = QFileDialog::getOpenFileName(this,tr("Select a file"),QString(),filter);
     if(!filepath.isEmpty()){
         emit openFile(filepath);
     }
 }
 
+void GCodeFileWidget::onFollowButtonClicked(){
+    //Named pipes have no suffix, any file can be followed
+    QString filepath = QFileDialog::getOpenFileName(this,tr("Select a file to follow"),QString(),tr("All files (*)"));
+    if(!filepath.isEmpty()){
+        emit followFile(filepath);
+    }
+}
+
 void GCodeFileWidget::onCurrentLineSpinBoxEditingFinished(){
     if(ui->currentLineSpinBox->isEnabled()){
         emit goToLine(ui->currentLineSpinBox->value());
@@ -42,14 +60,28 @@ void GCodeFileWidget::onStreamerStateChanged(GCodeStreamer::states state){
     switch(state){
     case GCodeStreamer::state_clear:
         ui->openButton->setEnabled(true);
+        ui->followButton->setEnabled(true);
         ui->stopButton->setEnabled(false);
         ui->goButton->setEnabled(false);
         ui->rewindButton->setEnabled(false);
         ui->stepButton->setEnabled(false);
         ui->currentLineSpinBox->setEnabled(false);
         break;
+    case GCodeStreamer::state_loading:
+        //Stop button cancels loading
+        ui->openButton->setEnabled(false);
+        ui->followButton->setEnabled(false);
+        ui->stopButton->setEnabled(true);
+        ui->goButton->setEnabled(false);
+        ui->rewindButton->setEnabled(false);
+        ui->stepButton->setEnabled(false);
+        ui->currentLineSpinBox->setEnabled(false);
+        ui->progressBar->setRange(0,100);
+        ui->progressBar->setValue(0);
+        break;
     case GCodeStreamer::state_ready:
         ui->openButton->setEnabled(true);
+        ui->followButton->setEnabled(true);
         ui->stopButton->setEnabled(false);
         ui->goButton->setEnabled(true);
         ui->rewindButton->setEnabled(true);
@@ -58,6 +90,7 @@ void GCodeFileWidget::onStreamerStateChanged(GCodeStreamer::states state){
         break;
     case GCodeStreamer::state_running:
         ui->openButton->setEnabled(false);
+        ui->followButton->setEnabled(false);
         ui->stopButton->setEnabled(true);
         ui->goButton->setEnabled(false);
         ui->rewindButton->setEnabled(false);
@@ -76,6 +109,10 @@ void GCodeFileWidget::onStreamerLineParsedChanged(int line){
     ui->progressBar->setValue(line);
 }
 
+void GCodeFileWidget::onStreamerLoadingProgress(int percent){
+    ui->progressBar->setValue(percent);
+}
+
 void GCodeFileWidget::onEstimatedDurationUpdated(uint32_t duration){
     QString durationString("%1h %2m %3s");
     duration /= (1000); //Convert ms to s
@@ -21,21 +21,25 @@ public:
 
 signals:
     void openFile(QString filePath);
+    void followFile(QString filePath);
     void go();
     void stop();
     void rewind();
     void step();
     void goToLine(int line);
+    void fileWatchToggled(bool isWatched);
 
 public slots:
     void onFileLoaded(QString filename);
     void onStreamerStateChanged(GCodeStreamer::states state);
     void onStreamerLineCountChanged(int line);
     void onStreamerLineParsedChanged(int line);
+    void onStreamerLoadingProgress(int percent);
     void onEstimatedDurationUpdated(uint32_t duration);
 
 private slots:
     void onOpenButtonClicked();
+    void onFollowButtonClicked();
     void onCurrentLineSpinBoxEditingFinished();
 
 
@@ -1,5 +1,6 @@
 #include "hardwarewidget.h"
 #include "ui_hardwarewidget.h"
+#include "grblemulator.h"
 
 #define SERIAL_INFO_REFRESH_DELAY  1000
 
@@ -15,6 +16,8 @@ HardwareWidget::HardwareWidget(QWidget *parent) :
     ui->baudrateBox->addItem(QStringLiteral("115200"));
     ui->baudrateBox->addItem(QStringLiteral("9600"));
 
+    //Emulated board is always there, even without any serial port
+    ui->portBox->addItem(QStringLiteral(EMULATOR_PORT_NAME));
     fillSerialPortsSettings();
 
     m_serialInfoRefreshTimer = new QTimer(this);
@@ -68,6 +71,7 @@ void HardwareWidget::fillSerialPortsSettings(){
 
             ui->portBox->addItem(info.portName());
         }
+        ui->portBox->addItem(QStringLiteral(EMULATOR_PORT_NAME));
 
         //Save current device list
         m_serialPortsInfoList.swap(updatedAvailabledPortInfosList);
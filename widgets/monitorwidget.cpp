@@ -30,6 +30,10 @@ void MonitorWidget::onInstructionSentToGrbl(GrblInstruction instruction){
     history->onInstructionAcceptedInBoardCharBuffer(instruction);
 }
 
+void MonitorWidget::onInstructionRejected(GrblInstruction instruction, QString reason){
+    history->onInstructionRejected(instruction,reason);
+}
+
 void MonitorWidget::onOkReceived(GrblInstruction instruction){
     history->onOkReceived(instruction);
 }
@@ -27,6 +27,7 @@ public slots:
     void onGrblStatusUpdated(const GrblStatus *status);
 
     void onInstructionSentToGrbl(GrblInstruction instruction);
+    void onInstructionRejected(GrblInstruction instruction, QString reason);
 
     void onOkReceived(GrblInstruction instruction);
     void onErrorReceived( GrblInstruction instruction, QString errorMessage);
@@ -1,20 +1,61 @@
 #include "movementswidget.h"
 #include "ui_movementswidget.h"
+#include "grbldefinitions.h"
+
+#include <QKeyEvent>
+#include <QApplication>
+#include <QAbstractButton>
+
+#define JOG_HOLD_DELAY_MS           300     //Press held longer than this is a continuous jog
+#define JOG_KEEP_ALIVE_INTERVAL_MS  100     //Board cancels the jog after half a second without one
+
+const QVector3D MovementsWidget::s_axisDirections[] = {QVector3D(1,0,0), QVector3D(-1,0,0),
+                                                       QVector3D(0,1,0), QVector3D(0,-1,0),
+                                                       QVector3D(0,0,1), QVector3D(0,0,-1)};
 
 MovementsWidget::MovementsWidget(QWidget *parent) :
     QWidget(parent),
-    ui(new Ui::MovementsWidget)
+    ui(new Ui::MovementsWidget),
+    m_pressedAxisDirection(-1),
+    m_isKeyJog(false),
+    m_isContinuousJogging(false),
+    m_isJogSupported(false)
 {
     ui->setupUi(this);
 
-    connect(ui->cmdXBackwardButton, &QPushButton::clicked, this, &MovementsWidget::moveXBackward);
-    connect(ui->cmdXForwardButton, &QPushButton::clicked, this, &MovementsWidget::moveXForward);
-    connect(ui->cmdYBackwardButton, &QPushButton::clicked, this, &MovementsWidget::moveYBackward);
-    connect(ui->cmdYForwardButton, &QPushButton::clicked, this, &MovementsWidget::moveYForward);
-    connect(ui->cmdZBackwardButton, &QPushButton::clicked, this, &MovementsWidget::moveZBackward);
-    connect(ui->cmdZForwardButton, &QPushButton::clicked, this, &MovementsWidget::moveZForward);
+    //Arrow keys and page up / down jog when the widget has focus
+    setFocusPolicy(Qt::StrongFocus);
+
+    m_jogButtonsMapper = new QSignalMapper(this);
+    connect(this->ui->cmdXForwardButton,SIGNAL(pressed()),m_jogButtonsMapper,SLOT(map()));
+    m_jogButtonsMapper->setMapping(this->ui->cmdXForwardButton,x_forward);
+    connect(this->ui->cmdXBackwardButton,SIGNAL(pressed()),m_jogButtonsMapper,SLOT(map()));
+    m_jogButtonsMapper->setMapping(this->ui->cmdXBackwardButton,x_backward);
+    connect(this->ui->cmdYForwardButton,SIGNAL(pressed()),m_jogButtonsMapper,SLOT(map()));
+    m_jogButtonsMapper->setMapping(this->ui->cmdYForwardButton,y_forward);
+    connect(this->ui->cmdYBackwardButton,SIGNAL(pressed()),m_jogButtonsMapper,SLOT(map()));
+    m_jogButtonsMapper->setMapping(this->ui->cmdYBackwardButton,y_backward);
+    connect(this->ui->cmdZForwardButton,SIGNAL(pressed()),m_jogButtonsMapper,SLOT(map()));
+    m_jogButtonsMapper->setMapping(this->ui->cmdZForwardButton,z_forward);
+    connect(this->ui->cmdZBackwardButton,SIGNAL(pressed()),m_jogButtonsMapper,SLOT(map()));
+    m_jogButtonsMapper->setMapping(this->ui->cmdZBackwardButton,z_backward);
+    connect(m_jogButtonsMapper,SIGNAL(mapped(int)),this,SLOT(onJogButtonPressed(int)));
+
+    connect(ui->cmdXBackwardButton, &QPushButton::released, this, &MovementsWidget::onJogButtonReleased);
+    connect(ui->cmdXForwardButton, &QPushButton::released, this, &MovementsWidget::onJogButtonReleased);
+    connect(ui->cmdYBackwardButton, &QPushButton::released, this, &MovementsWidget::onJogButtonReleased);
+    connect(ui->cmdYForwardButton, &QPushButton::released, this, &MovementsWidget::onJogButtonReleased);
+    connect(ui->cmdZBackwardButton, &QPushButton::released, this, &MovementsWidget::onJogButtonReleased);
+    connect(ui->cmdZForwardButton, &QPushButton::released, this, &MovementsWidget::onJogButtonReleased);
     connect(ui->x0y0Button, &QPushButton::clicked, this, &MovementsWidget::gotoX0Y0);
     connect(ui->z0Button, &QPushButton::clicked, this, &MovementsWidget::gotoZ0);
+
+    m_jogHoldTimer.setSingleShot(true);
+    m_jogHoldTimer.setInterval(JOG_HOLD_DELAY_MS);
+    connect(&m_jogHoldTimer, &QTimer::timeout, this, &MovementsWidget::onJogHoldDelayElapsed);
+
+    m_jogKeepAliveTimer.setInterval(JOG_KEEP_ALIVE_INTERVAL_MS);
+    connect(&m_jogKeepAliveTimer, &QTimer::timeout, this, &MovementsWidget::onJogKeepAliveTimeout);
 }
 
 MovementsWidget::~MovementsWidget()
@@ -25,42 +66,190 @@ MovementsWidget::~MovementsWidget()
 void MovementsWidget::onGrblStatusUpdated(const GrblStatus *status)
 {
     setEnabled(status->isStateKnown());
+
+    //Never keep jogging a board which went away, nor step it once back
+    if(!status->isStateKnown()){
+        abortJog();
+    }
+}
+
+void MovementsWidget::setJogSupported(bool isSupported)
+{
+    m_isJogSupported = isSupported;
+}
+
+void MovementsWidget::keyPressEvent(QKeyEvent *event)
+{
+    //Held key repeats : the jog is already running
+    if(event->isAutoRepeat()){
+        return;
+    }
+
+    switch(event->key()){
+    case Qt::Key_Right:     pressJog(x_forward,true);   break;
+    case Qt::Key_Left:      pressJog(x_backward,true);  break;
+    case Qt::Key_Up:        pressJog(y_forward,true);   break;
+    case Qt::Key_Down:      pressJog(y_backward,true);  break;
+    case Qt::Key_PageUp:    pressJog(z_forward,true);   break;
+    case Qt::Key_PageDown:  pressJog(z_backward,true);  break;
+    default:
+        QWidget::keyPressEvent(event);
+    }
+}
+
+void MovementsWidget::keyReleaseEvent(QKeyEvent *event)
+{
+    if(event->isAutoRepeat()){
+        return;
+    }
+
+    switch(event->key()){
+    case Qt::Key_Right:
+    case Qt::Key_Left:
+    case Qt::Key_Up:
+    case Qt::Key_Down:
+    case Qt::Key_PageUp:
+    case Qt::Key_PageDown:
+        releaseJog();
+        break;
+    default:
+        QWidget::keyReleaseEvent(event);
+    }
+}
+
+//Key release goes to whichever widget has focus then, and a hidden button is never released : no step is sent
+void MovementsWidget::focusOutEvent(QFocusEvent *event)
+{
+    if(m_isKeyJog){
+        abortJog();
+    }
+    QWidget::focusOutEvent(event);
 }
 
-void MovementsWidget::moveXForward()
+void MovementsWidget::hideEvent(QHideEvent *event)
 {
-    QString instructionString("G91 G0 X+%1");
-    sendIntruction(instructionString.arg(ui->movementDistanceSpinBox->value()));
+    abortJog();
+    QWidget::hideEvent(event);
 }
 
-void MovementsWidget::moveXBackward()
+void MovementsWidget::changeEvent(QEvent *event)
 {
-    QString instructionString("G91 G0 X-%1");
-    sendIntruction(instructionString.arg(ui->movementDistanceSpinBox->value()));
+    if(event->type() == QEvent::ActivationChange && !isActiveWindow()){
+        abortJog();
+    }
+    QWidget::changeEvent(event);
 }
 
-void MovementsWidget::moveYForward()
+void MovementsWidget::onJogButtonPressed(int axisDirection)
 {
-    QString instructionString("G91 G0 Y+%1");
-    sendIntruction(instructionString.arg(ui->movementDistanceSpinBox->value()));
+    pressJog(axisDirection,false);
 }
 
-void MovementsWidget::moveYBackward()
+void MovementsWidget::onJogButtonReleased()
 {
-    QString instructionString("G91 G0 Y-%1");
-    sendIntruction(instructionString.arg(ui->movementDistanceSpinBox->value()));
+    releaseJog();
 }
 
-void MovementsWidget::moveZForward()
+void MovementsWidget::pressJog(int axisDirection, bool isKey)
 {
-    QString instructionString("G91 G0 Z+%1");
-    sendIntruction(instructionString.arg(ui->movementDistanceSpinBox->value()));
+    if(m_pressedAxisDirection >= 0){
+        return;     //Already pressed on another axis
+    }
+
+    m_pressedAxisDirection = axisDirection;
+    m_isKeyJog = isKey;
+    m_jogHoldTimer.start();
+}
+
+void MovementsWidget::releaseJog()
+{
+    if(m_pressedAxisDirection < 0){
+        return;
+    }
+
+    //Not held long enough for a continuous jog, or board unable to : a single step
+    m_jogHoldTimer.stop();
+    m_jogKeepAliveTimer.stop();
+    if(m_isContinuousJogging){
+        emit jogStop();
+    }
+    else{
+        moveStep(m_pressedAxisDirection);
+    }
+
+    m_pressedAxisDirection = -1;
+    m_isContinuousJogging = false;
+}
+
+void MovementsWidget::abortJog()
+{
+    if(m_pressedAxisDirection < 0){
+        return;
+    }
+
+    m_jogHoldTimer.stop();
+    m_jogKeepAliveTimer.stop();
+    if(m_isContinuousJogging){
+        emit jogStop();
+    }
+
+    m_pressedAxisDirection = -1;
+    m_isContinuousJogging = false;
 }
 
-void MovementsWidget::moveZBackward()
+bool MovementsWidget::isJogStillHeld() const
 {
-    QString instructionString("G91 G0 Z-%2");
-    sendIntruction(instructionString.arg(ui->movementDistanceSpinBox->value()));
+    if(!isVisible() || !isActiveWindow()){
+        return false;
+    }
+    if(m_isKeyJog){
+        QWidget *focusWidget = QApplication::focusWidget();
+        return focusWidget == this || isAncestorOf(focusWidget);
+    }
+    QAbstractButton *button = qobject_cast<QAbstractButton*>(m_jogButtonsMapper->mapping(m_pressedAxisDirection));
+    return button != nullptr && button->isDown();
+}
+
+void MovementsWidget::onJogHoldDelayElapsed()
+{
+    //Older boards can only move step by step
+    if(!m_isJogSupported || m_pressedAxisDirection < 0){
+        return;
+    }
+
+    m_isContinuousJogging = true;
+    emit jogStart(s_axisDirections[m_pressedAxisDirection], ui->jogFeedSpinBox->value());
+    m_jogKeepAliveTimer.start();
+}
+
+void MovementsWidget::onJogKeepAliveTimeout()
+{
+    //A release this widget never got would leave the jog running : check the press is still there
+    if(!isJogStillHeld()){
+        abortJog();
+        return;
+    }
+    emit jogKeepAlive();
+}
+
+void MovementsWidget::moveStep(int axisDirection)
+{
+    static const char axisLetters[] = {'X', 'X', 'Y', 'Y', 'Z', 'Z'};
+    double distance = ui->movementDistanceSpinBox->value();
+    if(axisDirection == x_backward || axisDirection == y_backward || axisDirection == z_backward){
+        distance = -distance;
+    }
+
+    //Jog motions leave the modal state alone and can be cancelled
+    if(m_isJogSupported){
+        QString instructionString(INST_JOG_PREFIX "G91G21%1%2F%3");
+        GrblInstruction instruction(instructionString.arg(QChar(axisLetters[axisDirection])).arg(distance).arg(ui->jogFeedSpinBox->value()));
+        emit instructionToGrbl(instruction);
+    }
+    else{
+        QString instructionString("G91 G0 %1%2");
+        sendIntruction(instructionString.arg(QChar(axisLetters[axisDirection])).arg(distance));
+    }
 }
 
 void MovementsWidget::gotoX0Y0()
@@ -2,6 +2,9 @@
 #define MOVEMENTSWIDGET_H
 
 #include <QWidget>
+#include <QTimer>
+#include <QVector3D>
+#include <QSignalMapper>
 #include <grblinstruction.h>
 #include "grblstatus.h"
 
@@ -20,25 +23,55 @@ public:
 signals:
     void instructionToGrbl(GrblInstruction instruction);
 
+    //Continuous jog, while a button or a key is held
+    void jogStart(const QVector3D &direction, int feedRate);
+    void jogKeepAlive();
+    void jogStop();
+
 public slots:
     void onGrblStatusUpdated(const GrblStatus *status);
+    void setJogSupported(bool isSupported);
+
+protected:
+    void keyPressEvent(QKeyEvent *event) Q_DECL_OVERRIDE;
+    void keyReleaseEvent(QKeyEvent *event) Q_DECL_OVERRIDE;
+    void focusOutEvent(QFocusEvent *event) Q_DECL_OVERRIDE;
+    void hideEvent(QHideEvent *event) Q_DECL_OVERRIDE;
+    void changeEvent(QEvent *event) Q_DECL_OVERRIDE;
 
 private slots:
 
-    void moveXForward();
-    void moveXBackward();
-    void moveYForward();
-    void moveYBackward();
-    void moveZForward();
-    void moveZBackward();
+    void onJogButtonPressed(int axisDirection);
+    void onJogButtonReleased(void);
+    void onJogHoldDelayElapsed(void);
+    void onJogKeepAliveTimeout(void);
     void gotoX0Y0();
     void gotoZ0();
 
     void sendIntruction(QString instructionString);
 
 private:
+    //Directions are indexes in s_axisDirections
+    enum axisDirections{x_forward, x_backward, y_forward, y_backward, z_forward, z_backward};
+
+    void pressJog(int axisDirection, bool isKey);
+    void releaseJog(void);
+    void abortJog(void);
+    bool isJogStillHeld(void) const;
+    void moveStep(int axisDirection);
 
     Ui::MovementsWidget *ui;
+    QSignalMapper* m_jogButtonsMapper;
+
+    //A short press moves one step, holding longer jogs until released
+    QTimer m_jogHoldTimer;
+    QTimer m_jogKeepAliveTimer;
+    int m_pressedAxisDirection;
+    bool m_isKeyJog;                //Held with a key rather than a button
+    bool m_isContinuousJogging;
+    bool m_isJogSupported;
+
+    static const QVector3D s_axisDirections[];
 };
 
 #endif // MOVEMENTSWIDGET_H
@@ -8,10 +8,12 @@
 #define VIEW_DIST_MIN       20.0f
 #define VIEW_DIST_MAX       9000.0f
 #define VIEW_DIST_DEFAULT   250.0f
+#define VIEW_FIT_RATIO      1.5f    //View distance relative to model size
 
 
 VisualizerWidget::VisualizerWidget(QWidget *parent) :
     QOpenGLWidget(parent),
+    m_modelViewDistance(VIEW_DIST_DEFAULT),
     m_drillPrimitive(nullptr){
 }
 
@@ -21,25 +23,61 @@ void VisualizerWidget::cleanModel(){
     m_pathSegmentsVector.clear();
     doneCurrent();
 
+    m_modelCenter = QVector3D();
+    m_modelViewDistance = VIEW_DIST_DEFAULT;
+    resetView();
+}
+
+void VisualizerWidget::truncateModel(int firstLine){
+    if(firstLine >= m_pathSegmentsVector.size()){
+        return;
+    }
+
+    makeCurrent();
+    for(int i = qMax(firstLine,0) ; i < m_pathSegmentsVector.size() ; i++){
+        delete m_pathSegmentsVector.at(i);
+    }
+    m_pathSegmentsVector.resize(qMax(firstLine,0));
+    doneCurrent();
+
+    update();
+}
+
+void VisualizerWidget::setModelBounds(QVector3D boundsMin, QVector3D boundsMax){
+    m_modelCenter = (boundsMin + boundsMax) / 2;
+    m_modelViewDistance = qBound(VIEW_DIST_MIN, (boundsMax - boundsMin).length() * VIEW_FIT_RATIO, VIEW_DIST_MAX);
     resetView();
 }
 
 void VisualizerWidget::appendPrimitive(int line, QVector<QVector3D> path, bool isWork){
+    makeCurrent();
+    insertPrimitive(line,&path,isWork);
+    doneCurrent();
+}
+
+void VisualizerWidget::appendPrimitives(QVector<GCodePrimitive> primitives){
+    //Whole batch is uploaded with a single context switch
+    makeCurrent();
+    for(int i = 0 ; i < primitives.size() ; i++){
+        insertPrimitive(primitives[i].line,&primitives[i].geometry,primitives[i].isWork);
+    }
+    doneCurrent();
+
+    update();
+}
+
+void VisualizerWidget::insertPrimitive(int line, QVector<QVector3D> *path, bool isWork){
     //If no line number is invalid, give up
     if(line >= 0){
-        makeCurrent();
+        VisualizerPrimitive* segment = new VisualizerPrimitive(path, isWork ? VisualizerPrimitive::VPT_GCODE_WORK : VisualizerPrimitive::VPT_GCODE_MOVE);
 
-        VisualizerPrimitive* segment = new VisualizerPrimitive(&path, isWork ? VisualizerPrimitive::VPT_GCODE_WORK : VisualizerPrimitive::VPT_GCODE_MOVE);
-
-        //Fill empty positions in segmentsVector with nullptr value
-        int vectorSize = m_pathSegmentsVector.size();
-        if(vectorSize<line){
-            m_pathSegmentsVector.insert(vectorSize,line-vectorSize,nullptr);
+        //Segments are directly indexed by line number, lines without geometry hold nullptr value
+        if(line >= m_pathSegmentsVector.size()){
+            m_pathSegmentsVector.resize(line+1);
         }
 
-        m_pathSegmentsVector.insert(line,segment);
-
-        doneCurrent();
+        delete m_pathSegmentsVector.at(line);
+        m_pathSegmentsVector[line] = segment;
     }
 }
 
@@ -180,7 +218,7 @@ void VisualizerWidget::initShaders()
 
 void VisualizerWidget::resetView()
 {
-    m_translation = QVector3D(0,0,-VIEW_DIST_DEFAULT);
+    m_translation = QVector3D(-m_modelCenter.x(),-m_modelCenter.y(),-m_modelViewDistance);
     m_rotation = QQuaternion();
 
     update();
@@ -4,6 +4,7 @@
 #include "visualizerprimitive.h"
 #include "grblinstruction.h"
 #include "grblstatus.h"
+#include "gcodeparser.h"
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
@@ -29,6 +30,9 @@ public slots:
 
     void cleanModel(void);
     void appendPrimitive(int line, QVector<QVector3D> path, bool isWork = true);
+    void appendPrimitives(QVector<GCodePrimitive> primitives);
+    void setModelBounds(QVector3D boundsMin, QVector3D boundsMax);
+    void truncateModel(int firstLine);
     void onInstructionSent(GrblInstruction instruction);
     void onInstructionError(GrblInstruction instruction);
     void onInstructionOk(GrblInstruction instruction);
@@ -50,6 +54,7 @@ protected:
 
     void resetView();
     void setPathSegmentStatus(int line, VisualizerPrimitive::Status status);
+    void insertPrimitive(int line, QVector<QVector3D> *path, bool isWork);
 
 private:
     QOpenGLShaderProgram* m_program;
@@ -57,6 +62,8 @@ private:
     QVector2D m_mousePrevPosition;
 
     QVector3D m_translation;
+    QVector3D m_modelCenter;        //View is reset onto the model
+    float m_modelViewDistance;
     QQuaternion m_rotation;
 
     QMatrix4x4 m_projection;